@@ -3,6 +3,10 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "dsp_features.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -10,6 +14,16 @@ extern "C" {
 // Constants                                   
 #define AUDIO_FRAME_MAGIC 0x41554430  /* "AUD0" */
 
+// Frames carry AUDIO_FRAME_MAX_SAMPLES at the capture rate; features are
+// extracted from the frame decimated to AUDIO_FEATURE_FRAME_SAMPLES
+#define AUDIO_FRAME_SAMPLE_RATE         CONFIG_MIC_INPUT_SAMPLE_RATE
+#define AUDIO_FEATURE_DECIMATION        CONFIG_AUDIO_FEATURE_DECIMATION
+#define AUDIO_FEATURE_SAMPLE_RATE       (AUDIO_FRAME_SAMPLE_RATE / AUDIO_FEATURE_DECIMATION)
+#define AUDIO_FEATURE_FRAME_SAMPLES     512
+#define AUDIO_FRAME_MAX_SAMPLES         (AUDIO_FEATURE_FRAME_SAMPLES * AUDIO_FEATURE_DECIMATION)
+#define AUDIO_FRAME_MAX_SPECTRUM_BINS   (AUDIO_FEATURE_FRAME_SAMPLES / 2)
+#define AUDIO_FRAME_MAX_ENVELOPE_POINTS 32
+
 // Scene Labels                                  
 typedef enum {
     SCENE_QUIET = 0,
@@ -17,36 +31,115 @@ typedef enum {
     SCENE_NOISE
 } audio_scene_t;
 
+// Stream Selection
+/*
+ * Payloads a consumer can ask for. The pipeline only fills the frame fields
+ * for streams present in the mask set via sample_process_set_streams().
+ */
+typedef enum {
+    AUDIO_STREAM_RAW      = 1 << 0,   // samples_in
+    AUDIO_STREAM_PROC     = 1 << 1,   // samples_out
+    AUDIO_STREAM_FEATURES = 1 << 2,   // rms, centroid, scene, gain
+    AUDIO_STREAM_SPECTRUM = 1 << 3,   // spectrum
+    AUDIO_STREAM_ENVELOPE = 1 << 4,   // envelope
+    AUDIO_STREAM_EVENTS   = 1 << 5,   // scene transitions (scene_event_queue)
+} audio_stream_t;
+
+#define AUDIO_STREAM_ALL  (AUDIO_STREAM_RAW | AUDIO_STREAM_PROC | \
+                           AUDIO_STREAM_FEATURES | AUDIO_STREAM_SPECTRUM | \
+                           AUDIO_STREAM_ENVELOPE | AUDIO_STREAM_EVENTS)
+
+// Frame flags
+#define AUDIO_FRAME_FLAG_SCENE_CHANGE  (1u << 0)  // frame confirmed a scene transition
+#define AUDIO_FRAME_FLAG_DEGRADED      (1u << 1)  // deadline monitor shed optional streams
+#define AUDIO_FRAME_FLAG_SPECTRAL      (1u << 2)  // spectral features computed for this frame
+
 // Audio Frame Structure                             
 /*
  * This structure represents one processed audio frame and associated metadata.
  * It is passed between tasks (DSP -> transport) via FreeRTOS queues.
  *
  * Ownership rules:
- *  - Producer allocates audio_frame_t
- *  - Consumer is responsible for freeing:
- *      - samples_in
- *      - samples_out
- *      - audio_frame_t itself
+ *  - Frames come from a fixed pool (audio_frame_alloc) whose slots carry
+ *    storage for every payload; nothing is allocated per frame
+ *  - Each queue a frame is posted to holds one reference (audio_frame_retain)
+ *  - Every consumer calls audio_frame_release when done; the slot returns
+ *    to the pool with the last reference
+ *  - Frames are read-only once posted, consumers share the same payloads
+ *
+ * Features are always filled in; payload pointers are NULL when their
+ * stream was not requested.
  */
 
 typedef struct {
     uint32_t magic;          
     uint32_t sample_count;  
 
+    // Timing: sequence increments for every captured frame, including ones
+    // dropped before transport, so consumers can count gaps
+    uint32_t sequence;
+    uint32_t flags;           // AUDIO_FRAME_FLAG_*
+    uint64_t sample_index;    // position of the first sample since capture start
+    int64_t timestamp_us;     // esp_timer time of the first sample
+
     // Extracted features 
     float rms;
     float centroid;
 
-    // Classification result 
+    // Extended spectral shape from the centroid FFT; zero unless
+    // AUDIO_FRAME_FLAG_SPECTRAL is set (the cascade skipped the FFT, or
+    // CONFIG_AUDIO_SPECTRAL_FEATURES is off)
+    dsp_spectral_features_t spectral;
+
+    // Classification result (debounced) and the smoothed gain applied
     audio_scene_t scene;
     float gain;
 
     // Audio payload (16-bit PCM) 
     int16_t *samples_in;      // Raw microphone input 
     int16_t *samples_out;     // Gain-adjusted output
+
+    // Quantized log-magnitude spectrum (NULL when disabled)
+    uint8_t *spectrum;
+    uint16_t spectrum_bins;
+    float spectrum_bin_hz;    // Width of one band in Hz
+
+    // Min/max envelope of samples_out: envelope_points {min, max} pairs
+    int16_t *envelope;
+    uint16_t envelope_points;
+
+    // Outstanding references, managed by audio_frame_pool.c
+    uint32_t refs;
 } audio_frame_t;
 
+// Frame Pool
+/*
+ * Allocate CONFIG_AUDIO_FRAME_POOL_SIZE frame slots up front. Call once
+ * before the first audio_frame_alloc.
+ */
+esp_err_t audio_frame_pool_init(void);
+
+// Take a zeroed frame with one reference, or NULL when every slot is in use
+audio_frame_t *audio_frame_alloc(void);
+
+/*
+ * Storage for one payload of the frame (samples_in / samples_out: int16_t
+ * x AUDIO_FRAME_MAX_SAMPLES, spectrum: uint8_t x
+ * AUDIO_FRAME_MAX_SPECTRUM_BINS, envelope: int16_t x 2 *
+ * AUDIO_FRAME_MAX_ENVELOPE_POINTS). The producer points the matching field
+ * at it when it fills the stream.
+ */
+void *audio_frame_payload(audio_frame_t *frame, audio_stream_t stream);
+
+// Add a reference, one per queue the frame is posted to
+void audio_frame_retain(audio_frame_t *frame);
+
+// Drop a reference; the last one returns the slot to the pool. NULL is ignored.
+void audio_frame_release(audio_frame_t *frame);
+
+// Slots currently free, for diagnostics
+size_t audio_frame_pool_available(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,119 @@
+/**
+ * @file audio_frame_pool.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements the fixed pool of reference-counted audio frames shared by
+ *        the processing task and every transport sink.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include "audio_frame.h"
+#include "sdkconfig.h"
+
+#define POOL_SIZE       CONFIG_AUDIO_FRAME_POOL_SIZE
+#define POOL_MAX_BYTES  (128 * 1024)
+
+static const char *TAG = "frame_pool";
+
+// The frame comes first so a frame pointer is also its slot pointer
+typedef struct {
+    audio_frame_t frame;
+    int16_t samples_in[AUDIO_FRAME_MAX_SAMPLES];
+    int16_t samples_out[AUDIO_FRAME_MAX_SAMPLES];
+    int16_t envelope[2 * AUDIO_FRAME_MAX_ENVELOPE_POINTS];
+    uint8_t spectrum[AUDIO_FRAME_MAX_SPECTRUM_BINS];
+} frame_slot_t;
+
+// Slots grow with AUDIO_FRAME_MAX_SAMPLES, i.e. with the feature decimation
+_Static_assert(POOL_SIZE * sizeof(frame_slot_t) <= POOL_MAX_BYTES,
+               "frame pool exceeds 128 KB: lower AUDIO_FRAME_POOL_SIZE for this decimation");
+
+static frame_slot_t *s_slots[POOL_SIZE];
+static QueueHandle_t s_free;    // frame_slot_t * of every unused slot
+
+esp_err_t audio_frame_pool_init(void)
+{
+    if (s_free) {
+        return ESP_OK;
+    }
+
+    // One allocation per slot, so large slots need no single contiguous block
+    bool ok = true;
+    for (int i = 0; i < POOL_SIZE && ok; i++) {
+        s_slots[i] = heap_caps_calloc(1, sizeof(frame_slot_t), MALLOC_CAP_8BIT);
+        ok = s_slots[i] != NULL;
+    }
+    s_free = ok ? xQueueCreate(POOL_SIZE, sizeof(frame_slot_t *)) : NULL;
+    if (!s_free) {
+        ESP_LOGE(TAG, "Pool allocation failed (%u x %u bytes)",
+                 (unsigned)POOL_SIZE, (unsigned)sizeof(frame_slot_t));
+        for (int i = 0; i < POOL_SIZE; i++) {
+            heap_caps_free(s_slots[i]);
+            s_slots[i] = NULL;
+        }
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < POOL_SIZE; i++) {
+        xQueueSend(s_free, &s_slots[i], 0);
+    }
+
+    ESP_LOGI(TAG, "%d frames, %u bytes each", POOL_SIZE, (unsigned)sizeof(frame_slot_t));
+    return ESP_OK;
+}
+
+audio_frame_t *audio_frame_alloc(void)
+{
+    frame_slot_t *slot = NULL;
+    if (!s_free || xQueueReceive(s_free, &slot, 0) != pdTRUE) {
+        return NULL;
+    }
+
+    // Payload storage is left as is; only the header says what is valid
+    memset(&slot->frame, 0, sizeof(slot->frame));
+    slot->frame.refs = 1;
+    return &slot->frame;
+}
+
+void *audio_frame_payload(audio_frame_t *frame, audio_stream_t stream)
+{
+    frame_slot_t *slot = (frame_slot_t *)frame;
+
+    switch (stream) {
+    case AUDIO_STREAM_RAW:      return slot->samples_in;
+    case AUDIO_STREAM_PROC:     return slot->samples_out;
+    case AUDIO_STREAM_SPECTRUM: return slot->spectrum;
+    case AUDIO_STREAM_ENVELOPE: return slot->envelope;
+    default:                    return NULL;
+    }
+}
+
+void audio_frame_retain(audio_frame_t *frame)
+{
+    __atomic_fetch_add(&frame->refs, 1, __ATOMIC_RELAXED);
+}
+
+void audio_frame_release(audio_frame_t *frame)
+{
+    if (!frame) return;
+
+    // Acquire/release so the last owner sees every write before recycling
+    if (__atomic_sub_fetch(&frame->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        frame_slot_t *slot = (frame_slot_t *)frame;
+        xQueueSend(s_free, &slot, 0);
+    }
+}
+
+size_t audio_frame_pool_available(void)
+{
+    return s_free ? uxQueueMessagesWaiting(s_free) : 0;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file deadline_monitor.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements per-frame execution time and arrival jitter tracking
+ *        against the frame period, with an optional degrade trigger.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include <string.h>
+
+#include "deadline_monitor.h"
+
+// Load smoothing over roughly the last 16 frames
+#define LOAD_EMA_ALPHA  (1.0f / 16.0f)
+
+void deadline_monitor_init(deadline_monitor_t *m, uint32_t period_us, uint32_t headroom_pct)
+{
+    memset(m, 0, sizeof(*m));
+    m->st.period_us = period_us;
+
+    if (headroom_pct > 0 && headroom_pct < 50) {
+        m->degrade_enter = 1.0f - headroom_pct / 100.0f;
+        m->degrade_exit  = 1.0f - 2.0f * headroom_pct / 100.0f;
+    } else {
+        m->degrade_enter = m->degrade_exit = 0.0f;  // disabled
+    }
+}
+
+static uint32_t jitter_bin(uint32_t jitter_us)
+{
+    uint32_t bin = 0;
+    uint32_t limit = 64;
+    while (bin < DEADLINE_JITTER_BINS - 1 && jitter_us >= limit) {
+        limit <<= 1;
+        bin++;
+    }
+    return bin;
+}
+
+bool deadline_monitor_frame(deadline_monitor_t *m, int64_t capture_us, int64_t done_us)
+{
+    deadline_stats_t *st = &m->st;
+    uint32_t exec = (done_us > capture_us) ? (uint32_t)(done_us - capture_us) : 0;
+
+    st->frames++;
+    st->last_exec_us = exec;
+    st->exec_sum_us += exec;
+    st->mean_exec_us = (uint32_t)(st->exec_sum_us / st->frames);
+    if (exec > st->wcet_us) st->wcet_us = exec;
+    if (exec > st->period_us) st->misses++;
+
+    uint32_t bin = (uint32_t)((uint64_t)exec * 10 / st->period_us);
+    st->exec_hist[bin < DEADLINE_EXEC_BINS ? bin : DEADLINE_EXEC_BINS - 1]++;
+
+    // Arrival jitter: spacing between consecutive captures vs the period
+    if (m->last_capture_us) {
+        int64_t interval = capture_us - m->last_capture_us;
+        int64_t dev = interval - st->period_us;
+        uint32_t jitter = (uint32_t)(dev < 0 ? -dev : dev);
+
+        st->jitter_hist[jitter_bin(jitter)]++;
+        if (jitter > st->jitter_max_us) st->jitter_max_us = jitter;
+        if (interval > (int64_t)st->period_us * 3 / 2) st->late_arrivals++;
+    }
+    m->last_capture_us = capture_us;
+
+    // Degrade hysteresis on the smoothed load
+    if (m->degrade_enter <= 0.0f) return false;
+
+    float load = (float)exec / st->period_us;
+    m->load_ema += LOAD_EMA_ALPHA * (load - m->load_ema);
+
+    if (!st->degraded && m->load_ema > m->degrade_enter) {
+        st->degraded = true;
+        st->degrade_entries++;
+        return true;
+    }
+    if (st->degraded && m->load_ema < m->degrade_exit) {
+        st->degraded = false;
+        return true;
+    }
+    return false;
+}
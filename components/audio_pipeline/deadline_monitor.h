@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Real-time deadline monitor for a periodic frame pipeline.
+ *
+ * Each frame is measured from the moment its samples are available until
+ * it has been handed downstream, and compared against the frame period:
+ * if processing takes longer, the next DMA buffer is already waiting and
+ * the pipeline is falling behind.
+ */
+
+#define DEADLINE_EXEC_BINS      12  // 10% of budget each, last bin >= 110%
+#define DEADLINE_JITTER_BINS    10  // arrival jitter, bin k < 64us << k, last open
+
+typedef struct {
+    uint32_t period_us;         // frame budget
+    uint32_t frames;
+    uint32_t misses;            // execution time > period
+    uint32_t late_arrivals;     // frame arrived > 1.5 periods after the last
+    uint32_t wcet_us;           // worst-case execution time seen
+    uint32_t last_exec_us;
+    uint32_t mean_exec_us;
+    uint64_t exec_sum_us;
+    uint32_t jitter_max_us;     // worst |arrival interval - period|
+    uint32_t exec_hist[DEADLINE_EXEC_BINS];
+    uint32_t jitter_hist[DEADLINE_JITTER_BINS];
+    uint32_t degrade_entries;   // times degrade mode was tripped
+    bool degraded;
+} deadline_stats_t;
+
+typedef struct {
+    deadline_stats_t st;
+    int64_t last_capture_us;
+    float load_ema;             // smoothed execution time / period
+    float degrade_enter;        // load above which degrade mode trips
+    float degrade_exit;         // load below which it clears
+} deadline_monitor_t;
+
+/*
+ * headroom_pct: minimum spare share of the budget. When the smoothed load
+ * exceeds 1 - headroom the monitor reports degraded until the load falls
+ * below 1 - 2 * headroom. headroom_pct = 0 disables degrade mode.
+ */
+void deadline_monitor_init(deadline_monitor_t *m, uint32_t period_us, uint32_t headroom_pct);
+
+/*
+ * Record one frame whose samples became available at capture_us and whose
+ * processing finished at done_us. Returns true when the degrade state
+ * changed on this frame (check m->st.degraded).
+ */
+bool deadline_monitor_frame(deadline_monitor_t *m, int64_t capture_us, int64_t done_us);
+
+#ifdef __cplusplus
+}
+#endif
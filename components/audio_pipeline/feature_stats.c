@@ -0,0 +1,169 @@
+/**
+ * @file feature_stats.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements incremental 1 s / 1 min / 1 h feature aggregates:
+ *        Welford moments, extremes, scene dwell and a level histogram.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "feature_stats.h"
+
+#define SECOND_US           1000000LL
+#define WINDOWS_PER_PARENT  60          // seconds per minute, minutes per hour
+
+static void window_reset(feature_window_t *w)
+{
+    memset(w, 0, sizeof(*w));
+    w->rms_min = INFINITY;
+    w->rms_max = 0.0f;
+}
+
+void feature_stats_init(feature_stats_t *s, uint32_t frame_us)
+{
+    memset(s, 0, sizeof(*s));
+    for (int w = 0; w < FEATURE_STATS_WINDOWS; w++) {
+        window_reset(&s->open[w]);
+        window_reset(&s->done[w]);
+    }
+    s->frame_us = frame_us;
+    s->last_scene = -1;
+}
+
+static inline void running_add(running_stat_t *r, float x)
+{
+    r->n++;
+    float delta = x - r->mean;
+    r->mean += delta / r->n;
+    r->m2 += delta * (x - r->mean);
+}
+
+// Chan et al. pairwise combination
+static void running_merge(running_stat_t *into, const running_stat_t *from)
+{
+    if (from->n == 0) return;
+    if (into->n == 0) {
+        *into = *from;
+        return;
+    }
+    float n = (float)into->n + from->n;
+    float delta = from->mean - into->mean;
+    into->mean += delta * from->n / n;
+    into->m2 += from->m2 + delta * delta * ((float)into->n * from->n / n);
+    into->n += from->n;
+}
+
+float running_stat_stddev(const running_stat_t *r)
+{
+    return r->n ? sqrtf(r->m2 / r->n) : 0.0f;
+}
+
+static void window_merge(feature_window_t *into, const feature_window_t *from)
+{
+    if (from->frames == 0) return;
+    if (into->frames == 0) into->start_us = from->start_us;
+    into->end_us = from->end_us;
+    into->frames += from->frames;
+    running_merge(&into->rms, &from->rms);
+    running_merge(&into->centroid, &from->centroid);
+    if (from->rms_min < into->rms_min) into->rms_min = from->rms_min;
+    if (from->rms_max > into->rms_max) into->rms_max = from->rms_max;
+    for (int i = 0; i < FEATURE_STATS_SCENES; i++) {
+        into->scene_frames[i] += from->scene_frames[i];
+    }
+    into->scene_changes += from->scene_changes;
+    for (int i = 0; i < FEATURE_STATS_LEVEL_BINS; i++) {
+        into->level_hist[i] += from->level_hist[i];
+    }
+}
+
+// Close open[w] and cascade into the longer windows as they fill up
+static void close_window(feature_stats_t *s, int w)
+{
+    s->done[w] = s->open[w];
+    window_reset(&s->open[w]);
+    s->children[w] = 0;
+
+    int parent = w + 1;
+    if (parent < FEATURE_STATS_WINDOWS) {
+        window_merge(&s->open[parent], &s->done[w]);
+        if (++s->children[parent] == WINDOWS_PER_PARENT) {
+            close_window(s, parent);
+        }
+    }
+}
+
+static inline int level_bin(float rms)
+{
+    if (rms <= 0.0f) return 0;
+    float db = 20.0f * log10f(rms);
+    int bin = (int)((db - FEATURE_STATS_LEVEL_FLOOR_DB) / FEATURE_STATS_LEVEL_BIN_DB);
+    if (bin < 0) return 0;
+    if (bin >= FEATURE_STATS_LEVEL_BINS) return FEATURE_STATS_LEVEL_BINS - 1;
+    return bin;
+}
+
+void feature_stats_frame(feature_stats_t *s, int64_t timestamp_us,
+                         float rms, float centroid, int scene)
+{
+    feature_window_t *sec = &s->open[FEATURE_STATS_SECOND];
+
+    if (sec->frames && timestamp_us >= s->second_end_us) {
+        close_window(s, FEATURE_STATS_SECOND);
+        s->second_end_us += SECOND_US;
+        if (timestamp_us >= s->second_end_us) {
+            // Capture gap: restart the grid rather than emit empty windows
+            s->second_end_us = timestamp_us + SECOND_US;
+        }
+    }
+    if (sec->frames == 0) {
+        sec->start_us = timestamp_us;
+        if (!s->second_end_us) s->second_end_us = timestamp_us + SECOND_US;
+    }
+
+    sec->frames++;
+    sec->end_us = timestamp_us + s->frame_us;
+    running_add(&sec->rms, rms);
+    if (centroid > 0.0f) {
+        running_add(&sec->centroid, centroid);
+    }
+    if (rms < sec->rms_min) sec->rms_min = rms;
+    if (rms > sec->rms_max) sec->rms_max = rms;
+    if (scene >= 0 && scene < FEATURE_STATS_SCENES) {
+        sec->scene_frames[scene]++;
+    }
+    if (s->last_scene >= 0 && scene != s->last_scene) {
+        sec->scene_changes++;
+    }
+    s->last_scene = scene;
+    sec->level_hist[level_bin(rms)]++;
+}
+
+const feature_window_t *feature_stats_latest(const feature_stats_t *s,
+                                             feature_stats_window_t w, bool *complete)
+{
+    *complete = s->done[w].frames != 0;
+    return *complete ? &s->done[w] : &s->open[w];
+}
+
+float feature_window_level_quantile(const feature_window_t *win, float q)
+{
+    if (win->frames == 0) return FEATURE_STATS_LEVEL_FLOOR_DB;
+
+    // Interpolate linearly inside the bin that crosses the rank
+    float rank = q * win->frames;
+    uint32_t below = 0;
+    for (int i = 0; i < FEATURE_STATS_LEVEL_BINS; i++) {
+        uint32_t count = win->level_hist[i];
+        if (count && below + count >= rank) {
+            float frac = (rank - below) / count;
+            if (frac < 0.0f) frac = 0.0f;
+            return FEATURE_STATS_LEVEL_FLOOR_DB + (i + frac) * FEATURE_STATS_LEVEL_BIN_DB;
+        }
+        below += count;
+    }
+    return FEATURE_STATS_LEVEL_FLOOR_DB + FEATURE_STATS_LEVEL_BINS * FEATURE_STATS_LEVEL_BIN_DB;
+}
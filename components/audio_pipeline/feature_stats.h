@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Long-term feature statistics over 1 s, 1 min and 1 h windows.
+ *
+ * Each frame updates only the open 1 s window. When it closes it is merged
+ * into the open minute; 60 closed seconds close a minute and 60 closed
+ * minutes an hour. Merging is a fixed amount of work per closed window,
+ * so the cost per frame stays O(1). Second boundaries follow a fixed 1 s
+ * grid on the sample clock, so a window holds whole frames but minutes and
+ * hours do not drift. Readers see the last complete window of each length.
+ *
+ * Percentiles come from a fixed histogram of the frame level in dBFS
+ * (FEATURE_STATS_LEVEL_BIN_DB resolution), which merges by addition.
+ */
+
+#define FEATURE_STATS_LEVEL_BINS        48
+#define FEATURE_STATS_LEVEL_FLOOR_DB    (-96.0f)
+#define FEATURE_STATS_LEVEL_BIN_DB      2.0f
+#define FEATURE_STATS_SCENES            3       // audio_scene_t values
+
+typedef enum {
+    FEATURE_STATS_SECOND = 0,
+    FEATURE_STATS_MINUTE,
+    FEATURE_STATS_HOUR,
+    FEATURE_STATS_WINDOWS
+} feature_stats_window_t;
+
+// Welford running mean / sum of squared deviations
+typedef struct {
+    uint32_t n;
+    float mean;
+    float m2;
+} running_stat_t;
+
+typedef struct {
+    int64_t start_us;           // capture time of the first frame
+    int64_t end_us;             // end of the last frame
+    uint32_t frames;
+    running_stat_t rms;
+    running_stat_t centroid;    // frames that computed a centroid only
+    float rms_min;
+    float rms_max;
+    uint32_t scene_frames[FEATURE_STATS_SCENES];
+    uint32_t scene_changes;
+    uint32_t level_hist[FEATURE_STATS_LEVEL_BINS];
+} feature_window_t;
+
+typedef struct {
+    feature_window_t open[FEATURE_STATS_WINDOWS];   // being filled
+    feature_window_t done[FEATURE_STATS_WINDOWS];   // last complete window
+    uint32_t children[FEATURE_STATS_WINDOWS];       // windows merged into open[w]
+    uint32_t frame_us;
+    int64_t second_end_us;      // nominal end of the open 1 s window
+    int last_scene;             // -1 before the first frame
+} feature_stats_t;
+
+void feature_stats_init(feature_stats_t *s, uint32_t frame_us);
+
+// One frame starting at timestamp_us; centroid <= 0 when not computed
+void feature_stats_frame(feature_stats_t *s, int64_t timestamp_us,
+                         float rms, float centroid, int scene);
+
+/*
+ * The window to report for `w`: the last complete one, or the open one
+ * while none has completed yet (*complete = false then).
+ */
+const feature_window_t *feature_stats_latest(const feature_stats_t *s,
+                                             feature_stats_window_t w, bool *complete);
+
+// Population standard deviation of a running statistic
+float running_stat_stddev(const running_stat_t *r);
+
+// Level in dBFS below which a share q (0..1) of the window's frames fell
+float feature_window_level_quantile(const feature_window_t *win, float q);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,259 @@
+/**
+ * @file flight_recorder.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements the pre-trigger flight recorder: a ring of recent audio blocks
+ *        that is frozen around trigger events so the clip can be downloaded.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+#include "ima_adpcm.h"
+#include "flight_recorder.h"
+#include "sdkconfig.h"
+
+#if CONFIG_AUDIO_RECORDER_ENABLE
+
+#define PRE_SECONDS     CONFIG_AUDIO_RECORDER_PRE_SECONDS
+#define POST_SECONDS    CONFIG_AUDIO_RECORDER_POST_SECONDS
+#define HOLD_US         ((int64_t)CONFIG_AUDIO_RECORDER_HOLD_SECONDS * 1000000)
+#define HEAP_PERCENT    CONFIG_AUDIO_RECORDER_MAX_HEAP_PERCENT
+
+static const char *TAG = "flight_recorder";
+
+typedef enum {
+    REC_ARMED = 0,      // recording, waiting for a trigger
+    REC_POST,           // triggered, recording post-trigger blocks
+    REC_HELD,           // clip frozen, ring not written
+} rec_state_t;
+
+// Decoder state at the start of an ADPCM block, so every block decodes alone
+typedef struct {
+    int16_t predictor;
+    int8_t  index;
+    uint8_t reserved;
+} adpcm_block_header_t;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint8_t *s_ring;
+static size_t s_block_bytes;
+static uint32_t s_block_samples;
+static uint32_t s_sample_rate;
+static uint32_t s_capacity;         // blocks
+static uint32_t s_pre_blocks;
+static uint32_t s_post_blocks;
+
+// Writer-owned (real-time task)
+static uint32_t s_head;             // next block to write
+static uint32_t s_filled;           // valid blocks in the ring
+static uint32_t s_post_remaining;
+static ima_adpcm_state_t s_enc;
+
+// Shared, guarded by s_lock
+static volatile rec_state_t s_state = REC_ARMED;
+static volatile int s_pending_cause = -1;
+static int s_readers;
+static int64_t s_held_since_us;
+static recorder_clip_t s_clip;
+
+static inline uint8_t *block_ptr(uint32_t index)
+{
+    return s_ring + (size_t)index * s_block_bytes;
+}
+
+esp_err_t flight_recorder_init(uint32_t sample_rate, size_t block_samples)
+{
+    if (s_ring) return ESP_OK;
+    if (block_samples == 0 || (block_samples & 1)) return ESP_ERR_INVALID_ARG;
+
+#if CONFIG_AUDIO_RECORDER_FORMAT_ADPCM
+    s_block_bytes = sizeof(adpcm_block_header_t) + block_samples / 2;
+#else
+    s_block_bytes = block_samples * sizeof(int16_t);
+#endif
+    s_block_samples = block_samples;
+    s_sample_rate   = sample_rate;
+
+    uint32_t pre  = (PRE_SECONDS * sample_rate + block_samples - 1) / block_samples;
+    uint32_t post = (POST_SECONDS * sample_rate + block_samples - 1) / block_samples;
+    size_t need = (size_t)(pre + post) * s_block_bytes;
+
+#if CONFIG_SPIRAM
+    if (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) >= need) {
+        s_ring = heap_caps_malloc(need, MALLOC_CAP_SPIRAM);
+    }
+#endif
+
+    if (!s_ring) {
+        // Internal RAM: never take more than HEAP_PERCENT of the largest block
+        size_t budget = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+                        / 100 * HEAP_PERCENT;
+        if (need > budget) {
+            uint32_t total = budget / s_block_bytes;
+            if (total < 2) {
+                ESP_LOGE(TAG, "Not enough memory for recorder ring");
+                return ESP_ERR_NO_MEM;
+            }
+            // Shrink, keeping the pre/post proportion
+            uint32_t new_post = (uint32_t)((uint64_t)post * total / (pre + post));
+            pre  = total - new_post;
+            post = new_post;
+            need = (size_t)total * s_block_bytes;
+            ESP_LOGW(TAG, "Ring limited by heap: %.1f s pre, %.1f s post",
+                     (float)pre * block_samples / sample_rate,
+                     (float)post * block_samples / sample_rate);
+        }
+        s_ring = heap_caps_malloc(need, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+
+    if (!s_ring) {
+        ESP_LOGE(TAG, "Recorder ring allocation failed (%u bytes)", (unsigned)need);
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_pre_blocks  = pre;
+    s_post_blocks = post;
+    s_capacity    = pre + post;
+
+    ESP_LOGI(TAG, "Recorder ring: %u blocks x %u bytes (%u bytes)",
+             (unsigned)s_capacity, (unsigned)s_block_bytes, (unsigned)need);
+    return ESP_OK;
+}
+
+static void store_block(uint8_t *dst, const int16_t *pcm)
+{
+#if CONFIG_AUDIO_RECORDER_FORMAT_ADPCM
+    adpcm_block_header_t hdr = {
+        .predictor = s_enc.predictor,
+        .index     = s_enc.index
+    };
+    memcpy(dst, &hdr, sizeof(hdr));
+    ima_adpcm_encode(&s_enc, pcm, s_block_samples, dst + sizeof(hdr));
+#else
+    memcpy(dst, pcm, s_block_samples * sizeof(int16_t));
+#endif
+}
+
+void flight_recorder_write(const int16_t *pcm)
+{
+    if (!s_ring) return;
+
+    int64_t now = esp_timer_get_time();
+
+    if (s_state == REC_HELD) {
+        bool rearmed = false;
+        portENTER_CRITICAL(&s_lock);
+        if (s_readers == 0 && now - s_held_since_us > HOLD_US) {
+            s_filled = 0;
+            s_state  = REC_ARMED;
+            rearmed  = true;
+        }
+        portEXIT_CRITICAL(&s_lock);
+        if (!rearmed) return;
+    }
+
+    store_block(block_ptr(s_head), pcm);
+    s_head = (s_head + 1) % s_capacity;
+    if (s_filled < s_capacity) s_filled++;
+
+    if (s_state == REC_ARMED) {
+        int cause = s_pending_cause;
+        if (cause < 0) return;
+
+        s_pending_cause = -1;
+        s_clip.cause           = (recorder_cause_t)cause;
+        s_clip.trigger_time_us = now;
+        s_clip.pre_samples     = (s_filled < s_pre_blocks ? s_filled : s_pre_blocks)
+                                 * s_block_samples;
+        s_post_remaining = s_post_blocks;
+        s_state = REC_POST;
+    }
+    else if (s_post_remaining > 0) {
+        s_post_remaining--;
+    }
+
+    if (s_state == REC_POST && s_post_remaining == 0) {
+        uint32_t count = s_clip.pre_samples / s_block_samples + s_post_blocks;
+
+        portENTER_CRITICAL(&s_lock);
+        s_clip.sample_rate   = s_sample_rate;
+        s_clip.block_samples = s_block_samples;
+        s_clip.block_count   = count;
+        s_clip.first_block   = (s_head + s_capacity - count) % s_capacity;
+        s_held_since_us = now;
+        s_state = REC_HELD;
+        portEXIT_CRITICAL(&s_lock);
+    }
+}
+
+void flight_recorder_trigger(recorder_cause_t cause)
+{
+    if (s_ring && s_state == REC_ARMED && s_pending_cause < 0) {
+        s_pending_cause = (int)cause;
+    }
+}
+
+bool flight_recorder_open_clip(recorder_clip_t *clip)
+{
+    bool ok = false;
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_state == REC_HELD) {
+        s_readers++;
+        *clip = s_clip;
+        ok = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    return ok;
+}
+
+void flight_recorder_read_block(const recorder_clip_t *clip, uint32_t index, int16_t *out)
+{
+    const uint8_t *src = block_ptr((clip->first_block + index) % s_capacity);
+
+#if CONFIG_AUDIO_RECORDER_FORMAT_ADPCM
+    adpcm_block_header_t hdr;
+    memcpy(&hdr, src, sizeof(hdr));
+    ima_adpcm_state_t st = {
+        .predictor = hdr.predictor,
+        .index     = hdr.index
+    };
+    ima_adpcm_decode(&st, src + sizeof(hdr), clip->block_samples, out);
+#else
+    memcpy(out, src, clip->block_samples * sizeof(int16_t));
+#endif
+}
+
+void flight_recorder_close_clip(bool consumed)
+{
+    portENTER_CRITICAL(&s_lock);
+    if (s_readers > 0) s_readers--;
+    if (consumed && s_readers == 0 && s_state == REC_HELD) {
+        s_filled = 0;
+        s_state  = REC_ARMED;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+const char *flight_recorder_cause_name(recorder_cause_t cause)
+{
+    switch (cause) {
+        case RECORDER_CAUSE_MANUAL:       return "manual";
+        case RECORDER_CAUSE_SCENE_CHANGE: return "scene_change";
+        case RECORDER_CAUSE_LOUD:         return "loud";
+    }
+    return "unknown";
+}
+
+#endif // CONFIG_AUDIO_RECORDER_ENABLE
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Pre-trigger flight recorder.
+ *
+ * The real-time task writes every frame into a ring of fixed-size blocks
+ * (raw int16 or IMA ADPCM, see CONFIG_AUDIO_RECORDER_FORMAT). A trigger
+ * keeps recording for the post-trigger time and then holds the ring as a
+ * clip of pre + post seconds until it has been downloaded or the hold time
+ * expires. Readers decode one block at a time, so a clip is never
+ * materialized in memory.
+ */
+
+typedef enum {
+    RECORDER_CAUSE_MANUAL = 0,
+    RECORDER_CAUSE_SCENE_CHANGE,
+    RECORDER_CAUSE_LOUD,
+} recorder_cause_t;
+
+typedef struct {
+    uint32_t sample_rate;
+    uint32_t block_samples;
+    uint32_t first_block;     // ring index of the oldest block in the clip
+    uint32_t block_count;
+    uint32_t pre_samples;     // samples before the trigger
+    recorder_cause_t cause;
+    int64_t  trigger_time_us; // esp_timer time of the trigger
+} recorder_clip_t;
+
+/*
+ * Allocate the ring for CONFIG_AUDIO_RECORDER_PRE/POST_SECONDS, preferring
+ * PSRAM when present and otherwise shrinking to fit the internal heap budget.
+ */
+esp_err_t flight_recorder_init(uint32_t sample_rate, size_t block_samples);
+
+// Append one block of block_samples int16 samples. Real-time task only.
+void flight_recorder_write(const int16_t *pcm);
+
+// Request a capture. Ignored while a capture is already in progress or held.
+void flight_recorder_trigger(recorder_cause_t cause);
+
+/*
+ * Pin the held clip for reading. Returns false if no clip is available.
+ * Every successful open must be paired with flight_recorder_close_clip().
+ */
+bool flight_recorder_open_clip(recorder_clip_t *clip);
+
+// Decode block `index` (0..block_count-1) of the clip into block_samples samples
+void flight_recorder_read_block(const recorder_clip_t *clip, uint32_t index, int16_t *out);
+
+// Unpin the clip; if `consumed`, release it and re-arm the recorder
+void flight_recorder_close_clip(bool consumed);
+
+const char *flight_recorder_cause_name(recorder_cause_t cause);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,148 @@
+/**
+ * @file pipeline_graph.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements stage registration, dependency ordering into a static
+ *        schedule and the timed per-frame run of the processing pipeline.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_cpu.h"
+
+#include "pipeline_graph.h"
+
+static const char *TAG = "pipeline_graph";
+
+void pipeline_graph_init(pipeline_graph_t *g, uint32_t provided)
+{
+    memset(g, 0, sizeof(*g));
+    g->provided = provided;
+}
+
+esp_err_t pipeline_graph_add(pipeline_graph_t *g, const pipeline_stage_t *stage)
+{
+    if (!g || !stage || !stage->name || !stage->process || g->built) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (g->stage_count >= PIPELINE_MAX_STAGES) {
+        return ESP_ERR_NO_MEM;
+    }
+    g->stages[g->stage_count++] = stage;
+    return ESP_OK;
+}
+
+/*
+ * Stage j (registered as j) must run after stage i when i writes a buffer
+ * that j only reads, or when both write it and i was registered first.
+ */
+static bool depends_on(const pipeline_graph_t *g, int j, int i)
+{
+    const pipeline_stage_t *a = g->stages[i];
+    const pipeline_stage_t *b = g->stages[j];
+    uint32_t read_only = b->inputs & ~b->outputs;
+
+    if (a->outputs & read_only) return true;
+    if (i < j && (a->outputs & b->outputs)) return true;
+    return false;
+}
+
+esp_err_t pipeline_graph_build(pipeline_graph_t *g, pipeline_ctx_t *ctx)
+{
+    if (!g || g->built) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Every input must come from the driver or from some other stage
+    for (int j = 0; j < g->stage_count; j++) {
+        uint32_t available = g->provided;
+        for (int i = 0; i < g->stage_count; i++) {
+            if (i != j) available |= g->stages[i]->outputs;
+        }
+        uint32_t missing = g->stages[j]->inputs & ~available;
+        if (missing) {
+            ESP_LOGE(TAG, "Stage %s reads buffers 0x%02x that no stage writes",
+                     g->stages[j]->name, (unsigned)missing);
+            return ESP_ERR_NOT_FOUND;
+        }
+    }
+
+    // Topological order; among ready stages the earliest registered runs first
+    bool scheduled[PIPELINE_MAX_STAGES] = { false };
+    g->schedule_len = 0;
+    while (g->schedule_len < g->stage_count) {
+        int next = -1;
+        for (int j = 0; j < g->stage_count && next < 0; j++) {
+            if (scheduled[j]) continue;
+            bool ready = true;
+            for (int i = 0; i < g->stage_count && ready; i++) {
+                if (i != j && !scheduled[i] && depends_on(g, j, i)) ready = false;
+            }
+            if (ready) next = j;
+        }
+        if (next < 0) {
+            ESP_LOGE(TAG, "Stage dependency cycle after %d of %d stages",
+                     g->schedule_len, g->stage_count);
+            return ESP_ERR_INVALID_STATE;
+        }
+        scheduled[next] = true;
+        g->schedule[g->schedule_len] = g->stages[next];
+        g->stats[g->schedule_len].name = g->stages[next]->name;
+        g->schedule_len++;
+    }
+
+    for (int k = 0; k < g->schedule_len; k++) {
+        const pipeline_stage_t *s = g->schedule[k];
+        if (s->init) {
+            esp_err_t err = s->init(ctx);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Stage %s init failed: %s", s->name, esp_err_to_name(err));
+                return err;
+            }
+        }
+        ESP_LOGI(TAG, "%2d %-10s in 0x%02x out 0x%02x", k, s->name,
+                 (unsigned)s->inputs, (unsigned)s->outputs);
+    }
+
+    g->built = true;
+    return ESP_OK;
+}
+
+bool pipeline_graph_run(pipeline_graph_t *g, pipeline_ctx_t *ctx)
+{
+    uint32_t skipped = 0;   // buffers some stage did not produce this frame
+
+    for (int k = 0; k < g->schedule_len; k++) {
+        const pipeline_stage_t *s = g->schedule[k];
+        pipeline_stage_stats_t *st = &g->stats[k];
+
+        if (s->inputs & skipped) {
+            skipped |= s->outputs;
+            continue;
+        }
+
+        uint32_t start = esp_cpu_get_cycle_count();
+        pipeline_result_t res = s->process(ctx);
+        uint32_t cycles = esp_cpu_get_cycle_count() - start;
+
+        st->calls++;
+        st->last_cycles = cycles;
+        st->total_cycles += cycles;
+        if (cycles > st->max_cycles) st->max_cycles = cycles;
+
+        if (res == PIPELINE_STOP) return false;
+        if (res == PIPELINE_SKIP_OUTPUTS) skipped |= s->outputs;
+    }
+    return skipped == 0;
+}
+
+size_t pipeline_graph_get_stats(const pipeline_graph_t *g, pipeline_stage_stats_t *out, size_t max)
+{
+    size_t n = (size_t)g->schedule_len;
+    for (size_t k = 0; k < n && k < max; k++) {
+        out[k] = g->stats[k];
+    }
+    return n;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#include "audio_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Static stage graph for the per-frame processing pipeline.
+ *
+ * Each stage declares which shared buffers it reads and which it writes.
+ * Stages are registered once at startup; pipeline_graph_build orders them
+ * into a fixed schedule so that every reader of a buffer runs after all
+ * of its writers (writers of the same buffer keep registration order, so
+ * in-place conditioning stages chain). Each intermediate result lives once
+ * in pipeline_ctx_t and is computed once per frame, however many stages
+ * consume it.
+ *
+ * Running the schedule is a loop over an array of function pointers with
+ * a cycle-counter read around each call; no allocation, lookup or locking
+ * happens per frame.
+ */
+
+#define PIPELINE_MAX_STAGES     24
+
+// Shared buffers a stage can read or write
+typedef enum {
+    PIPELINE_BUF_SAMPLES         = 1u << 0,  // captured block at the capture rate
+    PIPELINE_BUF_FEATURE_SAMPLES = 1u << 1,  // block the features are extracted from
+    PIPELINE_BUF_FEATURES        = 1u << 2,  // rms, centroid, spectral features
+    PIPELINE_BUF_SPECTRUM        = 1u << 3,  // magnitude spectrum of the feature block
+    PIPELINE_BUF_SCENE           = 1u << 4,  // scene label and gain
+    PIPELINE_BUF_PCM16           = 1u << 5,  // int16 copy of the captured block
+    PIPELINE_BUF_FRAME           = 1u << 6,  // audio_frame_t being packaged
+} pipeline_buf_t;
+
+/*
+ * Per-frame state shared by all stages. The driver fills the frame clock
+ * and the buffers it provides, then resets the per-frame results before
+ * running the schedule.
+ */
+typedef struct {
+    // Frame clock
+    uint32_t sequence;
+    uint64_t sample_index;          // first sample since capture start
+    int64_t capture_us;             // I2S read completion
+    int64_t timestamp_us;           // sample clock time of the first sample
+    uint32_t streams;               // AUDIO_STREAM_* wanted by any consumer
+    uint32_t flags;                 // AUDIO_FRAME_FLAG_*, stages add to it
+
+    // PIPELINE_BUF_SAMPLES: 24-bit left-aligned, conditioned in place
+    int32_t *samples;
+    size_t sample_count;
+    int sample_rate;
+
+    // PIPELINE_BUF_FEATURE_SAMPLES: same layout, may alias samples
+    int32_t *feature_samples;
+    size_t feature_count;
+    int feature_rate;
+
+    // PIPELINE_BUF_FEATURES
+    float rms;
+    float centroid;                 // NAN when no stage computed it
+    bool need_fft;                  // the centroid can still change the label
+    dsp_spectral_features_t spectral;
+
+    // PIPELINE_BUF_SPECTRUM: feature_count / 2 bins, NULL when not wanted
+    float *spectrum;
+
+    // PIPELINE_BUF_SCENE
+    audio_scene_t scene;
+    float gain;
+    bool scene_changed;
+
+    // PIPELINE_BUF_PCM16: NULL when not converted this frame
+    int16_t *pcm16;
+
+    // PIPELINE_BUF_FRAME
+    audio_frame_t *frame;
+} pipeline_ctx_t;
+
+typedef enum {
+    PIPELINE_CONTINUE = 0,
+    PIPELINE_STOP,                  // skip the rest of the schedule for this frame
+    PIPELINE_SKIP_OUTPUTS,          // outputs not produced: skip only the stages reading them
+} pipeline_result_t;
+
+typedef struct {
+    const char *name;
+    uint32_t inputs;                // PIPELINE_BUF_* read
+    uint32_t outputs;               // PIPELINE_BUF_* written or produced
+    esp_err_t (*init)(pipeline_ctx_t *ctx);    // optional, once when the graph is built
+    pipeline_result_t (*process)(pipeline_ctx_t *ctx);
+} pipeline_stage_t;
+
+// Execution time of one scheduled stage, in CPU cycles
+typedef struct {
+    const char *name;
+    uint32_t calls;
+    uint32_t last_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+} pipeline_stage_stats_t;
+
+typedef struct {
+    const pipeline_stage_t *stages[PIPELINE_MAX_STAGES];   // registration order
+    int stage_count;
+    const pipeline_stage_t *schedule[PIPELINE_MAX_STAGES]; // run order
+    pipeline_stage_stats_t stats[PIPELINE_MAX_STAGES];     // by schedule position
+    int schedule_len;
+    uint32_t provided;              // buffers the driver fills before each run
+    bool built;
+} pipeline_graph_t;
+
+// provided: PIPELINE_BUF_* bits the driver fills before every run
+void pipeline_graph_init(pipeline_graph_t *g, uint32_t provided);
+
+// Register a stage; the descriptor must outlive the graph. Only before build.
+esp_err_t pipeline_graph_add(pipeline_graph_t *g, const pipeline_stage_t *stage);
+
+/*
+ * Order the registered stages and run their init hooks. Fails with
+ * ESP_ERR_NOT_FOUND when a stage reads a buffer nothing provides,
+ * ESP_ERR_INVALID_STATE on a dependency cycle, or the first init error.
+ */
+esp_err_t pipeline_graph_build(pipeline_graph_t *g, pipeline_ctx_t *ctx);
+
+/*
+ * Run the schedule once; returns false when a stage stopped the frame or
+ * skipped its outputs. A stage that reads a skipped buffer is not run and
+ * its own outputs count as skipped too; every other stage still runs.
+ */
+bool pipeline_graph_run(pipeline_graph_t *g, pipeline_ctx_t *ctx);
+
+/*
+ * Copy up to `max` per-stage timing entries in schedule order; returns the
+ * number of scheduled stages. Fields may straddle one frame.
+ */
+size_t pipeline_graph_get_stats(const pipeline_graph_t *g, pipeline_stage_stats_t *out, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,8 +1,9 @@
 /**
  * @file sample_process.c
  * @author Dmitri Lyalikov (dvl2013@nyu.edu)
- * @brief Implements the sample processing task that reads from the microphone,
- *        performs DSP feature extraction and classification, and sends audio frames to queue.
+ * @brief Implements the sample processing task that reads from the microphone
+ *        and runs the stage graph: conditioning, DSP feature extraction,
+ *        classification and packaging of audio frames for the queue.
  * @version 0.1
  * @date 2025-12-15
  */
@@ -10,6 +11,7 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -17,33 +19,331 @@
 
 #include "esp_log.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 
 #include "mic_input.h"
 #include "dsp_features.h"
+#include "dsp_fixed.h"
+#include "sound_level.h"
+#include "biquad_chain.h"
+#include "fir_decimator.h"
 #include "audio_frame.h"    
+#include "sample_process.h"
+#include "flight_recorder.h"
+#include "scene_detector.h"
+#include "deadline_monitor.h"
+#include "power_manager.h"
+#include "metrics.h"
+#include "feature_log.h"
+#include "pipeline_graph.h"
 #include "sdkconfig.h"
 
 
-#define SAMPLE_RATE     16000
-#define SAMPLE_COUNT    512
+// Captured frame: streams, recorder, sound level meter
+#define SAMPLE_RATE     AUDIO_FRAME_SAMPLE_RATE
+#define SAMPLE_COUNT    AUDIO_FRAME_MAX_SAMPLES
 
-#define RMS_QUIET_TH    0.025f
-#define RMS_NOISE_TH    0.10f
+// Decimated copy the features are extracted from
+#define DECIMATION      AUDIO_FEATURE_DECIMATION
+#define FEATURE_RATE    AUDIO_FEATURE_SAMPLE_RATE
+#define FEATURE_COUNT   AUDIO_FEATURE_FRAME_SAMPLES
 
-#define CENTROID_MIN    600.0f
-#define CENTROID_MAX    3200.0f
+_Static_assert((SAMPLE_RATE % DECIMATION) == 0,
+               "MIC_INPUT_SAMPLE_RATE must be a multiple of the feature decimation");
+_Static_assert(FEATURE_COUNT == DSP_TABLES_FFT_SIZE && FEATURE_RATE == DSP_TABLES_SAMPLE_RATE,
+               "DSP tables are generated for another frame size; see components/dsp/CMakeLists.txt");
 
-#define GAIN_QUIET      3.0f
-#define GAIN_SPEECH     1.0f
-#define GAIN_NOISE      0.5f
+#if CONFIG_AUDIO_SPECTRUM_STREAM
+#define SPECTRUM_BINS   CONFIG_AUDIO_SPECTRUM_BINS
+_Static_assert(((FEATURE_COUNT / 2) % SPECTRUM_BINS) == 0,
+               "AUDIO_SPECTRUM_BINS must divide the feature frame size / 2");
+#endif
+
+#if CONFIG_AUDIO_RECORDER_ENABLE
+#define RECORDER_ENABLED    1
+#define RECORDER_LOUD_RMS   (CONFIG_AUDIO_RECORDER_LOUD_RMS_X1000 / 1000.0f)
+#else
+#define RECORDER_ENABLED    0
+#endif
+
+/*
+ * Approximate ZCR gate: a frame whose zero-crossing frequency lies this far
+ * outside the speech centroid band is classified as noise without an FFT.
+ */
+#define ZCR_GATE_MARGIN     2.0f
+#define ZCR_GATE_MIN_HZ     (SCENE_CENTROID_MIN / ZCR_GATE_MARGIN)
+#define ZCR_GATE_MAX_HZ     (SCENE_CENTROID_MAX * ZCR_GATE_MARGIN)
+
+#define CASCADE_LOG_FRAMES  1024
+
+#define FRAME_PERIOD_US     ((uint32_t)(1000000ULL * SAMPLE_COUNT / SAMPLE_RATE))
+
+#if CONFIG_AUDIO_DEADLINE_DEGRADE
+#define DEADLINE_HEADROOM_PCT   CONFIG_AUDIO_DEADLINE_HEADROOM_PCT
+#else
+#define DEADLINE_HEADROOM_PCT   0
+#endif
+
+#if CONFIG_SLM_WEIGHTING_C
+#define SLM_WEIGHTING   SOUND_LEVEL_WEIGHTING_C
+#elif CONFIG_SLM_WEIGHTING_Z
+#define SLM_WEIGHTING   SOUND_LEVEL_WEIGHTING_Z
+#else
+#define SLM_WEIGHTING   SOUND_LEVEL_WEIGHTING_A
+#endif
+
+#define ENVELOPE_POINTS AUDIO_FRAME_MAX_ENVELOPE_POINTS
+_Static_assert((SAMPLE_COUNT % ENVELOPE_POINTS) == 0,
+               "ENVELOPE_POINTS must divide SAMPLE_COUNT");
 
 static const char *TAG = "sample_process";
 
-// External queue handle                                
+// External queue handles                                
 // Defined and created in main.c 
 extern QueueHandle_t audio_frame_queue;
+extern QueueHandle_t scene_event_queue;
+
+// Streams requested by consumers (AUDIO_STREAM_* bits). Written by the
+// transport side, read once per frame here; a 32-bit store is atomic.
+static volatile uint32_t s_stream_mask = 0;
+
+void sample_process_set_streams(uint32_t stream_mask)
+{
+    s_stream_mask = stream_mask;
+}
+
+/*
+ * Frame consumers. Entries are written before the count is published;
+ * only their stream masks change afterwards. Counters are written by the
+ * processing task alone.
+ */
+typedef struct {
+    char name[SAMPLE_PROCESS_SINK_NAME_LEN];
+    QueueHandle_t queue;
+    volatile uint32_t streams;
+    sample_process_drop_policy_t policy;
+    uint32_t depth;
+    uint32_t posted;
+    uint32_t dropped;
+    uint32_t evicted;
+    uint32_t max_waiting;
+} frame_sink_t;
+
+// audio_frame_queue; gets every frame whatever the stream selection
+static frame_sink_t s_primary;
+
+static frame_sink_t s_sinks[SAMPLE_PROCESS_MAX_SINKS];
+static uint32_t s_sink_count = 0;
+static volatile uint32_t s_sink_streams = 0;
+static portMUX_TYPE s_sink_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void sink_init(frame_sink_t *sink, QueueHandle_t queue, const char *name,
+                      uint32_t streams, sample_process_drop_policy_t policy)
+{
+    memset(sink, 0, sizeof(*sink));
+    strlcpy(sink->name, name ? name : "sink", sizeof(sink->name));
+    sink->queue   = queue;
+    sink->streams = streams;
+    sink->policy  = policy;
+    sink->depth   = uxQueueSpacesAvailable(queue) + uxQueueMessagesWaiting(queue);
+}
+
+esp_err_t sample_process_add_sink(QueueHandle_t queue, const char *name, uint32_t streams,
+                                  sample_process_drop_policy_t policy)
+{
+    if (!queue) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    frame_sink_t sink;
+    sink_init(&sink, queue, name, streams, policy);
+
+    esp_err_t err = ESP_OK;
+    taskENTER_CRITICAL(&s_sink_mux);
+    if (s_sink_count < SAMPLE_PROCESS_MAX_SINKS) {
+        s_sinks[s_sink_count] = sink;
+        s_sink_streams |= streams;
+        __atomic_store_n(&s_sink_count, s_sink_count + 1, __ATOMIC_RELEASE);
+    } else {
+        err = ESP_ERR_NO_MEM;
+    }
+    taskEXIT_CRITICAL(&s_sink_mux);
+    return err;
+}
+
+esp_err_t sample_process_set_sink_streams(QueueHandle_t queue, uint32_t streams)
+{
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    uint32_t all = 0;
+
+    taskENTER_CRITICAL(&s_sink_mux);
+    for (uint32_t i = 0; i < s_sink_count; i++) {
+        if (s_sinks[i].queue == queue) {
+            s_sinks[i].streams = streams;
+            err = ESP_OK;
+        }
+        all |= s_sinks[i].streams;
+    }
+    s_sink_streams = all;
+    taskEXIT_CRITICAL(&s_sink_mux);
+    return err;
+}
+
+static void sink_copy_stats(const frame_sink_t *sink, sample_process_sink_stats_t *out)
+{
+    strlcpy(out->name, sink->name, sizeof(out->name));
+    out->streams     = sink->streams;
+    out->policy      = sink->policy;
+    out->depth       = sink->depth;
+    out->posted      = sink->posted;
+    out->dropped     = sink->dropped;
+    out->evicted     = sink->evicted;
+    out->max_waiting = sink->max_waiting;
+}
+
+size_t sample_process_get_sink_stats(sample_process_sink_stats_t *out, size_t max)
+{
+    const uint32_t sink_count = __atomic_load_n(&s_sink_count, __ATOMIC_ACQUIRE);
+    size_t n = 0;
+
+    if (s_primary.queue && n < max) {
+        sink_copy_stats(&s_primary, &out[n++]);
+    }
+    for (uint32_t i = 0; i < sink_count && n < max; i++) {
+        sink_copy_stats(&s_sinks[i], &out[n++]);
+    }
+    return n;
+}
+
+/*
+ * Each sink can hold its queue depth plus the frame in service, and one
+ * frame is being processed. Beyond the pool size a stalled sink can take
+ * the last free slot and every other sink loses frames with it.
+ */
+static void check_pool_budget(void)
+{
+    const uint32_t sink_count = __atomic_load_n(&s_sink_count, __ATOMIC_ACQUIRE);
+    uint32_t held = 1 + s_primary.depth + 1;
+
+    for (uint32_t i = 0; i < sink_count; i++) {
+        held += s_sinks[i].depth + 1;
+    }
+    if (held > CONFIG_AUDIO_FRAME_POOL_SIZE) {
+        ESP_LOGW(TAG, "Sinks can hold %u frames, pool has %d: a stalled sink can "
+                 "starve the others (raise AUDIO_FRAME_POOL_SIZE)",
+                 (unsigned)held, CONFIG_AUDIO_FRAME_POOL_SIZE);
+    }
+}
+
+/*
+ * Post one reference to a consumer queue without blocking; a full queue
+ * only costs that consumer a frame. Returns false when the sink lost one,
+ * either the new frame or, with SAMPLE_PROCESS_DROP_OLDEST, a queued one.
+ */
+static bool post_frame(frame_sink_t *sink, audio_frame_t *frame)
+{
+    audio_frame_retain(frame);
+    bool queued = xQueueSend(sink->queue, &frame, 0) == pdTRUE;
+    bool evicted = false;
+
+    if (!queued && sink->policy == SAMPLE_PROCESS_DROP_OLDEST) {
+        // The consumer may take the head first; then the retry just succeeds
+        audio_frame_t *oldest;
+        if (xQueueReceive(sink->queue, &oldest, 0) == pdTRUE) {
+            audio_frame_release(oldest);
+            sink->evicted++;
+            evicted = true;
+        }
+        queued = xQueueSend(sink->queue, &frame, 0) == pdTRUE;
+    }
+
+    if (!queued) {
+        audio_frame_release(frame);
+        sink->dropped++;
+        return false;
+    }
+
+    sink->posted++;
+    uint32_t waiting = uxQueueMessagesWaiting(sink->queue);
+    if (waiting > sink->max_waiting) {
+        sink->max_waiting = waiting;
+    }
+    return !evicted;
+}
+
+// Written only by the processing task; readers copy word by word
+static volatile sample_cascade_stats_t s_cascade;
+
+// Written only by the processing task; readers may see a frame in progress
+static deadline_monitor_t s_deadline;
+
+void sample_process_get_deadline_stats(deadline_stats_t *out)
+{
+    memcpy(out, (const void *)&s_deadline.st, sizeof(*out));
+}
+
+// Updated once per frame by the processing task; copied whole by readers
+static feature_stats_t s_stats;
+static portMUX_TYPE s_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void sample_process_get_feature_stats(feature_stats_t *out)
+{
+    taskENTER_CRITICAL(&s_stats_mux);
+    memcpy(out, &s_stats, sizeof(*out));
+    taskEXIT_CRITICAL(&s_stats_mux);
+}
 
-// Utility functions                                   
+void sample_process_get_cascade_stats(sample_cascade_stats_t *out)
+{
+    out->frames           = s_cascade.frames;
+    out->rms_decided      = s_cascade.rms_decided;
+    out->zcr_decided      = s_cascade.zcr_decided;
+    out->fft_decided      = s_cascade.fft_decided;
+    out->fft_for_spectrum = s_cascade.fft_for_spectrum;
+}
+
+
+// Stage graph; built once by the processing task, timing read by anyone
+static pipeline_graph_t s_graph;
+
+#define MAX_EXTRA_STAGES    4
+
+// Stages registered by other components before the task starts
+static const pipeline_stage_t *s_extra_stages[MAX_EXTRA_STAGES];
+static int s_extra_stage_count = 0;
+
+esp_err_t sample_process_add_stage(const pipeline_stage_t *stage)
+{
+    if (!stage || !stage->process) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_extra_stage_count >= MAX_EXTRA_STAGES) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_extra_stages[s_extra_stage_count++] = stage;
+    return ESP_OK;
+}
+
+size_t sample_process_get_stage_stats(pipeline_stage_stats_t *out, size_t max)
+{
+    return pipeline_graph_get_stats(&s_graph, out, max);
+}
+
+// Debounced scene detection + gain smoothing; the cascade reads its state
+static scene_detector_t s_detector;
+
+/*
+ * Feature stages read the decimated or filtered block. Without either it is
+ * the captured block itself, so they must also wait for stages that
+ * condition the captured block in place.
+ */
+#if DECIMATION > 1 || CONFIG_AUDIO_FILTER_ENABLE
+#define BUF_FEATURE_SAMPLES     PIPELINE_BUF_FEATURE_SAMPLES
+#else
+#define BUF_FEATURE_SAMPLES     PIPELINE_BUF_SAMPLES
+#endif
+
+// Utility functions
 static inline int16_t clamp_int16(int32_t x)
 {
     if (x > 32767) return 32767;
@@ -57,98 +357,777 @@ static inline int16_t convert_32_to_16(int32_t x)
     return clamp_int16(x >> 8);
 }
 
-// Processing Task                                    
+static inline int32_t apply_gain_32(int32_t x, float gain)
+{
+    int64_t scaled = (int64_t)(x * gain);
+    if (scaled > INT32_MAX) scaled = INT32_MAX;
+    if (scaled < INT32_MIN) scaled = INT32_MIN;
+    return (int32_t)scaled;
+}
+
+/*
+ * Min/max envelope of the gain-adjusted int16 output, computed from the raw
+ * samples. Gain is positive, so scaling the extremes gives the same result as
+ * scaling every sample first.
+ */
+static void compute_envelope(const int32_t *raw, float gain, int16_t *minmax)
+{
+    const size_t span = SAMPLE_COUNT / ENVELOPE_POINTS;
+
+    for (size_t p = 0; p < ENVELOPE_POINTS; p++) {
+        const int32_t *s = raw + p * span;
+        int32_t lo = s[0];
+        int32_t hi = s[0];
+        for (size_t i = 1; i < span; i++) {
+            if (s[i] < lo) lo = s[i];
+            if (s[i] > hi) hi = s[i];
+        }
+        minmax[2 * p]     = convert_32_to_16(apply_gain_32(lo, gain));
+        minmax[2 * p + 1] = convert_32_to_16(apply_gain_32(hi, gain));
+    }
+}
+
+// Stages, in the order of the default graph
+
+#if DECIMATION > 1
+// Anti-alias FIR and its history, private to the processing task
+static fir_decimator_t s_decimator;
+
+static esp_err_t decimate_init(pipeline_ctx_t *ctx)
+{
+    ctx->feature_samples = heap_caps_malloc(
+        FEATURE_COUNT * sizeof(int32_t), MALLOC_CAP_8BIT);
+    if (!ctx->feature_samples ||
+        fir_decimator_init(&s_decimator, DECIMATION, SAMPLE_COUNT) != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Features at %d Hz (%dx decimation, %d taps)",
+             FEATURE_RATE, DECIMATION, s_decimator.taps);
+    return ESP_OK;
+}
+
+// Features see the band they need at the reduced rate; streams keep the full rate
+static pipeline_result_t decimate_process(pipeline_ctx_t *ctx)
+{
+    fir_decimator_process(&s_decimator, ctx->samples, ctx->feature_samples);
+    return PIPELINE_CONTINUE;
+}
+
+static const pipeline_stage_t s_decimate_stage = {
+    .name    = "decimate",
+    .inputs  = PIPELINE_BUF_SAMPLES,
+    .outputs = PIPELINE_BUF_FEATURE_SAMPLES,
+    .init    = decimate_init,
+    .process = decimate_process,
+};
+#endif
+
+#if CONFIG_AUDIO_FILTER_ENABLE
+// Input conditioning; coefficients fixed at startup, state carried across frames
+static biquad_chain_t s_filter;
+
+/*
+ * The filter only conditions what the features see, at the feature rate.
+ * Without decimation it works on its own copy of the captured block, so the
+ * PCM streams, the recorder and the sound level meter keep the raw input.
+ */
+#if DECIMATION > 1
+#define FILTER_INPUTS   PIPELINE_BUF_FEATURE_SAMPLES
+#else
+#define FILTER_INPUTS   PIPELINE_BUF_SAMPLES
+#endif
+
+static esp_err_t filter_init(pipeline_ctx_t *ctx)
+{
+#if DECIMATION == 1
+    ctx->feature_samples = heap_caps_malloc(
+        FEATURE_COUNT * sizeof(int32_t), MALLOC_CAP_8BIT);
+    if (!ctx->feature_samples) {
+        return ESP_ERR_NO_MEM;
+    }
+#endif
+    biquad_chain_init(&s_filter, FEATURE_RATE);
+
+    esp_err_t err = ESP_OK;
+    if (CONFIG_AUDIO_FILTER_HPF_HZ > 0) {
+        int order = (CONFIG_AUDIO_FILTER_HPF_ORDER + 1) & ~1;
+        err = biquad_chain_add_highpass(&s_filter, CONFIG_AUDIO_FILTER_HPF_HZ, order);
+        if (err != ESP_OK) ESP_LOGW(TAG, "High-pass not added: %s", esp_err_to_name(err));
+    }
+    if (CONFIG_AUDIO_FILTER_NOTCH_HZ > 0) {
+        err = biquad_chain_add(&s_filter, BIQUAD_NOTCH, CONFIG_AUDIO_FILTER_NOTCH_HZ,
+                               CONFIG_AUDIO_FILTER_NOTCH_Q_X10 / 10.0f);
+        if (err != ESP_OK) ESP_LOGW(TAG, "Notch not added: %s", esp_err_to_name(err));
+    }
+    if (CONFIG_AUDIO_FILTER_BANDPASS_HZ > 0) {
+        err = biquad_chain_add(&s_filter, BIQUAD_BANDPASS, CONFIG_AUDIO_FILTER_BANDPASS_HZ,
+                               CONFIG_AUDIO_FILTER_BANDPASS_Q_X100 / 100.0f);
+        if (err != ESP_OK) ESP_LOGW(TAG, "Band-pass not added: %s", esp_err_to_name(err));
+    }
+    ESP_LOGI(TAG, "Input filter: %d biquad sections", s_filter.section_count);
+
+#if CONFIG_AUDIO_FILTER_BENCHMARK
+    uint32_t cycles[BIQUAD_CHAIN_MAX_SECTIONS];
+    if (biquad_chain_benchmark(FEATURE_RATE, FEATURE_COUNT, 64, cycles) == ESP_OK) {
+        for (int i = 0; i < BIQUAD_CHAIN_MAX_SECTIONS; i++) {
+            ESP_LOGI(TAG, "filter %d section(s): %u cycles/frame, %u us (%.1f%% of %u us)",
+                     i + 1, (unsigned)cycles[i],
+                     (unsigned)(cycles[i] / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ),
+                     100.0f * cycles[i] / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ / FRAME_PERIOD_US,
+                     (unsigned)FRAME_PERIOD_US);
+        }
+    }
+#endif
+    return ESP_OK;
+}
+
+// Condition the feature block once; every feature below sees it
+static pipeline_result_t filter_process(pipeline_ctx_t *ctx)
+{
+#if DECIMATION == 1
+    memcpy(ctx->feature_samples, ctx->samples, ctx->feature_count * sizeof(int32_t));
+#endif
+    biquad_chain_process(&s_filter, ctx->feature_samples, ctx->feature_count);
+    return PIPELINE_CONTINUE;
+}
+
+static const pipeline_stage_t s_filter_stage = {
+    .name    = "filter",
+    .inputs  = FILTER_INPUTS,
+    .outputs = PIPELINE_BUF_FEATURE_SAMPLES,
+    .init    = filter_init,
+    .process = filter_process,
+};
+#endif
+
+/*
+ * Feature extraction, cheapest stage first:
+ *   a) RMS settles quiet / loud frames on its own
+ *   b) optional zero-crossing gate rules out speech
+ *   c) FFT centroid only when it can still change the label
+ */
+static pipeline_result_t rms_process(pipeline_ctx_t *ctx)
+{
+#if CONFIG_DSP_FIXED_POINT
+    ctx->rms = dsp_compute_rms_q31(ctx->feature_samples, ctx->feature_count);
+#else
+    ctx->rms = dsp_compute_rms(ctx->feature_samples, ctx->feature_count);
+#endif
+    return PIPELINE_CONTINUE;
+}
+
+static const pipeline_stage_t s_rms_stage = {
+    .name    = "rms",
+    .inputs  = BUF_FEATURE_SAMPLES,
+    .outputs = PIPELINE_BUF_FEATURES,
+    .process = rms_process,
+};
+
+#if CONFIG_SLM_ENABLE
+// Meter state is private to the processing task; readers get the published copy
+static sound_level_meter_t s_meter;
+static sound_level_stats_t s_level;
+static portMUX_TYPE s_level_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static esp_err_t level_init(pipeline_ctx_t *ctx)
+{
+    sound_level_init(&s_meter, SAMPLE_RATE, SLM_WEIGHTING,
+                     CONFIG_SLM_MIC_SENSITIVITY_DBFS_X10 / 10.0f, CONFIG_SLM_INTERVAL_S);
+
+#if CONFIG_SLM_BENCHMARK
+    // The 48 kHz frame is the worst case the meter has to keep up with
+    static const int rates[] = { SAMPLE_RATE, 48000 };
+    uint32_t cycles[SOUND_LEVEL_WEIGHTING_COUNT];
+    for (int r = 0; r < (SAMPLE_RATE < 48000 ? 2 : 1); r++) {
+        size_t count = (size_t)rates[r] * FRAME_PERIOD_US / 1000000;
+        if (sound_level_benchmark(rates[r], count, 64, cycles) != ESP_OK) continue;
+        for (int w = 0; w < SOUND_LEVEL_WEIGHTING_COUNT; w++) {
+            ESP_LOGI(TAG, "level %s @ %d Hz: %u cycles/frame, %u us (%.1f%% of %u us)",
+                     sound_level_weighting_name((sound_level_weighting_t)w), rates[r],
+                     (unsigned)cycles[w],
+                     (unsigned)(cycles[w] / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ),
+                     100.0f * cycles[w] / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ / FRAME_PERIOD_US,
+                     (unsigned)FRAME_PERIOD_US);
+        }
+    }
+#endif
+    return ESP_OK;
+}
+
+// Weighted SPL on every sample, fixed point
+static pipeline_result_t level_process(pipeline_ctx_t *ctx)
+{
+    if (sound_level_process(&s_meter, ctx->samples, ctx->sample_count)) {
+        ESP_LOGD(TAG, "L%seq %.1f dB, max %.1f, min %.1f",
+                 sound_level_weighting_name(SLM_WEIGHTING), s_meter.st.leq_db,
+                 s_meter.st.lmax_db, s_meter.st.lmin_db);
+    }
+    taskENTER_CRITICAL(&s_level_mux);
+    s_level = s_meter.st;
+    taskEXIT_CRITICAL(&s_level_mux);
+    return PIPELINE_CONTINUE;
+}
+
+static const pipeline_stage_t s_level_stage = {
+    .name    = "level",
+    .inputs  = PIPELINE_BUF_SAMPLES,
+    .outputs = 0,
+    .init    = level_init,
+    .process = level_process,
+};
+#endif
+
+bool sample_process_get_sound_level(sound_level_stats_t *out)
+{
+#if CONFIG_SLM_ENABLE
+    taskENTER_CRITICAL(&s_level_mux);
+    *out = s_level;
+    taskEXIT_CRITICAL(&s_level_mux);
+    return true;
+#else
+    return false;
+#endif
+}
+
+static pipeline_result_t cascade_process(pipeline_ctx_t *ctx)
+{
+    ctx->need_fft = scene_detector_needs_centroid(&s_detector, ctx->rms);
+
+    s_cascade.frames++;
+    if (!ctx->need_fft) {
+        s_cascade.rms_decided++;
+    }
+#if CONFIG_AUDIO_CASCADE_ZCR_GATE
+    else {
+        float zcr_hz = dsp_compute_zcr(ctx->feature_samples, ctx->feature_count) *
+                       ctx->feature_rate / 2;
+        if (zcr_hz < ZCR_GATE_MIN_HZ || zcr_hz > ZCR_GATE_MAX_HZ) {
+            ctx->need_fft = false;
+            s_cascade.zcr_decided++;
+        }
+    }
+#endif
+    if (ctx->need_fft) {
+        s_cascade.fft_decided++;
+    }
+    return PIPELINE_CONTINUE;
+}
+
+static const pipeline_stage_t s_cascade_stage = {
+    .name    = "cascade",
+    .inputs  = PIPELINE_BUF_FEATURES | BUF_FEATURE_SAMPLES,
+    .outputs = PIPELINE_BUF_FEATURES,
+    .process = cascade_process,
+};
+
+// FFT work buffer, allocated once instead of per frame; private to the processing task
+static dsp_fft_scratch_t s_fft_scratch;
+
+#if CONFIG_AUDIO_SPECTRAL_FEATURES
+// Previous spectrum for the flux; private to the processing task
+static dsp_spectral_state_t s_spectral_state;
+#endif
+
+// One FFT feeds the centroid, the spectral features and the spectrum stream
+static pipeline_result_t fft_process(pipeline_ctx_t *ctx)
+{
+    float *spectrum_out = ctx->spectrum;
+
+    if (ctx->need_fft || spectrum_out) {
+        if (ctx->rms > 1e-6f) {
+#if CONFIG_DSP_FIXED_POINT
+            ctx->centroid = dsp_compute_spectral_centroid_sc16(
+                ctx->feature_samples, ctx->feature_count, ctx->feature_rate,
+                &s_fft_scratch, spectrum_out);
+#elif CONFIG_AUDIO_SPECTRAL_FEATURES
+            ctx->centroid = 0.0f;
+            if (dsp_compute_spectral_features_fft(ctx->feature_samples, ctx->feature_count,
+                                                  ctx->feature_rate, &s_fft_scratch, spectrum_out,
+                                                  &s_spectral_state, &ctx->spectral)) {
+                ctx->centroid = ctx->spectral.centroid_hz;
+                ctx->flags |= AUDIO_FRAME_FLAG_SPECTRAL;
+            }
+#else
+            ctx->centroid = dsp_compute_spectral_centroid_fft(
+                ctx->feature_samples, ctx->feature_count, ctx->feature_rate,
+                &s_fft_scratch, spectrum_out);
+#endif
+        } else {
+            ctx->centroid = 0.0f;
+            if (spectrum_out) {
+                memset(spectrum_out, 0, (ctx->feature_count / 2) * sizeof(float));
+            }
+        }
+        if (!ctx->need_fft) {
+            s_cascade.fft_for_spectrum++;
+        }
+    }
+#if CONFIG_AUDIO_SPECTRAL_FEATURES
+    // Flux only compares consecutive spectra
+    if (!(ctx->flags & AUDIO_FRAME_FLAG_SPECTRAL)) {
+        s_spectral_state.valid = false;
+    }
+#endif
+
+    if ((s_cascade.frames % CASCADE_LOG_FRAMES) == 0) {
+        ESP_LOGD(TAG, "cascade: %u frames, rms %u, zcr %u, fft %u, spectrum-only %u",
+                 (unsigned)s_cascade.frames, (unsigned)s_cascade.rms_decided,
+                 (unsigned)s_cascade.zcr_decided, (unsigned)s_cascade.fft_decided,
+                 (unsigned)s_cascade.fft_for_spectrum);
+    }
+    return PIPELINE_CONTINUE;
+}
+
+static const pipeline_stage_t s_fft_stage = {
+    .name    = "fft",
+    .inputs  = PIPELINE_BUF_FEATURES | BUF_FEATURE_SAMPLES,
+    .outputs = PIPELINE_BUF_FEATURES | PIPELINE_BUF_SPECTRUM,
+    .process = fft_process,
+};
+
+static esp_err_t classify_init(pipeline_ctx_t *ctx)
+{
+    scene_detector_config_t detector_cfg;
+    scene_detector_default_config(&detector_cfg, SAMPLE_RATE, SAMPLE_COUNT);
+    scene_detector_init(&s_detector, &detector_cfg, SAMPLE_RATE, SAMPLE_COUNT);
+    return ESP_OK;
+}
+
+// Scene classification (hysteresis + minimum dwell)
+static pipeline_result_t classify_process(pipeline_ctx_t *ctx)
+{
+    scene_event_t event;
+    ctx->scene_changed = scene_detector_update(&s_detector, ctx->rms, ctx->centroid,
+                                               ctx->capture_us, &event);
+    if (ctx->scene_changed) {
+        ctx->flags |= AUDIO_FRAME_FLAG_SCENE_CHANGE;
+        if (xQueueSend(scene_event_queue, &event, 0) != pdTRUE) {
+            ESP_LOGW(TAG, "Scene event queue full, event dropped");
+            metrics_inc(METRIC_SCENE_EVENTS_DROPPED);
+        }
+    }
+
+    ctx->scene = s_detector.scene;
+    ctx->gain  = s_detector.gain;
+    return PIPELINE_CONTINUE;
+}
+
+static const pipeline_stage_t s_classify_stage = {
+    .name    = "classify",
+    .inputs  = PIPELINE_BUF_FEATURES,
+    .outputs = PIPELINE_BUF_SCENE,
+    .init    = classify_init,
+    .process = classify_process,
+};
+
+// Long-term aggregates: O(1) per frame, merges only when a window closes
+static pipeline_result_t stats_process(pipeline_ctx_t *ctx)
+{
+    const float centroid = isnan(ctx->centroid) ? 0.0f : ctx->centroid;
+
+    taskENTER_CRITICAL(&s_stats_mux);
+    feature_stats_frame(&s_stats, ctx->timestamp_us, ctx->rms, centroid, (int)ctx->scene);
+    taskEXIT_CRITICAL(&s_stats_mux);
+
+#if CONFIG_FEATURE_LOG_ENABLE
+    // Queued for the flash writer; compression and I/O happen there
+    feature_record_t record = {
+        .timestamp_us = ctx->timestamp_us,
+        .rms          = ctx->rms,
+        .centroid     = centroid,
+        .scene        = (uint8_t)ctx->scene,
+    };
+    feature_log_append(&record);
+#endif
+    return PIPELINE_CONTINUE;
+}
+
+static const pipeline_stage_t s_stats_stage = {
+    .name    = "stats",
+    .inputs  = PIPELINE_BUF_FEATURES | PIPELINE_BUF_SCENE,
+    .outputs = 0,
+    .process = stats_process,
+};
+
+static pipeline_result_t package_process(pipeline_ctx_t *ctx)
+{
+    audio_frame_t *frame = audio_frame_alloc();
+    if (!frame) {
+        // Every pool slot is still held by a consumer; only the stages that
+        // fill or publish the frame are skipped, the recorder still runs
+        ESP_LOGW(TAG, "Frame pool exhausted");
+        metrics_inc(METRIC_FRAMES_ALLOC_FAILED);
+        return PIPELINE_SKIP_OUTPUTS;
+    }
+
+    frame->magic        = AUDIO_FRAME_MAGIC;
+    frame->sample_count = ctx->sample_count;
+    frame->sequence     = ctx->sequence;
+    frame->flags        = ctx->flags;
+    frame->sample_index = ctx->sample_index;
+    frame->timestamp_us = ctx->timestamp_us;
+    frame->rms          = ctx->rms;
+    frame->centroid     = isnan(ctx->centroid) ? 0.0f : ctx->centroid;  // 0 = not computed
+    frame->spectral     = ctx->spectral;
+    frame->gain         = ctx->gain;
+    frame->scene        = ctx->scene;
+
+    ctx->frame = frame;
+    return PIPELINE_CONTINUE;
+}
+
+static const pipeline_stage_t s_package_stage = {
+    .name    = "package",
+    .inputs  = PIPELINE_BUF_FEATURES | PIPELINE_BUF_SCENE,
+    .outputs = PIPELINE_BUF_FRAME,
+    .process = package_process,
+};
+
+static int16_t *s_pcm16_buf;
+
+static esp_err_t pcm16_init(pipeline_ctx_t *ctx)
+{
+    s_pcm16_buf = heap_caps_malloc(SAMPLE_COUNT * sizeof(int16_t), MALLOC_CAP_8BIT);
+    return s_pcm16_buf ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+// Convert to int16 for transport / recorder, only when needed
+static pipeline_result_t pcm16_process(pipeline_ctx_t *ctx)
+{
+    if ((ctx->streams & AUDIO_STREAM_RAW) || RECORDER_ENABLED) {
+        for (size_t i = 0; i < ctx->sample_count; i++) {
+            s_pcm16_buf[i] = convert_32_to_16(ctx->samples[i]);
+        }
+        ctx->pcm16 = s_pcm16_buf;
+    }
+    return PIPELINE_CONTINUE;
+}
+
+static const pipeline_stage_t s_pcm16_stage = {
+    .name    = "pcm16",
+    .inputs  = PIPELINE_BUF_SAMPLES,
+    .outputs = PIPELINE_BUF_PCM16,
+    .init    = pcm16_init,
+    .process = pcm16_process,
+};
+
+#if CONFIG_AUDIO_RECORDER_ENABLE
+static esp_err_t recorder_init(pipeline_ctx_t *ctx)
+{
+    if (flight_recorder_init(SAMPLE_RATE, SAMPLE_COUNT) != ESP_OK) {
+        ESP_LOGW(TAG, "Flight recorder disabled");
+    }
+    return ESP_OK;
+}
+
+static pipeline_result_t recorder_process(pipeline_ctx_t *ctx)
+{
+    if (ctx->scene_changed) {
+        flight_recorder_trigger(RECORDER_CAUSE_SCENE_CHANGE);
+    } else if (ctx->rms >= RECORDER_LOUD_RMS) {
+        flight_recorder_trigger(RECORDER_CAUSE_LOUD);
+    }
+    flight_recorder_write(ctx->pcm16);
+    return PIPELINE_CONTINUE;
+}
+
+static const pipeline_stage_t s_recorder_stage = {
+    .name    = "recorder",
+    .inputs  = PIPELINE_BUF_PCM16 | PIPELINE_BUF_FEATURES | PIPELINE_BUF_SCENE,
+    .outputs = 0,
+    .init    = recorder_init,
+    .process = recorder_process,
+};
+#endif
+
+static pipeline_result_t raw_process(pipeline_ctx_t *ctx)
+{
+    if (ctx->streams & AUDIO_STREAM_RAW) {
+        audio_frame_t *frame = ctx->frame;
+        frame->samples_in = audio_frame_payload(frame, AUDIO_STREAM_RAW);
+        memcpy(frame->samples_in, ctx->pcm16, ctx->sample_count * sizeof(int16_t));
+    }
+    return PIPELINE_CONTINUE;
+}
+
+static const pipeline_stage_t s_raw_stage = {
+    .name    = "raw",
+    .inputs  = PIPELINE_BUF_PCM16 | PIPELINE_BUF_FRAME,
+    .outputs = PIPELINE_BUF_FRAME,
+    .process = raw_process,
+};
+
+static int32_t *s_proc_buf;
+
+static esp_err_t gain_init(pipeline_ctx_t *ctx)
+{
+    s_proc_buf = heap_caps_malloc(SAMPLE_COUNT * sizeof(int32_t), MALLOC_CAP_8BIT);
+    return s_proc_buf ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+static pipeline_result_t gain_process(pipeline_ctx_t *ctx)
+{
+    if (ctx->streams & AUDIO_STREAM_PROC) {
+        audio_frame_t *frame = ctx->frame;
+        frame->samples_out = audio_frame_payload(frame, AUDIO_STREAM_PROC);
+        memcpy(s_proc_buf, ctx->samples, ctx->sample_count * sizeof(int32_t));
+#if CONFIG_DSP_FIXED_POINT
+        dsp_apply_gain_q15(s_proc_buf, ctx->sample_count, dsp_gain_to_q15(ctx->gain));
+#else
+        dsp_apply_gain(s_proc_buf, ctx->sample_count, ctx->gain);
+#endif
+        for (size_t i = 0; i < ctx->sample_count; i++) {
+            frame->samples_out[i] = convert_32_to_16(s_proc_buf[i]);
+        }
+    }
+    return PIPELINE_CONTINUE;
+}
+
+static const pipeline_stage_t s_gain_stage = {
+    .name    = "gain",
+    .inputs  = PIPELINE_BUF_SAMPLES | PIPELINE_BUF_SCENE | PIPELINE_BUF_FRAME,
+    .outputs = PIPELINE_BUF_FRAME,
+    .init    = gain_init,
+    .process = gain_process,
+};
+
+static pipeline_result_t envelope_process(pipeline_ctx_t *ctx)
+{
+    if (ctx->streams & AUDIO_STREAM_ENVELOPE) {
+        audio_frame_t *frame = ctx->frame;
+        frame->envelope = audio_frame_payload(frame, AUDIO_STREAM_ENVELOPE);
+        compute_envelope(ctx->samples, ctx->gain, frame->envelope);
+        frame->envelope_points = ENVELOPE_POINTS;
+    }
+    return PIPELINE_CONTINUE;
+}
+
+static const pipeline_stage_t s_envelope_stage = {
+    .name    = "envelope",
+    .inputs  = PIPELINE_BUF_SAMPLES | PIPELINE_BUF_SCENE | PIPELINE_BUF_FRAME,
+    .outputs = PIPELINE_BUF_FRAME,
+    .process = envelope_process,
+};
+
+#if CONFIG_AUDIO_SPECTRUM_STREAM
+// Reuse the centroid FFT; silent frames quantize to the floor
+static pipeline_result_t spectrum_process(pipeline_ctx_t *ctx)
+{
+    if (ctx->spectrum) {
+        audio_frame_t *frame = ctx->frame;
+        frame->spectrum = audio_frame_payload(frame, AUDIO_STREAM_SPECTRUM);
+        dsp_quantize_spectrum_u8(ctx->spectrum, ctx->feature_count / 2, ctx->feature_count,
+                                 frame->spectrum, SPECTRUM_BINS);
+        frame->spectrum_bins   = SPECTRUM_BINS;
+        frame->spectrum_bin_hz = (float)ctx->feature_rate / 2.0f / SPECTRUM_BINS;
+    }
+    return PIPELINE_CONTINUE;
+}
+
+static const pipeline_stage_t s_spectrum_stage = {
+    .name    = "spectrum",
+    .inputs  = PIPELINE_BUF_SPECTRUM | PIPELINE_BUF_FRAME,
+    .outputs = PIPELINE_BUF_FRAME,
+    .process = spectrum_process,
+};
+#endif
+
+// Share the frame with every consumer; a slow one only drops its own copy
+static pipeline_result_t publish_process(pipeline_ctx_t *ctx)
+{
+    audio_frame_t *frame = ctx->frame;
+
+    if (!post_frame(&s_primary, frame)) {
+        metrics_inc(METRIC_FRAMES_QUEUE_DROPPED);
+    }
+    const uint32_t sink_count = __atomic_load_n(&s_sink_count, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < sink_count; i++) {
+        if (s_sinks[i].streams && !post_frame(&s_sinks[i], frame)) {
+            metrics_inc(METRIC_SINK_FRAMES_DROPPED);
+        }
+    }
+    audio_frame_release(frame);
+    ctx->frame = NULL;
+    metrics_inc(METRIC_FRAMES_PROCESSED);
+    return PIPELINE_CONTINUE;
+}
+
+static const pipeline_stage_t s_publish_stage = {
+    .name    = "publish",
+    .inputs  = PIPELINE_BUF_FRAME,
+    .outputs = 0,
+    .process = publish_process,
+};
+
+// Current behaviour as a graph; stages compiled out by Kconfig are simply absent
+static const pipeline_stage_t *const DEFAULT_GRAPH[] = {
+#if DECIMATION > 1
+    &s_decimate_stage,
+#endif
+#if CONFIG_AUDIO_FILTER_ENABLE
+    &s_filter_stage,
+#endif
+    &s_rms_stage,
+#if CONFIG_SLM_ENABLE
+    &s_level_stage,
+#endif
+    &s_cascade_stage,
+    &s_fft_stage,
+    &s_classify_stage,
+    &s_stats_stage,
+    &s_package_stage,
+    &s_pcm16_stage,
+#if CONFIG_AUDIO_RECORDER_ENABLE
+    &s_recorder_stage,
+#endif
+    &s_raw_stage,
+    &s_gain_stage,
+    &s_envelope_stage,
+#if CONFIG_AUDIO_SPECTRUM_STREAM
+    &s_spectrum_stage,
+#endif
+    &s_publish_stage,
+};
+
+// Processing Task
 void sample_process_task(void *arg)
 {
+    if (audio_frame_pool_init() != ESP_OK) {
+        vTaskDelete(NULL);
+        return;
+    }
+
     ESP_LOGI(TAG, "Initializing microphone input...");
     mic_input_init();
 
-    // Allocate persistent buffers
-    int32_t *raw_buf  = heap_caps_malloc(
-        SAMPLE_COUNT * sizeof(int32_t), MALLOC_CAP_8BIT);
-    int32_t *proc_buf = heap_caps_malloc(
+    // Capture buffer; everything else is owned by the stage that produces it
+    int32_t *raw_buf = heap_caps_malloc(
         SAMPLE_COUNT * sizeof(int32_t), MALLOC_CAP_8BIT);
+    if (!raw_buf) {
+        ESP_LOGE(TAG, "Buffer allocation failed");
+        vTaskDelete(NULL);
+        return;
+    }
 
-    int16_t *in16_buf  = heap_caps_malloc(
-        SAMPLE_COUNT * sizeof(int16_t), MALLOC_CAP_8BIT);
-    int16_t *out16_buf = heap_caps_malloc(
-        SAMPLE_COUNT * sizeof(int16_t), MALLOC_CAP_8BIT);
+#if CONFIG_AUDIO_SPECTRUM_STREAM
+    // Magnitude spectrum of the centroid FFT, kept for quantization
+    float *mag_buf = heap_caps_malloc(
+        (FEATURE_COUNT / 2) * sizeof(float), MALLOC_CAP_8BIT);
+    if (!mag_buf) {
+        ESP_LOGE(TAG, "Spectrum buffer allocation failed");
+        vTaskDelete(NULL);
+        return;
+    }
+#else
+    float *mag_buf = NULL;
+#endif
 
-    if (!raw_buf || !proc_buf || !in16_buf || !out16_buf) {
-        ESP_LOGE(TAG, "Buffer allocation failed");
+    pipeline_ctx_t ctx = {
+        .samples         = raw_buf,
+        .sample_count    = SAMPLE_COUNT,
+        .sample_rate     = SAMPLE_RATE,
+        .feature_samples = (DECIMATION > 1) ? NULL : raw_buf,
+        .feature_count   = FEATURE_COUNT,
+        .feature_rate    = FEATURE_RATE,
+    };
+
+    sink_init(&s_primary, audio_frame_queue, "websocket", 0,
+#if CONFIG_AUDIO_FRAME_QUEUE_DROP_OLDEST
+              SAMPLE_PROCESS_DROP_OLDEST);
+#else
+              SAMPLE_PROCESS_DROP_NEWEST);
+#endif
+    check_pool_budget();
+
+    deadline_monitor_init(&s_deadline, FRAME_PERIOD_US, DEADLINE_HEADROOM_PCT);
+    feature_stats_init(&s_stats, FRAME_PERIOD_US);
+
+    uint32_t provided = PIPELINE_BUF_SAMPLES;
+#if DECIMATION == 1 && !CONFIG_AUDIO_FILTER_ENABLE
+    provided |= PIPELINE_BUF_FEATURE_SAMPLES;
+#endif
+    pipeline_graph_init(&s_graph, provided);
+    for (size_t i = 0; i < sizeof(DEFAULT_GRAPH) / sizeof(DEFAULT_GRAPH[0]); i++) {
+        pipeline_graph_add(&s_graph, DEFAULT_GRAPH[i]);
+    }
+    for (int i = 0; i < s_extra_stage_count; i++) {
+        if (pipeline_graph_add(&s_graph, s_extra_stages[i]) != ESP_OK) {
+            ESP_LOGW(TAG, "Stage %s not added", s_extra_stages[i]->name);
+        }
+    }
+    if (pipeline_graph_build(&s_graph, &ctx) != ESP_OK) {
+        ESP_LOGE(TAG, "Pipeline graph setup failed");
         vTaskDelete(NULL);
         return;
     }
 
+    uint32_t sequence = 0;
+    uint64_t sample_pos = 0;    // samples read since capture start
+    int64_t stream_start_us = 0;  // esp_timer time of sample 0
+
     ESP_LOGI(TAG, "Sample processing task started");
 
     while (1) {
-        // 1. Acquire audio samples                                           
+        // 1. Acquire audio samples
         size_t n = mic_input_read(raw_buf, SAMPLE_COUNT);
+        sample_pos += n;
         if (n != SAMPLE_COUNT) {
             ESP_LOGW(TAG, "Short read: %d samples", n);
             continue;
         }
-
-        memcpy(proc_buf, raw_buf, SAMPLE_COUNT * sizeof(int32_t));
-
-        // 2. Feature extraction                                             
-        float rms = dsp_compute_rms(raw_buf, SAMPLE_COUNT);
-        float centroid = 0.0f;
-
-        if (rms > 1e-6f) {
-            centroid = dsp_compute_spectral_centroid_fft(
-                raw_buf, SAMPLE_COUNT, SAMPLE_RATE);
+        const int64_t capture_us = esp_timer_get_time();
+        if (!stream_start_us) {
+            stream_start_us = capture_us - FRAME_PERIOD_US;
         }
 
-        // 3. Scene classification                                           
-        audio_scene_t scene;
-        float gain;
+        // Full CPU speed while processing; DFS / light sleep until the next DMA buffer
+        power_manager_pipeline_begin();
 
-        if (rms < RMS_QUIET_TH) {
-            scene = SCENE_QUIET;
-            gain  = GAIN_QUIET;
-        }
-        else if (rms <= RMS_NOISE_TH &&
-                 centroid >= CENTROID_MIN &&
-                 centroid <= CENTROID_MAX) {
-            scene = SCENE_SPEECH;
-            gain  = GAIN_SPEECH;
-        }
-        else {
-            scene = SCENE_NOISE;
-            gain  = GAIN_NOISE;
+        // 2. Frame clock and per-frame results
+        ctx.sequence     = sequence++;
+        ctx.sample_index = sample_pos - SAMPLE_COUNT;
+        ctx.capture_us   = capture_us;
+        // Timestamps follow the sample clock, not read wake-ups, so DMA
+        // backlog does not smear them
+        ctx.timestamp_us = stream_start_us +
+            (int64_t)(ctx.sample_index * 1000000ULL / SAMPLE_RATE);
+        ctx.flags = 0;
+
+        // Snapshot once so the whole frame sees a consistent selection;
+        // degrade mode sheds the spectrum until headroom recovers
+        ctx.streams = s_stream_mask | s_sink_streams;
+        if (s_deadline.st.degraded) {
+            ctx.streams &= ~AUDIO_STREAM_SPECTRUM;
+            ctx.flags |= AUDIO_FRAME_FLAG_DEGRADED;
         }
+        ctx.spectrum = (ctx.streams & AUDIO_STREAM_SPECTRUM) ? mag_buf : NULL;
 
-        // 4. Apply gain                                                     
-        dsp_apply_gain(proc_buf, SAMPLE_COUNT, gain);
+        ctx.rms           = 0.0f;
+        ctx.centroid      = NAN;
+        ctx.need_fft      = false;
+        memset(&ctx.spectral, 0, sizeof(ctx.spectral));
+        ctx.scene_changed = false;
+        ctx.pcm16         = NULL;
+        ctx.frame         = NULL;
 
-        // 5. Convert to int16 for transport / playback                        
-        for (size_t i = 0; i < SAMPLE_COUNT; i++) {
-            in16_buf[i]  = convert_32_to_16(raw_buf[i]);
-            out16_buf[i] = convert_32_to_16(proc_buf[i]);
+        // 3. Conditioning, features, classification, packaging, hand-off
+        if (!pipeline_graph_run(&s_graph, &ctx) && ctx.frame) {
+            // Stopped or skipped after packaging: drop the unpublished frame
+            audio_frame_release(ctx.frame);
         }
 
-        // 6. Package frame                                                   
-        audio_frame_t *frame = malloc(sizeof(audio_frame_t));
-        if (!frame) {
-            ESP_LOGE(TAG, "Failed to allocate audio_frame");
-            continue;
+        // 4. Deadline check: done before the next DMA buffer is due?
+        if (deadline_monitor_frame(&s_deadline, capture_us, esp_timer_get_time())) {
+            if (s_deadline.st.degraded) {
+                ESP_LOGW(TAG, "Frame budget headroom below %d%%, spectrum disabled "
+                         "(mean %u us, worst %u us of %u us)", DEADLINE_HEADROOM_PCT,
+                         (unsigned)s_deadline.st.mean_exec_us,
+                         (unsigned)s_deadline.st.wcet_us, (unsigned)FRAME_PERIOD_US);
+            } else {
+                ESP_LOGI(TAG, "Frame budget headroom recovered, spectrum re-enabled");
+            }
         }
 
-        frame->magic        = AUDIO_FRAME_MAGIC;
-        frame->sample_count = SAMPLE_COUNT;
-        frame->rms          = rms;
-        frame->centroid     = centroid;
-        frame->gain         = gain;
-        frame->scene        = scene;
-        frame->samples_in   = in16_buf;
-        frame->samples_out  = out16_buf;
-
-        // 7. Send to downstream consumer                                    
-        if (xQueueSend(audio_frame_queue, &frame, 0) != pdTRUE) {
-            // Drop frame if consumer is slow 
-            free(frame);
-        }
+        power_manager_pipeline_end(capture_us);
     }
 }
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "esp_err.h"
+
+#include "deadline_monitor.h"
+#include "feature_stats.h"
+#include "sound_level.h"
+#include "pipeline_graph.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Real-time task: mic -> DSP -> classification -> audio_frame_queue
+void sample_process_task(void *pvParameters);
+
+/*
+ * Set which optional frame payloads (AUDIO_STREAM_* bits) are currently
+ * wanted by any consumer. Payloads not in the mask are neither computed
+ * nor allocated. Safe to call from any task.
+ */
+void sample_process_set_streams(uint32_t stream_mask);
+
+#define SAMPLE_PROCESS_MAX_SINKS     6
+#define SAMPLE_PROCESS_SINK_NAME_LEN 12
+
+// Core for a sink task from a Kconfig value; -1 leaves it unpinned
+#define SAMPLE_PROCESS_SINK_CORE(core)  ((core) < 0 ? tskNO_AFFINITY : (BaseType_t)(core))
+
+// What a sink loses when its queue is full
+typedef enum {
+    SAMPLE_PROCESS_DROP_NEWEST = 0,     // the new frame; the backlog is delivered intact
+    SAMPLE_PROCESS_DROP_OLDEST,         // the oldest queued frame; the sink stays live
+} sample_process_drop_policy_t;
+
+/*
+ * Register an additional frame consumer next to audio_frame_queue. Every
+ * frame is posted to `queue` (holding audio_frame_t *) with its own
+ * reference, without blocking; the consumer must audio_frame_release it.
+ * `streams` (AUDIO_STREAM_* bits) are produced while the sink is
+ * registered. The queue length is the sink's backlog; a full queue only
+ * costs this sink frames, as chosen by `policy`. `name` labels its
+ * statistics. Safe to call from any task.
+ */
+esp_err_t sample_process_add_sink(QueueHandle_t queue, const char *name, uint32_t streams,
+                                  sample_process_drop_policy_t policy);
+
+/*
+ * Change what a registered sink wants. A sink with no streams receives no
+ * frames, so an idle consumer does not hold pool slots.
+ */
+esp_err_t sample_process_set_sink_streams(QueueHandle_t queue, uint32_t streams);
+
+typedef struct {
+    char name[SAMPLE_PROCESS_SINK_NAME_LEN];
+    uint32_t streams;
+    sample_process_drop_policy_t policy;
+    uint32_t depth;             // queue length
+    uint32_t posted;            // frames queued
+    uint32_t dropped;           // new frames not queued
+    uint32_t evicted;           // queued frames replaced by newer ones (DROP_OLDEST)
+    uint32_t max_waiting;       // queue high-water mark
+} sample_process_sink_stats_t;
+
+/*
+ * Per-sink delivery counters, audio_frame_queue ("websocket") first.
+ * Copies up to `max` entries and returns how many were copied. Safe to
+ * call from any task; counters may straddle one frame.
+ */
+size_t sample_process_get_sink_stats(sample_process_sink_stats_t *out, size_t max);
+
+/*
+ * Analysis cascade counters: which stage settled each frame's scene label.
+ * RMS is always computed, the zero-crossing gate is optional
+ * (CONFIG_AUDIO_CASCADE_ZCR_GATE), the FFT runs only when the centroid can
+ * still change the decision or the spectrum stream needs it.
+ */
+typedef struct {
+    uint32_t frames;
+    uint32_t rms_decided;       // RMS alone fixed the label, FFT skipped
+    uint32_t zcr_decided;       // zero-crossing rate ruled out speech
+    uint32_t fft_decided;       // centroid was needed
+    uint32_t fft_for_spectrum;  // FFT ran only to feed the spectrum stream
+} sample_cascade_stats_t;
+
+// Snapshot of the counters since boot. Safe to call from any task.
+void sample_process_get_cascade_stats(sample_cascade_stats_t *out);
+
+/*
+ * Frame deadline statistics: execution time from I2S read completion to
+ * hand-off, against the SAMPLE_COUNT / SAMPLE_RATE budget. Safe to call
+ * from any task; fields may straddle one frame.
+ */
+void sample_process_get_deadline_stats(deadline_stats_t *out);
+
+/*
+ * Consistent copy of the 1 s / 1 min / 1 h feature aggregates. Safe to
+ * call from any task; the copy is taken under a short critical section.
+ */
+void sample_process_get_feature_stats(feature_stats_t *out);
+
+/*
+ * Latest sound level meter readings. Returns false when the meter is
+ * disabled (CONFIG_SLM_ENABLE). Safe to call from any task.
+ */
+bool sample_process_get_sound_level(sound_level_stats_t *out);
+
+/*
+ * Add a stage to the processing graph next to the default stages (see
+ * pipeline_graph.h); it is placed by the buffers it declares. Call before
+ * sample_process_task starts; at most 4 extra stages.
+ */
+esp_err_t sample_process_add_stage(const pipeline_stage_t *stage);
+
+/*
+ * Per-stage execution time (CPU cycles) in schedule order. Copies up to
+ * `max` entries and returns the number of stages; 0 before the graph is
+ * built. Safe to call from any task; fields may straddle one frame.
+ */
+size_t sample_process_get_stage_stats(pipeline_stage_stats_t *out, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,186 @@
+/**
+ * @file scene_detector.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements per-frame scene classification and a debounced scene detector
+ *        with threshold hysteresis, minimum dwell time and gain smoothing.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+
+#include <string.h>
+#include <math.h>
+
+#include "scene_detector.h"
+#include "sdkconfig.h"
+
+// Decision tree shared by the raw and the hysteresis classifier
+static audio_scene_t classify(float rms, float centroid,
+                              float quiet_th, float noise_th,
+                              float c_min, float c_max)
+{
+    if (rms < quiet_th) {
+        return SCENE_QUIET;
+    }
+    if (rms <= noise_th && centroid >= c_min && centroid <= c_max) {
+        return SCENE_SPEECH;
+    }
+    return SCENE_NOISE;
+}
+
+audio_scene_t scene_classify(float rms, float centroid)
+{
+    return classify(rms, centroid,
+                    SCENE_RMS_QUIET_TH, SCENE_RMS_NOISE_TH,
+                    SCENE_CENTROID_MIN, SCENE_CENTROID_MAX);
+}
+
+/*
+ * Thresholds are widened in favour of the current scene: leaving it takes a
+ * margin of `h` beyond the boundary, so frames hovering on a threshold no
+ * longer flip the label.
+ */
+typedef struct {
+    float quiet_th;
+    float noise_th;
+    float c_min;
+    float c_max;
+} scene_thresholds_t;
+
+static scene_thresholds_t hysteresis_thresholds(audio_scene_t current, float h)
+{
+    scene_thresholds_t t;
+
+    t.quiet_th = SCENE_RMS_QUIET_TH * (current == SCENE_QUIET ? 1.0f + h : 1.0f - h);
+
+    if (current == SCENE_SPEECH) {
+        t.noise_th = SCENE_RMS_NOISE_TH * (1.0f + h);
+        t.c_min    = SCENE_CENTROID_MIN * (1.0f - h);
+        t.c_max    = SCENE_CENTROID_MAX * (1.0f + h);
+    } else {
+        t.noise_th = SCENE_RMS_NOISE_TH * (1.0f - h);
+        t.c_min    = SCENE_CENTROID_MIN * (1.0f + h);
+        t.c_max    = SCENE_CENTROID_MAX * (1.0f - h);
+    }
+    return t;
+}
+
+static audio_scene_t classify_hysteresis(float rms, float centroid,
+                                         audio_scene_t current, float h)
+{
+    scene_thresholds_t t = hysteresis_thresholds(current, h);
+    return classify(rms, centroid, t.quiet_th, t.noise_th, t.c_min, t.c_max);
+}
+
+bool scene_detector_needs_centroid(const scene_detector_t *d, float rms)
+{
+    // The centroid is only consulted between the quiet and noise thresholds
+    if (rms >= SCENE_RMS_QUIET_TH && rms <= SCENE_RMS_NOISE_TH) {
+        return true;
+    }
+    scene_thresholds_t t = hysteresis_thresholds(d->scene, d->cfg.hysteresis);
+    return rms >= t.quiet_th && rms <= t.noise_th;
+}
+
+void scene_detector_default_config(scene_detector_config_t *cfg,
+                                   uint32_t sample_rate, uint32_t frame_samples)
+{
+    const float frame_ms = 1000.0f * frame_samples / sample_rate;
+
+    cfg->hysteresis = CONFIG_SCENE_HYSTERESIS_PCT / 100.0f;
+
+    uint32_t dwell = (uint32_t)(CONFIG_SCENE_MIN_DWELL_MS / frame_ms + 0.5f);
+    cfg->min_dwell_frames = dwell ? dwell : 1;
+
+    // One-pole coefficient for a time constant of GAIN_SMOOTHING_MS
+    cfg->gain_alpha = (CONFIG_SCENE_GAIN_SMOOTHING_MS > 0)
+        ? 1.0f - expf(-frame_ms / CONFIG_SCENE_GAIN_SMOOTHING_MS)
+        : 1.0f;
+
+    cfg->gain[SCENE_QUIET]  = CONFIG_DSP_GAIN_QUIET_X100 / 100.0f;
+    cfg->gain[SCENE_SPEECH] = CONFIG_DSP_GAIN_SPEECH_X100 / 100.0f;
+    cfg->gain[SCENE_NOISE]  = CONFIG_DSP_GAIN_NOISE_X100 / 100.0f;
+}
+
+void scene_detector_init(scene_detector_t *d, const scene_detector_config_t *cfg,
+                         uint32_t sample_rate, uint32_t frame_samples)
+{
+    memset(d, 0, sizeof(*d));
+    d->cfg       = *cfg;
+    d->frame_us  = (uint32_t)(1000000ULL * frame_samples / sample_rate);
+    d->scene     = SCENE_QUIET;
+    d->candidate = SCENE_QUIET;
+    d->gain      = cfg->gain[SCENE_QUIET];
+}
+
+// Share of the last `window` raw labels equal to `scene`
+static float recent_agreement(const scene_detector_t *d, audio_scene_t scene, uint32_t window)
+{
+    if (window > d->recent_len) window = d->recent_len;
+    if (window == 0) return 0.0f;
+
+    uint32_t agree = 0;
+    for (uint32_t i = 0; i < window; i++) {
+        uint32_t idx = (d->frame_index - 1 - i) % SCENE_CONFIDENCE_WINDOW;
+        if (d->recent[idx] == scene) agree++;
+    }
+    return (float)agree / window;
+}
+
+bool scene_detector_update(scene_detector_t *d, float rms, float centroid,
+                           int64_t timestamp_us, scene_event_t *event)
+{
+    bool changed = false;
+
+    d->recent[d->frame_index % SCENE_CONFIDENCE_WINDOW] = (uint8_t)scene_classify(rms, centroid);
+    d->frame_index++;
+    if (d->recent_len < SCENE_CONFIDENCE_WINDOW) d->recent_len++;
+
+    audio_scene_t label = classify_hysteresis(rms, centroid, d->scene, d->cfg.hysteresis);
+
+    if (label == d->scene) {
+        d->candidate_frames = 0;
+    } else {
+        if (label != d->candidate || d->candidate_frames == 0) {
+            d->candidate = label;
+            d->candidate_frames = 0;
+            d->candidate_rms_sum = 0.0f;
+            d->candidate_centroid_sum = 0.0f;
+            d->candidate_centroid_frames = 0;
+        }
+        d->candidate_frames++;
+        d->candidate_rms_sum += rms;
+        if (!isnan(centroid)) {
+            d->candidate_centroid_sum += centroid;
+            d->candidate_centroid_frames++;
+        }
+
+        if (d->candidate_frames >= d->cfg.min_dwell_frames) {
+            if (event) {
+                uint32_t n = d->candidate_frames;
+                uint32_t prev_frames = d->frame_index - n - d->scene_start_frame;
+
+                event->timestamp_us     = timestamp_us;
+                event->frame_index      = d->frame_index - 1;
+                event->from             = (uint8_t)d->scene;
+                event->to               = (uint8_t)label;
+                event->confidence       = recent_agreement(d, label, 2 * n);
+                event->mean_rms         = d->candidate_rms_sum / n;
+                event->mean_centroid    = d->candidate_centroid_frames
+                    ? d->candidate_centroid_sum / d->candidate_centroid_frames
+                    : 0.0f;
+                event->prev_duration_ms = (uint32_t)((uint64_t)prev_frames * d->frame_us / 1000);
+            }
+
+            d->scene_start_frame = d->frame_index - d->candidate_frames;
+            d->scene = label;
+            d->candidate_frames = 0;
+            changed = true;
+        }
+    }
+
+    // Smooth towards the debounced scene's gain
+    d->gain += d->cfg.gain_alpha * (d->cfg.gain[d->scene] - d->gain);
+
+    return changed;
+}
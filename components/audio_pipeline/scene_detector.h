@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "audio_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Per-frame classifier thresholds
+#define SCENE_RMS_QUIET_TH      0.025f
+#define SCENE_RMS_NOISE_TH      0.10f
+#define SCENE_CENTROID_MIN      600.0f
+#define SCENE_CENTROID_MAX      3200.0f
+
+#define SCENE_CONFIDENCE_WINDOW 256     // max frames remembered for confidence
+
+typedef struct {
+    float hysteresis;           // fractional threshold widening, e.g. 0.2
+    uint32_t min_dwell_frames;  // frames a new scene must persist
+    float gain_alpha;           // one-pole smoothing per frame (1 = no smoothing)
+    float gain[3];              // target gain per audio_scene_t
+} scene_detector_config_t;
+
+// Compact scene-transition event
+typedef struct {
+    int64_t timestamp_us;       // capture time of the frame that confirmed it
+    uint32_t frame_index;
+    uint8_t from;               // audio_scene_t
+    uint8_t to;                 // audio_scene_t
+    float confidence;           // share of recent raw labels agreeing with `to`
+    float mean_rms;             // over the confirmation window
+    float mean_centroid;        // over frames whose centroid was computed
+    uint32_t prev_duration_ms;  // time spent in `from`
+} scene_event_t;
+
+typedef struct {
+    scene_detector_config_t cfg;
+    uint32_t frame_us;          // frame duration
+
+    audio_scene_t scene;        // debounced scene
+    audio_scene_t candidate;
+    uint32_t candidate_frames;
+    float candidate_rms_sum;
+    float candidate_centroid_sum;
+    uint32_t candidate_centroid_frames;
+    uint32_t frame_index;
+    uint32_t scene_start_frame;
+    float gain;                 // smoothed gain
+
+    uint8_t recent[SCENE_CONFIDENCE_WINDOW];
+    uint32_t recent_len;
+} scene_detector_t;
+
+// Fill `cfg` from Kconfig for frames of frame_samples at sample_rate
+void scene_detector_default_config(scene_detector_config_t *cfg,
+                                   uint32_t sample_rate, uint32_t frame_samples);
+
+void scene_detector_init(scene_detector_t *d, const scene_detector_config_t *cfg,
+                         uint32_t sample_rate, uint32_t frame_samples);
+
+// Stateless per-frame classification (no hysteresis, no dwell)
+audio_scene_t scene_classify(float rms, float centroid);
+
+/*
+ * True if the centroid can still change the next update's labels (raw or
+ * hysteresis) for a frame with this RMS. When false, the frame may be fed
+ * with centroid = NAN and classifies exactly as with any real centroid.
+ */
+bool scene_detector_needs_centroid(const scene_detector_t *d, float rms);
+
+/*
+ * Feed one frame. Returns true and fills `event` when the debounced scene
+ * changes. Afterwards d->scene and d->gain hold the debounced scene and the
+ * smoothed gain for this frame. A NAN centroid means "not computed"; it
+ * classifies as outside the speech band. Pure C, O(1) per frame.
+ */
+bool scene_detector_update(scene_detector_t *d, float rms, float centroid,
+                           int64_t timestamp_us, scene_event_t *event);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,68 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Cascade of second-order sections run with the esp-dsp float biquad
+ * kernel (dsps_biquad_f32_ae32, direct form II) on 24-bit samples (32-bit,
+ * left-aligned as read from the INMP441), in place.
+ *
+ * Coefficients are designed once when a section is added (RBJ cookbook
+ * forms); the delay lines persist across calls, so consecutive frames are
+ * filtered as one continuous signal.
+ */
+
+#define BIQUAD_CHAIN_MAX_SECTIONS   6
+
+typedef enum {
+    BIQUAD_HIGHPASS = 0,
+    BIQUAD_NOTCH,
+    BIQUAD_BANDPASS,    // 0 dB at the centre frequency
+} biquad_type_t;
+
+typedef struct {
+    float coef[5];      // b0, b1, b2, a1, a2 (a0 = 1), the dsps_biquad_f32 layout
+    float w[2];         // delay line
+} biquad_section_t;
+
+typedef struct {
+    biquad_section_t sections[BIQUAD_CHAIN_MAX_SECTIONS];
+    int section_count;
+    int sample_rate;
+} biquad_chain_t;
+
+void biquad_chain_init(biquad_chain_t *c, int sample_rate);
+
+/*
+ * Append one section. q: quality factor (notch / band-pass: centre
+ * frequency over bandwidth). ESP_ERR_INVALID_ARG for a frequency outside
+ * (0, sample_rate / 2) or q <= 0, ESP_ERR_INVALID_SIZE when the chain is full.
+ */
+esp_err_t biquad_chain_add(biquad_chain_t *c, biquad_type_t type, float freq_hz, float q);
+
+// Butterworth high-pass of even order (2, 4, 6) as order / 2 sections
+esp_err_t biquad_chain_add_highpass(biquad_chain_t *c, float freq_hz, int order);
+
+// Clear the delay lines, e.g. after a gap in the input
+void biquad_chain_reset(biquad_chain_t *c);
+
+// Filter count samples in place; output saturates at 24-bit full scale
+void biquad_chain_process(biquad_chain_t *c, int32_t *samples, size_t count);
+
+/*
+ * CPU cycles per call of biquad_chain_process on a frame of `count`
+ * samples, for chains of 1 .. BIQUAD_CHAIN_MAX_SECTIONS high-pass sections
+ * (the kernel cost does not depend on the section type). Averaged over
+ * `frames` calls; cycles_out needs BIQUAD_CHAIN_MAX_SECTIONS entries.
+ */
+esp_err_t biquad_chain_benchmark(int sample_rate, size_t count, int frames, uint32_t *cycles_out);
+
+#ifdef __cplusplus
+}
+#endif
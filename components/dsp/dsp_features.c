@@ -12,6 +12,63 @@
 #include <stdlib.h>
 #include <string.h>
 #include "esp_dsp.h"
+#include "dsp_tables.h"
+
+// Swap complex entries into natural order using the generated pair table
+static void fft_bit_reverse(float *data) {
+    for (size_t p = 0; p < DSP_TABLES_BITREV_PAIRS; p++) {
+        size_t i = 2 * dsp_fft_bitrev[p][0];
+        size_t j = 2 * dsp_fft_bitrev[p][1];
+        float re = data[i], im = data[i + 1];
+        data[i] = data[j];
+        data[i + 1] = data[j + 1];
+        data[j] = re;
+        data[j + 1] = im;
+    }
+}
+
+// Full-scale sine at 24 bits peaks at (N/2) * 2^23 * window gain in its bin
+static inline float full_scale_bin_mag(size_t fft_size) {
+    return (float)(fft_size / 2) * (float)(1 << 23) * DSP_HANN_COHERENT_GAIN;
+}
+
+/*
+ * FFT of a 24-bit frame in natural order, [Re0, Im0, ...], on the
+ * rectangular frame, in the caller's scratch. count must be
+ * DSP_TABLES_FFT_SIZE.
+ */
+static float *fft_spectrum(const int32_t *samples, size_t count, dsp_fft_scratch_t *scratch) {
+    // Complex buffer [Re0, Im0, Re1, Im1, ...]
+    float *fft_buf = scratch->fc32;
+
+    // 24-bit samples (32-bit MSB padded), imaginary part 0
+    for (size_t i = 0; i < count; i++) {
+        fft_buf[2*i + 0] = (float)(samples[i] >> 8);
+        fft_buf[2*i + 1] = 0.0f;
+    }
+
+    // Twiddles come from flash; nothing is allocated or initialized at runtime.
+    // The kernel only reads the table.
+    dsps_fft2r_fc32_ae32_(fft_buf, count, (float *)dsp_fft_twiddles);
+    fft_bit_reverse(fft_buf);
+    return fft_buf;
+}
+
+/*
+ * Bin k of the Hann-windowed spectrum from the rectangular one. The
+ * periodic Hann window is 0.5 - 0.5 cos(2 pi n / N), so windowing is the
+ * three-tap convolution X[k]/2 - (X[k-1] + X[k+1])/4. Valid for
+ * 1 <= k < N/2; bin 0 is 0.5 * (X[0] - Re X[1]) for real input.
+ */
+static inline float hann_bin_mag(const float *fft_buf, size_t k) {
+    float re = 0.5f * fft_buf[2*k]     - 0.25f * (fft_buf[2*k - 2] + fft_buf[2*k + 2]);
+    float im = 0.5f * fft_buf[2*k + 1] - 0.25f * (fft_buf[2*k - 1] + fft_buf[2*k + 3]);
+    return sqrtf(re*re + im*im);
+}
+
+static inline float hann_dc_mag(const float *fft_buf) {
+    return fabsf(0.5f * (fft_buf[0] - fft_buf[2]));
+}
 
 float dsp_compute_rms(const int32_t *samples, size_t count) {
     if (!samples || count == 0) return 0.0f;
@@ -28,61 +85,217 @@ float dsp_compute_rms(const int32_t *samples, size_t count) {
     return (float)(rms / (float)(1 << 23));  // Normalize to [-1,1]
 }
 
-float dsp_compute_spectral_centroid_fft(const int32_t *samples, size_t count, int sample_rate) {
-    if (!samples || count == 0) {
-        return 0.0f;
-    }
-
-    // ESP‑DSP expects float real input. Prepare buffer of length count.
-    float *buf = malloc(sizeof(float) * count);
-    if (!buf) return 0.0f;
+float dsp_compute_zcr(const int32_t *samples, size_t count) {
+    if (!samples || count < 2) return 0.0f;
 
-    // Convert from 32-bit signed int to float (shift down 8 bits if using 24-bit mic data)
-    for (size_t i = 0; i < count; i++) {
-        buf[i] = (float)(samples[i] >> 8);
+    uint32_t crossings = 0;
+    for (size_t i = 1; i < count; ++i) {
+        crossings += (uint32_t)((samples[i - 1] ^ samples[i]) < 0);  // sign bits differ
     }
 
-    // Prepare FFT: real to complex radix-2
-    // We need buffer of length 2*count: [Re0, Im0, Re1, Im1, ...]
-    float *fft_buf = malloc(sizeof(float) * 2 * count);
-    if (!fft_buf) {
-        free(buf);
+    return (float)crossings / (float)(count - 1);
+}
+
+float dsp_compute_spectral_centroid_fft(const int32_t *samples, size_t count, int sample_rate,
+                                        dsp_fft_scratch_t *scratch, float *mag_out) {
+    // Tables are generated for one size only
+    if (!samples || !scratch || count != DSP_TABLES_FFT_SIZE) {
         return 0.0f;
     }
-    // Fill complex buffer: real = buf, imag = 0
-    for (size_t i = 0; i < count; i++) {
-        fft_buf[2*i + 0] = buf[i];
-        fft_buf[2*i + 1] = 0.0f;
-    }
-
-    // Initialize FFT tables 
-    dsps_fft2r_init_fc32(NULL, count);
 
-    // Perform FFT in-place on fft_buf
-    dsps_fft2r_fc32_ae32(fft_buf, count);
-    dsps_bit_rev_fc32_ansi(fft_buf, count);
+    float *fft_buf = fft_spectrum(samples, count, scratch);
 
     // Now fft_buf contains complex spectrum: [Re0, Im0, Re1, Im1, ...]
-    // Compute magnitude and spectral centroid
+    // The centroid is taken on the rectangular frame, as the scene
+    // thresholds were tuned; only the exported spectrum is windowed
     float total_mag = 0.0f;
     float centroid = 0.0f;
     size_t half = count / 2;  // Nyquist
 
+    if (mag_out) {
+        mag_out[0] = hann_dc_mag(fft_buf);
+    }
+
     for (size_t k = 1; k < half; k++) {
         float re = fft_buf[2*k];
         float im = fft_buf[2*k + 1];
         float mag = sqrtf(re*re + im*im);
+        if (mag_out) {
+            mag_out[k] = hann_bin_mag(fft_buf, k);
+        }
         float freq = ((float)k * sample_rate) / count;
         centroid += freq * mag;
         total_mag += mag;
     }
 
-    float result = (total_mag > 0.0f) ? (centroid / total_mag) : 0.0f;
+    return (total_mag > 0.0f) ? (centroid / total_mag) : 0.0f;
+}
 
-    free(buf);
-    free(fft_buf);
+// Upper edges of the first DSP_SPECTRAL_BANDS - 1 bands; the last runs to Nyquist
+static const float SPECTRAL_BAND_EDGES_HZ[DSP_SPECTRAL_BANDS - 1] = {
+    300.0f, 1000.0f, 2000.0f, 4000.0f
+};
+
+bool dsp_compute_spectral_features_fft(const int32_t *samples, size_t count, int sample_rate,
+                                       dsp_fft_scratch_t *scratch, float *mag_out,
+                                       dsp_spectral_state_t *state, dsp_spectral_features_t *out) {
+    if (!samples || !scratch || !out || count != DSP_TABLES_FFT_SIZE || sample_rate <= 0) {
+        return false;
+    }
+
+    float *fft_buf = fft_spectrum(samples, count, scratch);
+
+    const size_t half = count / 2;
+    const float bin_hz = (float)sample_rate / count;
+
+    size_t band_end[DSP_SPECTRAL_BANDS];
+    for (size_t b = 0; b < DSP_SPECTRAL_BANDS - 1; b++) {
+        band_end[b] = (size_t)ceilf(SPECTRAL_BAND_EDGES_HZ[b] / bin_hz);
+    }
+    band_end[DSP_SPECTRAL_BANDS - 1] = half;
 
-    return result;
+    float band_pow[DSP_SPECTRAL_BANDS] = { 0 };
+    float rect_mag = 0.0f;      // centroid on the rectangular frame, as in the centroid-only path
+    float rect_centroid = 0.0f;
+    float total_mag = 0.0f;     // the rest uses the Hann-windowed spectrum
+    float centroid = 0.0f;      // sum of f * |X|
+    float moment2 = 0.0f;       // sum of f^2 * |X|
+    float total_pow = 0.0f;
+    float geo_mant = 1.0f;      // running product of the powers as mantissa * 2^geo_exp
+    int geo_exp = 0;
+    size_t band = 0;
+
+    if (mag_out) {
+        mag_out[0] = hann_dc_mag(fft_buf);
+    }
+
+    for (size_t k = 1; k < half; k++) {
+        float re = fft_buf[2*k];
+        float im = fft_buf[2*k + 1];
+        float freq = ((float)k * sample_rate) / count;
+        float rmag = sqrtf(re*re + im*im);
+        rect_centroid += freq * rmag;
+        rect_mag += rmag;
+
+        float mag = hann_bin_mag(fft_buf, k);
+        float power = mag * mag;
+
+        // Step k reads complex bins k-1..k+1 (floats 2k-2 and up) and has
+        // overwritten floats below k, so the windowed magnitudes can be
+        // kept in place for the second pass
+        fft_buf[k] = mag;
+        if (mag_out) {
+            mag_out[k] = mag;
+        }
+
+        centroid += freq * mag;
+        moment2 += freq * freq * mag;
+        total_mag += mag;
+        total_pow += power;
+
+        while (band < DSP_SPECTRAL_BANDS - 1 && k >= band_end[band]) band++;
+        band_pow[band] += power;
+
+        // One LSB^2 floor keeps empty bins from zeroing the product;
+        // frexpf renormalizes without a log per bin
+        int e;
+        geo_mant = frexpf(geo_mant * (power + 1.0f), &e);
+        geo_exp += e;
+    }
+
+    // Rolloff and flux need the totals: one pass over the half-size magnitudes
+    const float rolloff_pow = DSP_SPECTRAL_ROLLOFF * total_pow;
+    // sum |X|^2 is the squared L2 norm of the magnitudes
+    const float inv_norm = (total_pow > 0.0f) ? 1.0f / sqrtf(total_pow) : 0.0f;
+    const bool have_prev = state && state->valid;
+    float cum_pow = 0.0f;
+    float flux = 0.0f;
+    size_t rolloff_bin = 0;
+
+    for (size_t k = 1; k < half; k++) {
+        float mag = fft_buf[k];
+        if (!rolloff_bin) {
+            cum_pow += mag * mag;
+            if (cum_pow >= rolloff_pow && total_pow > 0.0f) rolloff_bin = k;
+        }
+        if (state) {
+            float norm = mag * inv_norm;
+            if (have_prev) {
+                float d = norm - state->prev[k];
+                flux += d * d;
+            }
+            state->prev[k] = norm;
+        }
+    }
+    if (state) {
+        state->prev[0] = 0.0f;
+        state->valid = total_pow > 0.0f;
+    }
+
+    const float bins = (float)(half - 1);
+    const float mean_pow = total_pow / bins + 1.0f;     // same floor as the product
+    const float geo_mean = exp2f(((float)geo_exp + log2f(geo_mant)) / bins);
+
+    out->centroid_hz = (rect_mag > 0.0f) ? rect_centroid / rect_mag : 0.0f;
+    const float win_centroid = (total_mag > 0.0f) ? centroid / total_mag : 0.0f;
+    float spread = (total_mag > 0.0f) ? moment2 / total_mag - win_centroid * win_centroid : 0.0f;
+    out->bandwidth_hz = (spread > 0.0f) ? sqrtf(spread) : 0.0f;
+    out->rolloff_hz = (float)rolloff_bin * bin_hz;
+    out->flatness = geo_mean / mean_pow;
+    out->flux = flux;
+
+    // A full-scale sine spreads (N/2 * 2^23)^2 * power gain over its main lobe
+    const float half_fs = (float)(count / 2) * (float)(1 << 23);
+    const float ref_pow = half_fs * half_fs * DSP_HANN_POWER_GAIN;
+    for (size_t b = 0; b < DSP_SPECTRAL_BANDS; b++) {
+        float db = (band_pow[b] > 0.0f) ? 10.0f * log10f(band_pow[b] / ref_pow)
+                                        : DSP_SPECTRUM_DB_FLOOR;
+        out->band_db[b] = (db < DSP_SPECTRUM_DB_FLOOR) ? DSP_SPECTRUM_DB_FLOOR : db;
+    }
+
+    return true;
+}
+
+size_t dsp_quantize_spectrum_u8(const float *mag, size_t bins, size_t fft_size,
+                                uint8_t *out, size_t out_bins) {
+    if (!mag || !out || bins == 0 || out_bins == 0 || out_bins > bins || bins % out_bins) {
+        return 0;
+    }
+
+    const float full_scale = full_scale_bin_mag(fft_size);
+    const float ref_pow = full_scale * full_scale;
+    const float step = 255.0f / (DSP_SPECTRUM_DB_CEIL - DSP_SPECTRUM_DB_FLOOR);
+    const size_t group = bins / out_bins;
+
+    for (size_t b = 0; b < out_bins; b++) {
+        // Average power over the band, then log-compress once per band
+        float pow_sum = 0.0f;
+        for (size_t k = b * group; k < (b + 1) * group; k++) {
+            pow_sum += mag[k] * mag[k];
+        }
+        float p = pow_sum / (float)group;
+        float db = (p > 0.0f) ? 10.0f * log10f(p / ref_pow) : DSP_SPECTRUM_DB_FLOOR;
+
+        float q = (db - DSP_SPECTRUM_DB_FLOOR) * step;
+        if (q < 0.0f)   q = 0.0f;
+        if (q > 255.0f) q = 255.0f;
+        out[b] = (uint8_t)(q + 0.5f);
+    }
+
+    return out_bins;
+}
+
+void dsp_mel_band_power(const float *mag, float *bands) {
+    for (size_t b = 0; b < DSP_MEL_BANDS; b++) {
+        const dsp_mel_band_t *band = &dsp_mel_bands[b];
+        const float *w = &dsp_mel_weights[band->weight_offset];
+        const float *m = &mag[band->first_bin];
+        float sum = 0.0f;
+        for (size_t k = 0; k < band->bin_count; k++) {
+            sum += w[k] * m[k] * m[k];
+        }
+        bands[b] = sum;
+    }
 }
 
 void dsp_apply_gain(int32_t *samples, size_t count, float gain) {
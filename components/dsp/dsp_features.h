@@ -1,13 +1,88 @@
 #pragma once
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+#include "dsp_tables.h"     // generated at build time, see gen_tables.py
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Log-magnitude range mapped onto 0..255 by dsp_quantize_spectrum_u8 (dBFS)
+#define DSP_SPECTRUM_DB_FLOOR   (-120.0f)
+#define DSP_SPECTRUM_DB_CEIL    (0.0f)
+
+// Bands of dsp_spectral_features_t.band_db: 0-300, 300-1k, 1k-2k, 2k-4k, 4k-Nyquist Hz
+#define DSP_SPECTRAL_BANDS      5
+
+// Fraction of the spectral power below the rolloff frequency
+#define DSP_SPECTRAL_ROLLOFF    0.85f
+
+// Shape of one magnitude spectrum, DC excluded
+typedef struct {
+    float centroid_hz;      // same value as dsp_compute_spectral_centroid_fft
+    float bandwidth_hz;     // magnitude-weighted spread around the centroid
+    float rolloff_hz;       // DSP_SPECTRAL_ROLLOFF of the power lies below
+    float flatness;         // geometric / arithmetic mean of the power, 0 (tonal) .. 1 (white)
+    float flux;             // squared distance of the unit-norm magnitudes to the previous spectrum, 0..2
+    float band_db[DSP_SPECTRAL_BANDS];  // band power, dBFS (0 = full-scale sine)
+} dsp_spectral_features_t;
+
+// FFT work buffer, owned by the caller so no frame allocates; one per concurrent caller
+typedef union {
+    float fc32[2 * DSP_TABLES_FFT_SIZE];    // [Re0, Im0, Re1, Im1, ...]
+    int16_t sc16[2 * DSP_TABLES_FFT_SIZE];  // same layout, Q15 (dsp_fixed.h)
+} dsp_fft_scratch_t;
+
+// Previous spectrum for the flux, owned by the caller
+typedef struct {
+    float prev[DSP_TABLES_FFT_SIZE / 2];    // unit-norm magnitudes
+    bool valid;                             // clear when frames were skipped
+} dsp_spectral_state_t;
+
 float dsp_compute_rms(const int32_t *samples, size_t count);
-float dsp_compute_spectral_centroid_fft(const int32_t *samples, size_t count, int sample_rate);
+
+// Zero-crossing rate: sign changes per sample pair, 0..1
+float dsp_compute_zcr(const int32_t *samples, size_t count);
+
+/*
+ * Spectral centroid in Hz of the rectangular (unwindowed) frame, the value
+ * the scene thresholds are tuned on. If mag_out is non-NULL it receives the
+ * Hann-windowed magnitude spectrum from the same FFT (count / 2 bins, DC to
+ * just below Nyquist). The FFT runs in scratch. count must be
+ * DSP_TABLES_FFT_SIZE; returns 0 otherwise.
+ */
+float dsp_compute_spectral_centroid_fft(const int32_t *samples, size_t count, int sample_rate,
+                                        dsp_fft_scratch_t *scratch, float *mag_out);
+
+/*
+ * Centroid plus the rest of dsp_spectral_features_t from the same FFT, in
+ * one loop over the bins. The centroid is the rectangular-frame value above;
+ * everything else uses the Hann-windowed spectrum: power feeds flatness,
+ * rolloff and the band energies, the magnitude feeds bandwidth and flux.
+ * state may be NULL (flux 0); otherwise its spectrum is compared and
+ * replaced. scratch and mag_out as above. Returns false if count is not
+ * DSP_TABLES_FFT_SIZE or an argument is missing.
+ */
+bool dsp_compute_spectral_features_fft(const int32_t *samples, size_t count, int sample_rate,
+                                       dsp_fft_scratch_t *scratch, float *mag_out,
+                                       dsp_spectral_state_t *state, dsp_spectral_features_t *out);
+
+/*
+ * Band-average the power of `bins` magnitude bins into `out_bins` bands
+ * (out_bins must divide bins), convert to dBFS and quantize to uint8 over
+ * [DSP_SPECTRUM_DB_FLOOR, DSP_SPECTRUM_DB_CEIL]. Returns out_bins, or 0 on
+ * invalid arguments.
+ */
+size_t dsp_quantize_spectrum_u8(const float *mag, size_t bins, size_t fft_size,
+                                uint8_t *out, size_t out_bins);
+
+/*
+ * Power in each of the DSP_MEL_BANDS triangular mel bands, from a
+ * DSP_TABLES_FFT_SIZE / 2 bin magnitude spectrum.
+ */
+void dsp_mel_band_power(const float *mag, float *bands);
+
 void dsp_apply_gain(int32_t *samples, size_t count, float gain);
 
 
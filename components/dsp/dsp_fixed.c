@@ -0,0 +1,144 @@
+/**
+ * @file dsp_fixed.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements fixed-point RMS, Q15 FFT centroid and Q15 gain as drop-in
+ *        alternatives to the float feature kernels.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+
+#include "dsp_fixed.h"
+#include <stdlib.h>
+#include <string.h>
+#include "esp_dsp.h"
+#include "dsp_tables.h"
+
+// alpha-max-plus-beta-min coefficients in Q15 (max error 3.96 %)
+#define MAG_ALPHA_Q15   31470
+#define MAG_BETA_Q15    13035
+
+static uint32_t isqrt64(uint64_t x) {
+    uint64_t r = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > x) bit >>= 2;
+    while (bit) {
+        if (x >= r + bit) {
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)r;
+}
+
+float dsp_compute_rms_q31(const int32_t *samples, size_t count) {
+    if (!samples || count == 0) return 0.0f;
+
+    // 24-bit squares fit 2^46; 2^17 of them fit the 64-bit sum
+    int64_t sum_sq = 0;
+    for (size_t i = 0; i < count; ++i) {
+        int32_t sample = samples[i] >> 8;
+        sum_sq += (int64_t)sample * sample;
+    }
+
+    // Mean square < 2^46, so 16 fractional bits fit and the root keeps 8
+    uint64_t mean_q16 = ((uint64_t)sum_sq / count) << 16;
+    uint32_t rms_q8 = isqrt64(mean_q16);
+
+    return (float)rms_q8 / (float)(1 << 8) / (float)(1 << 23);
+}
+
+static inline uint32_t magnitude_q15(int32_t re, int32_t im) {
+    uint32_t a = (uint32_t)(re < 0 ? -re : re);
+    uint32_t b = (uint32_t)(im < 0 ? -im : im);
+    uint32_t hi = a > b ? a : b;
+    uint32_t lo = a > b ? b : a;
+    return (MAG_ALPHA_Q15 * hi + MAG_BETA_Q15 * lo) >> 15;
+}
+
+// Hann-windowed bin k from the rectangular spectrum: X[k]/2 - (X[k-1] + X[k+1])/4
+static inline uint32_t hann_bin_mag_q15(const int16_t *fft_buf, size_t k) {
+    int32_t re = (2 * fft_buf[2*k]     - fft_buf[2*k - 2] - fft_buf[2*k + 2]) / 4;
+    int32_t im = (2 * fft_buf[2*k + 1] - fft_buf[2*k - 1] - fft_buf[2*k + 3]) / 4;
+    return magnitude_q15(re, im);
+}
+
+static void fft_bit_reverse_sc16(int16_t *data) {
+    uint32_t *c = (uint32_t *)data;     // one complex sample per word
+    for (size_t p = 0; p < DSP_TABLES_BITREV_PAIRS; p++) {
+        uint32_t t = c[dsp_fft_bitrev[p][0]];
+        c[dsp_fft_bitrev[p][0]] = c[dsp_fft_bitrev[p][1]];
+        c[dsp_fft_bitrev[p][1]] = t;
+    }
+}
+
+float dsp_compute_spectral_centroid_sc16(const int32_t *samples, size_t count, int sample_rate,
+                                         dsp_fft_scratch_t *scratch, float *mag_out) {
+    if (!samples || !scratch || count != DSP_TABLES_FFT_SIZE) {
+        return 0.0f;
+    }
+
+    // [Re0, Im0, ...] as int16, the first half of the scratch
+    int16_t *fft_buf = scratch->sc16;
+
+    // Block normalization: shift the 24-bit frame so its peak sits just below Q15 full scale
+    int32_t peak = 0;
+    for (size_t i = 0; i < count; i++) {
+        int32_t s = samples[i] >> 8;
+        if (s < 0) s = -s;
+        if (s > peak) peak = s;
+    }
+    int shift = 0;     // left shift applied to the 24-bit samples (negative: right)
+    if (peak > 0) {
+        shift = __builtin_clz((uint32_t)peak) - 17;     // peak < 2^15 afterwards
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        int32_t s = samples[i] >> 8;
+        s = (shift >= 0) ? (s << shift) : (s >> -shift);
+        fft_buf[2*i + 0] = (int16_t)s;
+        fft_buf[2*i + 1] = 0;
+    }
+
+    // Each stage halves the data, so the transform is scaled by 1/N
+    dsps_fft2r_sc16_ae32_(fft_buf, count, (int16_t *)dsp_fft_twiddles_sc16);
+    fft_bit_reverse_sc16(fft_buf);
+
+    uint64_t weighted = 0;
+    uint64_t total = 0;
+    size_t half = count / 2;
+
+    // Back to the float path's units: x N, undo the normalization
+    const float to_float = (float)count * ((shift >= 0) ? 1.0f / (float)(1 << shift)
+                                                        : (float)(1 << -shift));
+    // Centroid on the rectangular frame as in the float path; the exported
+    // spectrum is Hann windowed in the frequency domain
+    if (mag_out) {
+        int32_t dc = (fft_buf[0] - fft_buf[2]) / 2;
+        mag_out[0] = (float)(dc < 0 ? -dc : dc) * to_float;
+    }
+
+    for (size_t k = 1; k < half; k++) {
+        uint32_t mag = magnitude_q15(fft_buf[2*k], fft_buf[2*k + 1]);
+        if (mag_out) {
+            mag_out[k] = (float)hann_bin_mag_q15(fft_buf, k) * to_float;
+        }
+        weighted += (uint64_t)k * mag;
+        total += mag;
+    }
+
+    if (total == 0) return 0.0f;
+    return (float)weighted / (float)total * (float)sample_rate / (float)count;
+}
+
+void dsp_apply_gain_q15(int32_t *samples, size_t count, int32_t gain_q15) {
+    for (size_t i = 0; i < count; i++) {
+        int64_t scaled = ((int64_t)samples[i] * gain_q15) >> 15;
+        if (scaled > INT32_MAX) scaled = INT32_MAX;
+        if (scaled < INT32_MIN) scaled = INT32_MIN;
+        samples[i] = (int32_t)scaled;
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "dsp_features.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fixed-point variants of the dsp_features.h kernels, selected by
+ * CONFIG_DSP_FIXED_POINT. Inputs and outputs keep the float API's units so
+ * the two paths are interchangeable; only the arithmetic inside differs.
+ *
+ * Error against the float path on 24-bit input, enforced by `das_golden
+ * check` (tools/batch_analyzer) on white noise, harmonic, tonal and swept
+ * input from 0 to -80 dBFS:
+ *   RMS          < 1e-5 relative plus 1e-9 of full scale
+ *   centroid     < 5 % relative plus a quarter bin; the most is reached on
+ *                leakage-dominated frames (a 50 Hz hum, whose centroid lies
+ *                near 740 Hz, reads up to 37 Hz low)
+ *   magnitudes   < 0.5 dB for bins within 20 dB of the frame's peak bin,
+ *                < 3 dB within 40 dB; further down the 1/N scaling of the
+ *                transform leaves only a few LSBs and bins may read zero
+ */
+
+// RMS with a Q31-scaled 64-bit sum of squares and an integer square root
+float dsp_compute_rms_q31(const int32_t *samples, size_t count);
+
+/*
+ * Spectral centroid from a Q15 complex FFT (dsps_fft2r_sc16) of the
+ * rectangular frame, as dsp_compute_spectral_centroid_fft. The frame is
+ * block-normalized to the Q15 range first so quiet input keeps its
+ * resolution through the 1/N scaling of the transform. Magnitudes use the
+ * alpha-max-plus-beta-min estimate (< 4 % error, no square roots). scratch
+ * and mag_out as for dsp_compute_spectral_centroid_fft. count must be
+ * DSP_TABLES_FFT_SIZE.
+ */
+float dsp_compute_spectral_centroid_sc16(const int32_t *samples, size_t count, int sample_rate,
+                                         dsp_fft_scratch_t *scratch, float *mag_out);
+
+// Q15 gain (32768 = 1.0, larger values amplify) with saturation to int32
+void dsp_apply_gain_q15(int32_t *samples, size_t count, int32_t gain_q15);
+
+static inline int32_t dsp_gain_to_q15(float gain)
+{
+    return (int32_t)(gain * 32768.0f + 0.5f);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,91 @@
+/**
+ * @file fir_decimator.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements a windowed-sinc FIR decimator that computes only the
+ *        retained outputs with the esp-dsp dot product kernel.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include "fir_decimator.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_dsp.h"
+
+#define FULL_SCALE_24   8388607.0f
+#define MAX_FACTOR      8
+
+esp_err_t fir_decimator_init(fir_decimator_t *d, int factor, size_t block)
+{
+    if (!d || factor < 1 || factor > MAX_FACTOR || block == 0 || block % factor) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(d, 0, sizeof(*d));
+    d->factor = factor;
+    d->block = block;
+    d->taps = FIR_DECIMATOR_TAPS_PER_FACTOR * factor + 1;
+
+    d->coeffs = malloc(d->taps * sizeof(float));
+    d->work = calloc(d->taps - 1 + block, sizeof(float));
+    if (!d->coeffs || !d->work) {
+        fir_decimator_deinit(d);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Blackman-windowed sinc, cutoff at the output Nyquist frequency
+    const double fc = 0.5 / factor;     // cycles per input sample
+    const int mid = (d->taps - 1) / 2;
+    double sum = 0.0;
+    for (int n = 0; n < d->taps; n++) {
+        double x = n - mid;
+        double sinc = (n == mid) ? 2.0 * fc : sin(2.0 * M_PI * fc * x) / (M_PI * x);
+        double phase = 2.0 * M_PI * n / (d->taps - 1);
+        double win = 0.42 - 0.5 * cos(phase) + 0.08 * cos(2.0 * phase);
+        double h = sinc * win;
+        // Symmetric, so the time reversal the dot product needs is a no-op
+        d->coeffs[n] = (float)h;
+        sum += h;
+    }
+
+    // Unity gain at DC
+    for (int n = 0; n < d->taps; n++) {
+        d->coeffs[n] = (float)(d->coeffs[n] / sum);
+    }
+    return ESP_OK;
+}
+
+void fir_decimator_deinit(fir_decimator_t *d)
+{
+    if (!d) return;
+    free(d->coeffs);
+    free(d->work);
+    d->coeffs = NULL;
+    d->work = NULL;
+}
+
+size_t fir_decimator_process(fir_decimator_t *d, const int32_t *in, int32_t *out)
+{
+    if (!d || !d->work || !in || !out) return 0;
+
+    const size_t hist = d->taps - 1;
+    float *x = d->work + hist;
+    for (size_t i = 0; i < d->block; i++) {
+        x[i] = (float)(in[i] >> 8);
+    }
+
+    // Output m ends on the newest input of its group of `factor`
+    const size_t outputs = d->block / d->factor;
+    for (size_t m = 0; m < outputs; m++) {
+        float y;
+        dsps_dotprod_f32_ae32(d->coeffs, d->work + m * d->factor + d->factor - 1, &y, d->taps);
+        if (y > FULL_SCALE_24)  y = FULL_SCALE_24;
+        if (y < -FULL_SCALE_24) y = -FULL_SCALE_24;
+        out[m] = (int32_t)lrintf(y) << 8;
+    }
+
+    // Keep the newest taps - 1 inputs as history for the next block
+    memmove(d->work, d->work + d->block, hist * sizeof(float));
+    return outputs;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Integer-factor FIR decimator on 24-bit samples (32-bit, left-aligned as
+ * read from the INMP441).
+ *
+ * Only the retained outputs are computed (the polyphase form: every tap
+ * is touched once per output, taps / factor multiplies per input sample),
+ * each as one contiguous esp-dsp dot product over a linear history buffer,
+ * so the inner loop never wraps.
+ *
+ * The anti-alias filter is a Blackman-windowed sinc with 32 * factor + 1
+ * taps and its cutoff at the output Nyquist frequency: flat (within
+ * 0.1 dB) to 0.4 x the output rate, at least 75 dB down from 0.6 x, so
+ * aliases only fold into the top fifth of the output band.
+ * Group delay is 16 * factor input samples, i.e. 16 output samples.
+ */
+
+#define FIR_DECIMATOR_TAPS_PER_FACTOR   32
+
+typedef struct {
+    float *coeffs;      // time-reversed taps, oldest sample first
+    float *work;        // (taps - 1) history followed by one input block
+    int taps;
+    int factor;
+    size_t block;       // input samples per call
+} fir_decimator_t;
+
+/*
+ * factor: 1..8; block: input samples per fir_decimator_process call, a
+ * multiple of factor. Allocates the taps and one block of float history.
+ */
+esp_err_t fir_decimator_init(fir_decimator_t *d, int factor, size_t block);
+void fir_decimator_deinit(fir_decimator_t *d);
+
+// Decimate one block of input into block / factor outputs; returns the output count
+size_t fir_decimator_process(fir_decimator_t *d, const int32_t *in, int32_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+"""
+Generate the constant DSP tables for one FFT size as C source.
+
+Run by the dsp component's CMakeLists at build time; the tables land in
+flash (.rodata) instead of being computed into heap RAM at boot:
+
+  dsp_fft_twiddles   radix-2 twiddles, N/2 complex, bit-reversed order
+                     (the layout dsps_fft2r_init_fc32 produces)
+  dsp_fft_twiddles_sc16  the same in Q15 for dsps_fft2r_sc16
+  dsp_fft_bitrev     index pairs to swap after the transform
+  dsp_hann_window    periodic Hann window, N points (float and Q15)
+  dsp_mel_*          triangular mel filterbank over the N/2 magnitude bins
+
+usage: gen_tables.py <fft_size> <sample_rate> <mel_bands> <out.h> <out.c>
+"""
+
+import math
+import os
+import sys
+
+
+def bit_reverse(i, bits):
+    r = 0
+    for _ in range(bits):
+        r = (r << 1) | (i & 1)
+        i >>= 1
+    return r
+
+
+def twiddles(n):
+    # Same values as dsps_gen_w_r2_fc32, then bit-reversed over N/2 entries
+    half = n // 2
+    w = [(math.cos(2 * math.pi * i / n), math.sin(2 * math.pi * i / n)) for i in range(half)]
+    bits = half.bit_length() - 1
+    out = [None] * half
+    for i in range(half):
+        out[bit_reverse(i, bits)] = w[i]
+    return [v for pair in out for v in pair]
+
+
+def bitrev_pairs(n):
+    bits = n.bit_length() - 1
+    return [(i, bit_reverse(i, bits)) for i in range(n) if i < bit_reverse(i, bits)]
+
+
+def hann(n):
+    # Periodic: the spectrum analysis form, w[0] = 0, no repeated end point
+    return [0.5 - 0.5 * math.cos(2 * math.pi * i / n) for i in range(n)]
+
+
+def mel(f):
+    return 2595.0 * math.log10(1.0 + f / 700.0)
+
+
+def mel_inv(m):
+    return 700.0 * (10 ** (m / 2595.0) - 1.0)
+
+
+def mel_filterbank(n, rate, bands):
+    """Triangles between mel-spaced edges; returns (first_bin, count, offset) and weights"""
+    bins = n // 2
+    bin_hz = rate / n
+    edges = [mel_inv(mel(rate / 2) * i / (bands + 1)) for i in range(bands + 2)]
+
+    table, weights = [], []
+    for b in range(bands):
+        lo, mid, hi = edges[b], edges[b + 1], edges[b + 2]
+        first, w = None, []
+        for k in range(1, bins):
+            f = k * bin_hz
+            if lo < f < hi:
+                v = (f - lo) / (mid - lo) if f <= mid else (hi - f) / (hi - mid)
+                if first is None:
+                    first = k
+                w.append(v)
+        if first is None:
+            # Narrower than one bin: take the bin nearest the centre
+            first, w = max(1, min(bins - 1, round(mid / bin_hz))), [1.0]
+        table.append((first, len(w), len(weights)))
+        weights.extend(w)
+    return table, weights, edges
+
+
+def q15(values):
+    return [max(-32768, min(32767, int(round(v * 32767)))) for v in values]
+
+
+def ints(values, per_line=12):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append("    " + " ".join("%d," % v for v in values[i:i + per_line]))
+    return "\n".join(lines)
+
+
+def floats(values, per_line=4):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append("    " + " ".join("%.9ef," % v for v in values[i:i + per_line]))
+    return "\n".join(lines)
+
+
+def main():
+    if len(sys.argv) != 6:
+        sys.exit(__doc__)
+    n, rate, bands = (int(a) for a in sys.argv[1:4])
+    out_h, out_c = sys.argv[4:6]
+    if n < 8 or n & (n - 1) or n > 4096:
+        sys.exit("FFT size must be a power of two in 8..4096")
+
+    tw = twiddles(n)
+    pairs = bitrev_pairs(n)
+    win = hann(n)
+    fb, fb_weights, edges = mel_filterbank(n, rate, bands)
+    coherent_gain = sum(win) / n
+    power_gain = sum(v * v for v in win) / n
+
+    header = """// Generated by gen_tables.py for a {n}-point FFT at {rate} Hz. Do not edit.
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {{
+#endif
+
+#define DSP_TABLES_FFT_SIZE         {n}
+#define DSP_TABLES_SAMPLE_RATE      {rate}
+#define DSP_TABLES_BITREV_PAIRS     {pairs}
+#define DSP_MEL_BANDS               {bands}
+#define DSP_MEL_WEIGHTS             {weights}
+#define DSP_HANN_COHERENT_GAIN      {cg:.9f}f
+#define DSP_HANN_POWER_GAIN         {pg:.9f}f
+
+typedef struct {{
+    uint16_t first_bin;
+    uint16_t bin_count;
+    uint16_t weight_offset;     // into dsp_mel_weights
+}} dsp_mel_band_t;
+
+extern const float dsp_fft_twiddles[DSP_TABLES_FFT_SIZE];
+extern const int16_t dsp_fft_twiddles_sc16[DSP_TABLES_FFT_SIZE];
+extern const uint16_t dsp_fft_bitrev[DSP_TABLES_BITREV_PAIRS][2];
+extern const float dsp_hann_window[DSP_TABLES_FFT_SIZE];
+extern const int16_t dsp_hann_window_q15[DSP_TABLES_FFT_SIZE];
+extern const dsp_mel_band_t dsp_mel_bands[DSP_MEL_BANDS];
+extern const float dsp_mel_weights[DSP_MEL_WEIGHTS];
+extern const float dsp_mel_center_hz[DSP_MEL_BANDS];
+
+#ifdef __cplusplus
+}}
+#endif
+""".format(n=n, rate=rate, pairs=len(pairs), bands=bands, weights=len(fb_weights),
+           cg=coherent_gain, pg=power_gain)
+
+    source = ["// Generated by gen_tables.py for a %d-point FFT at %d Hz. Do not edit." % (n, rate),
+              '#include "%s"' % os.path.basename(out_h), ""]
+    source += ["// Aligned like the heap table dsps_fft2r_init_fc32 would allocate",
+               "const float dsp_fft_twiddles[DSP_TABLES_FFT_SIZE] __attribute__((aligned(16))) = {",
+               floats(tw), "};", ""]
+    source += ["const int16_t dsp_fft_twiddles_sc16[DSP_TABLES_FFT_SIZE] __attribute__((aligned(16))) = {",
+               ints(q15(tw)), "};", ""]
+    source += ["const uint16_t dsp_fft_bitrev[DSP_TABLES_BITREV_PAIRS][2] = {"]
+    for i in range(0, len(pairs), 6):
+        source.append("    " + " ".join("{%d, %d}," % p for p in pairs[i:i + 6]))
+    source += ["};", ""]
+    source += ["const float dsp_hann_window[DSP_TABLES_FFT_SIZE] = {", floats(win), "};", ""]
+    source += ["const int16_t dsp_hann_window_q15[DSP_TABLES_FFT_SIZE] = {", ints(q15(win)), "};", ""]
+    source += ["const dsp_mel_band_t dsp_mel_bands[DSP_MEL_BANDS] = {"]
+    source += ["    {%d, %d, %d}," % b for b in fb]
+    source += ["};", ""]
+    source += ["const float dsp_mel_weights[DSP_MEL_WEIGHTS] = {", floats(fb_weights), "};", ""]
+    source += ["const float dsp_mel_center_hz[DSP_MEL_BANDS] = {", floats(edges[1:-1]), "};", ""]
+
+    for path, text in ((out_h, header), (out_c, "\n".join(source))):
+        # Leave unchanged files alone so dependents are not rebuilt
+        try:
+            with open(path) as f:
+                if f.read() == text:
+                    continue
+        except OSError:
+            pass
+        with open(path, "w") as f:
+            f.write(text)
+
+
+if __name__ == "__main__":
+    main()
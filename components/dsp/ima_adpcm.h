@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// IMA/DVI ADPCM: 4 bits per 16-bit sample, two samples per byte (low nibble first)
+typedef struct {
+    int16_t predictor;
+    int8_t  index;
+} ima_adpcm_state_t;
+
+/*
+ * Encode `count` samples (must be even) into count / 2 bytes. The state is
+ * updated so consecutive calls form one continuous stream.
+ */
+size_t ima_adpcm_encode(ima_adpcm_state_t *state, const int16_t *in, size_t count, uint8_t *out);
+
+// Decode `count` samples (must be even) from count / 2 bytes
+void ima_adpcm_decode(ima_adpcm_state_t *state, const uint8_t *in, size_t count, int16_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,235 @@
+/**
+ * @file sound_level.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements a calibrated sound level meter: fixed-point A/C weighting
+ *        biquads, fast/slow time weighting and Leq/Lmax/Lmin integration.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include "sound_level.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_cpu.h"
+
+#define Q30             (1 << 30)
+#define REF_SPL_DB      94.0f
+#define SINE_FS_DB      3.0103f     // full-scale sine has mean square 1/2
+#define FULL_SCALE      8388608.0f  // 2^23, 24-bit samples
+#define FAST_TAU_S      0.125f
+#define SLOW_TAU_S      1.0f
+#define BLOCK_HZ        1000        // time-weighting update rate
+#define LEVEL_FLOOR_MS  1e-12f      // -120 dBFS, keeps log10 finite
+
+// IEC 61672 pole frequencies (Hz)
+#define POLE_F1         20.598997
+#define POLE_F2         107.65265
+#define POLE_F3         737.86223
+#define POLE_F4         12194.217
+
+typedef struct {
+    double b[3];    // s^2, s, 1
+    double a[3];
+} analog_section_t;
+
+// Bilinear transform of one analog section into Q30 coefficients
+static void design_section(sound_level_biquad_t *bq, const analog_section_t *s, double fs)
+{
+    const double k = 2.0 * fs;
+    const double k2 = k * k;
+
+    double b0 = s->b[0] * k2 + s->b[1] * k + s->b[2];
+    double b1 = 2.0 * s->b[2] - 2.0 * s->b[0] * k2;
+    double b2 = s->b[0] * k2 - s->b[1] * k + s->b[2];
+    double a0 = s->a[0] * k2 + s->a[1] * k + s->a[2];
+    double a1 = 2.0 * s->a[2] - 2.0 * s->a[0] * k2;
+    double a2 = s->a[0] * k2 - s->a[1] * k + s->a[2];
+
+    memset(bq, 0, sizeof(*bq));
+    bq->b0 = (int32_t)lround(b0 / a0 * Q30);
+    bq->b1 = (int32_t)lround(b1 / a0 * Q30);
+    bq->b2 = (int32_t)lround(b2 / a0 * Q30);
+    bq->a1 = (int32_t)lround(a1 / a0 * Q30);
+    bq->a2 = (int32_t)lround(a2 / a0 * Q30);
+}
+
+// |H(e^jw)|^2 of the quantized cascade
+static double cascade_power(const sound_level_meter_t *m, double f, double fs)
+{
+    const double w = 2.0 * M_PI * f / fs;
+    double power = 1.0;
+
+    for (int i = 0; i < m->section_count; i++) {
+        const sound_level_biquad_t *bq = &m->sections[i];
+        double b0 = bq->b0 / (double)Q30, b1 = bq->b1 / (double)Q30, b2 = bq->b2 / (double)Q30;
+        double a1 = bq->a1 / (double)Q30, a2 = bq->a2 / (double)Q30;
+
+        double nr = b0 + b1 * cos(w) + b2 * cos(2 * w);
+        double ni = -b1 * sin(w) - b2 * sin(2 * w);
+        double dr = 1.0 + a1 * cos(w) + a2 * cos(2 * w);
+        double di = -a1 * sin(w) - a2 * sin(2 * w);
+        power *= (nr * nr + ni * ni) / (dr * dr + di * di);
+    }
+    return power;
+}
+
+void sound_level_init(sound_level_meter_t *m, int sample_rate,
+                      sound_level_weighting_t weighting,
+                      float sensitivity_dbfs, float interval_s)
+{
+    const double w1 = 2.0 * M_PI * POLE_F1;
+    const double w2 = 2.0 * M_PI * POLE_F2;
+    const double w3 = 2.0 * M_PI * POLE_F3;
+    const double w4 = 2.0 * M_PI * POLE_F4;
+
+    // Double zero at DC with the low poles; unity-DC low-pass for the high pole
+    const analog_section_t hp1  = { { 1, 0, 0 }, { 1, 2 * w1, w1 * w1 } };
+    const analog_section_t hp23 = { { 1, 0, 0 }, { 1, w2 + w3, w2 * w3 } };
+    const analog_section_t lp4  = { { 0, 0, w4 * w4 }, { 1, 2 * w4, w4 * w4 } };
+
+    memset(m, 0, sizeof(*m));
+    m->st.weighting = weighting;
+    m->st.interval_s = interval_s;
+
+    switch (weighting) {
+    case SOUND_LEVEL_WEIGHTING_A:
+        design_section(&m->sections[m->section_count++], &hp1, sample_rate);
+        design_section(&m->sections[m->section_count++], &hp23, sample_rate);
+        design_section(&m->sections[m->section_count++], &lp4, sample_rate);
+        break;
+    case SOUND_LEVEL_WEIGHTING_C:
+        design_section(&m->sections[m->section_count++], &hp1, sample_rate);
+        design_section(&m->sections[m->section_count++], &lp4, sample_rate);
+        break;
+    default:
+        break;
+    }
+
+    // 0 dB at 1 kHz, then full-scale mean square -> dB SPL
+    float norm_db = -10.0f * (float)log10(cascade_power(m, 1000.0, sample_rate));
+    m->db_offset = norm_db + SINE_FS_DB + REF_SPL_DB - sensitivity_dbfs;
+
+    m->block_len = sample_rate / BLOCK_HZ;
+    if (m->block_len == 0) m->block_len = 1;
+    const float block_s = (float)m->block_len / sample_rate;
+    m->fast_decay = expf(-block_s / FAST_TAU_S);
+    m->slow_decay = expf(-block_s / SLOW_TAU_S);
+
+    m->interval_len = (uint32_t)(interval_s / block_s + 0.5f);
+    if (m->interval_len == 0) m->interval_len = 1;
+    m->interval_min_ms = INFINITY;
+}
+
+static inline int32_t biquad_q30(sound_level_biquad_t *bq, int32_t x)
+{
+    int64_t acc = (int64_t)bq->b0 * x + (int64_t)bq->b1 * bq->x1 + (int64_t)bq->b2 * bq->x2
+                - (int64_t)bq->a1 * bq->y1 - (int64_t)bq->a2 * bq->y2 + bq->err;
+    int32_t y = (int32_t)(acc >> 30);
+    bq->err = acc - ((int64_t)y << 30);
+    bq->x2 = bq->x1;
+    bq->x1 = x;
+    bq->y2 = bq->y1;
+    bq->y1 = y;
+    return y;
+}
+
+static inline float level_db(const sound_level_meter_t *m, float ms)
+{
+    return 10.0f * log10f(ms > LEVEL_FLOOR_MS ? ms : LEVEL_FLOOR_MS) + m->db_offset;
+}
+
+// One full time-weighting block; returns true when it closed an interval
+static bool end_block(sound_level_meter_t *m)
+{
+    const float ms = (float)m->block_sum / m->block_n / (FULL_SCALE * FULL_SCALE);
+    m->block_sum = 0;
+    m->block_n = 0;
+
+    // Start settled instead of rising from silence
+    if (m->st.intervals == 0 && m->interval_blocks == 0 && m->fast_ms == 0.0f) {
+        m->fast_ms = m->slow_ms = ms;
+    }
+    m->fast_ms = m->fast_ms * m->fast_decay + ms * (1.0f - m->fast_decay);
+    m->slow_ms = m->slow_ms * m->slow_decay + ms * (1.0f - m->slow_decay);
+
+    m->interval_sum += ms;
+    if (m->fast_ms > m->interval_max_ms) m->interval_max_ms = m->fast_ms;
+    if (m->fast_ms < m->interval_min_ms) m->interval_min_ms = m->fast_ms;
+
+    if (++m->interval_blocks < m->interval_len) {
+        return false;
+    }
+
+    m->st.leq_db  = level_db(m, (float)(m->interval_sum / m->interval_blocks));
+    m->st.lmax_db = level_db(m, m->interval_max_ms);
+    m->st.lmin_db = level_db(m, m->interval_min_ms);
+    m->st.intervals++;
+
+    m->interval_sum = 0.0;
+    m->interval_blocks = 0;
+    m->interval_max_ms = 0.0f;
+    m->interval_min_ms = INFINITY;
+    return true;
+}
+
+bool sound_level_process(sound_level_meter_t *m, const int32_t *samples, size_t count)
+{
+    bool closed = false;
+
+    for (size_t i = 0; i < count; i++) {
+        int32_t y = samples[i] >> 8;    // 24-bit
+        for (int s = 0; s < m->section_count; s++) {
+            y = biquad_q30(&m->sections[s], y);
+        }
+        m->block_sum += (int64_t)y * y;
+
+        if (++m->block_n == m->block_len) {
+            closed |= end_block(m);
+        }
+    }
+
+    m->st.fast_db = level_db(m, m->fast_ms);
+    m->st.slow_db = level_db(m, m->slow_ms);
+    return closed;
+}
+
+const char *sound_level_weighting_name(sound_level_weighting_t weighting)
+{
+    switch (weighting) {
+    case SOUND_LEVEL_WEIGHTING_A: return "A";
+    case SOUND_LEVEL_WEIGHTING_C: return "C";
+    default:                      return "Z";
+    }
+}
+
+esp_err_t sound_level_benchmark(int sample_rate, size_t count, int frames, uint32_t *cycles_out)
+{
+    if (!cycles_out || count == 0 || frames <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int32_t *frame = malloc(count * sizeof(int32_t));
+    if (!frame) return ESP_ERR_NO_MEM;
+
+    // Broadband input so no section sees only zeros
+    uint32_t lfsr = 0xACE1u;
+    for (size_t i = 0; i < count; i++) {
+        lfsr = lfsr * 1664525u + 1013904223u;
+        frame[i] = (int32_t)(lfsr & 0xFFFFFF00u) >> 2;
+    }
+
+    sound_level_meter_t meter;
+    for (int w = 0; w < SOUND_LEVEL_WEIGHTING_COUNT; w++) {
+        sound_level_init(&meter, sample_rate, (sound_level_weighting_t)w, -26.0f, 1.0f);
+
+        uint32_t start = esp_cpu_get_cycle_count();
+        for (int f = 0; f < frames; f++) {
+            sound_level_process(&meter, frame, count);
+        }
+        cycles_out[w] = (esp_cpu_get_cycle_count() - start) / (uint32_t)frames;
+    }
+
+    free(frame);
+    return ESP_OK;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Sound level meter on 24-bit samples (32-bit, left-aligned as read from
+ * the INMP441).
+ *
+ * Frequency weighting runs on every sample as a cascade of Q30 biquads
+ * (direct form I, 64-bit accumulator, error feedback), designed at init by
+ * bilinear transform of the IEC 61672 analog poles and normalized to 0 dB
+ * at 1 kHz. Above roughly a quarter of the sample rate the bilinear
+ * mapping rolls off faster than the standard allows, so at 16 kHz only the
+ * A/C response below ~4 kHz is within class 2 tolerance.
+ *
+ * Fast (125 ms) and slow (1 s) exponential time weighting are applied to
+ * the weighted mean square of each 1 ms block. Leq, Lmax and Lmin (of the
+ * fast level) are reported per interval.
+ */
+
+#define SOUND_LEVEL_MAX_SECTIONS    3
+
+typedef enum {
+    SOUND_LEVEL_WEIGHTING_A = 0,
+    SOUND_LEVEL_WEIGHTING_C,
+    SOUND_LEVEL_WEIGHTING_Z,    // unweighted
+    SOUND_LEVEL_WEIGHTING_COUNT,
+} sound_level_weighting_t;
+
+typedef struct {
+    int32_t b0, b1, b2, a1, a2;     // Q30, a0 = 1
+    int32_t x1, x2, y1, y2;
+    int64_t err;                    // rounding residue fed back into the next output
+} sound_level_biquad_t;
+
+// Levels in dB SPL
+typedef struct {
+    float fast_db;          // current fast time-weighted level
+    float slow_db;          // current slow time-weighted level
+    float leq_db;           // last complete interval
+    float lmax_db;          // highest fast level in that interval
+    float lmin_db;          // lowest fast level in that interval
+    uint32_t intervals;     // completed intervals since init
+    float interval_s;
+    sound_level_weighting_t weighting;
+} sound_level_stats_t;
+
+typedef struct {
+    sound_level_biquad_t sections[SOUND_LEVEL_MAX_SECTIONS];
+    int section_count;
+
+    float db_offset;        // full-scale mean square -> dB SPL, incl. weighting gain
+    float fast_decay;       // per block
+    float slow_decay;
+    float fast_ms;          // time-weighted mean squares, full scale = 1
+    float slow_ms;
+
+    uint32_t block_len;     // samples per time-weighting block
+    uint32_t block_n;
+    int64_t block_sum;
+
+    double interval_sum;    // full-scale mean square x blocks
+    uint32_t interval_blocks;
+    uint32_t interval_len;  // blocks per interval
+    float interval_max_ms;
+    float interval_min_ms;
+
+    sound_level_stats_t st;
+} sound_level_meter_t;
+
+/*
+ * sensitivity_dbfs: microphone output for a 94 dB SPL 1 kHz tone, in dB
+ * relative to a full-scale sine (INMP441: -26). interval_s: Leq period.
+ */
+void sound_level_init(sound_level_meter_t *m, int sample_rate,
+                      sound_level_weighting_t weighting,
+                      float sensitivity_dbfs, float interval_s);
+
+// Weight and integrate `count` samples; true when an interval completed (see m->st)
+bool sound_level_process(sound_level_meter_t *m, const int32_t *samples, size_t count);
+
+const char *sound_level_weighting_name(sound_level_weighting_t weighting);
+
+/*
+ * CPU cycles per call of sound_level_process on a frame of `count` samples
+ * at `sample_rate`, for each weighting (A, C, Z). Averaged over `frames`
+ * calls; cycles_out needs SOUND_LEVEL_WEIGHTING_COUNT entries.
+ */
+esp_err_t sound_level_benchmark(int sample_rate, size_t count, int frames, uint32_t *cycles_out);
+
+#ifdef __cplusplus
+}
+#endif
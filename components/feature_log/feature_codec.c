@@ -0,0 +1,287 @@
+/**
+ * @file feature_codec.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements the block codec of the feature log: delta-of-delta
+ *        timestamps and XOR-compressed floats in flash-sector sized blocks.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include <string.h>
+
+#include "feature_codec.h"
+
+#define HEADER_BYTES        sizeof(feature_block_header_t)
+
+// Worst case of one record: 3 + 64 timestamp, 2 x (2 + 5 + 5 + 32), 3 scene
+#define MAX_RECORD_BITS     158
+
+// Bit stream
+static void put_bits(feature_encoder_t *e, uint64_t value, unsigned count)
+{
+    uint8_t *p = e->block + HEADER_BYTES;
+    while (count--) {
+        size_t byte = e->bit >> 3;
+        uint8_t mask = 0x80 >> (e->bit & 7);
+        if ((value >> count) & 1) {
+            p[byte] |= mask;
+        } else {
+            p[byte] &= ~mask;
+        }
+        e->bit++;
+    }
+}
+
+typedef struct {
+    const uint8_t *p;
+    size_t bit;
+    size_t end;
+} bit_reader_t;
+
+static bool get_bits(bit_reader_t *r, unsigned count, uint64_t *out)
+{
+    if (r->bit + count > r->end) return false;
+    uint64_t v = 0;
+    while (count--) {
+        v = (v << 1) | ((r->p[r->bit >> 3] >> (7 - (r->bit & 7))) & 1);
+        r->bit++;
+    }
+    *out = v;
+    return true;
+}
+
+static int64_t sign_extend(uint64_t v, unsigned bits)
+{
+    uint64_t m = 1ULL << (bits - 1);
+    return (int64_t)((v ^ m) - m);
+}
+
+static inline uint32_t float_bits(float f)
+{
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static inline float bits_float(uint32_t u)
+{
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+// Round to `mantissa` bits; a carry into the exponent is correct rounding
+static uint32_t quantize(float f, uint8_t mantissa)
+{
+    uint32_t u = float_bits(f);
+    if (mantissa >= 23) return u;
+    unsigned drop = 23 - mantissa;
+    u += 1u << (drop - 1);
+    return u & ~((1u << drop) - 1);
+}
+
+// Encoder
+void feature_encoder_begin(feature_encoder_t *e, uint8_t *block, size_t size,
+                           uint8_t mantissa_bits)
+{
+    memset(e, 0, sizeof(*e));
+    e->block = block;
+    e->size = size;
+    e->mantissa_bits = mantissa_bits;
+    memset(block, 0, size);
+}
+
+static void put_timestamp(feature_encoder_t *e, int64_t ts)
+{
+    int64_t delta = ts - e->prev_us;
+    int64_t dod = delta - e->prev_delta;
+
+    if (dod == 0) {
+        put_bits(e, 0x0, 1);
+    } else if (dod >= -(1 << 19) && dod < (1 << 19)) {
+        put_bits(e, 0x2, 2);
+        put_bits(e, (uint64_t)dod & 0xFFFFF, 20);
+    } else if (dod >= INT32_MIN && dod <= INT32_MAX) {
+        put_bits(e, 0x6, 3);
+        put_bits(e, (uint64_t)dod & 0xFFFFFFFF, 32);
+    } else {
+        put_bits(e, 0x7, 3);
+        put_bits(e, (uint64_t)dod, 64);
+    }
+    e->prev_delta = delta;
+    e->prev_us = ts;
+}
+
+static void put_float(feature_encoder_t *e, int i, uint32_t bits)
+{
+    uint32_t x = bits ^ e->prev_bits[i];
+    e->prev_bits[i] = bits;
+
+    if (x == 0) {
+        put_bits(e, 0x0, 1);
+        return;
+    }
+
+    unsigned lead = __builtin_clz(x);
+    unsigned trail = __builtin_ctz(x);
+    if (lead > 31) lead = 31;
+
+    // Reuse the previous window when the changed bits fit inside it
+    if (e->lead[i] + e->trail[i] > 0 && lead >= e->lead[i] && trail >= e->trail[i]) {
+        put_bits(e, 0x2, 2);
+        put_bits(e, x >> e->trail[i], 32 - e->lead[i] - e->trail[i]);
+        return;
+    }
+
+    unsigned len = 32 - lead - trail;
+    put_bits(e, 0x3, 2);
+    put_bits(e, lead, 5);
+    put_bits(e, len - 1, 5);
+    put_bits(e, x >> trail, len);
+    e->lead[i] = lead;
+    e->trail[i] = trail;
+}
+
+bool feature_encoder_append(feature_encoder_t *e, const feature_record_t *rec)
+{
+    size_t capacity = (e->size - HEADER_BYTES) * 8;
+    if (e->bit + MAX_RECORD_BITS > capacity || e->records == UINT16_MAX) {
+        return false;
+    }
+
+    uint32_t rms = quantize(rec->rms, e->mantissa_bits);
+    uint32_t centroid = quantize(rec->centroid, e->mantissa_bits);
+
+    if (e->records == 0) {
+        put_bits(e, (uint64_t)rec->timestamp_us, 64);
+        put_bits(e, rms, 32);
+        put_bits(e, centroid, 32);
+        put_bits(e, rec->scene & 3, 2);
+        e->first_us = rec->timestamp_us;
+        e->prev_us = rec->timestamp_us;
+        e->prev_bits[0] = rms;
+        e->prev_bits[1] = centroid;
+        e->prev_scene = rec->scene & 3;
+    } else {
+        put_timestamp(e, rec->timestamp_us);
+        put_float(e, 0, rms);
+        put_float(e, 1, centroid);
+        if ((rec->scene & 3) == e->prev_scene) {
+            put_bits(e, 0x0, 1);
+        } else {
+            put_bits(e, 0x1, 1);
+            put_bits(e, rec->scene & 3, 2);
+            e->prev_scene = rec->scene & 3;
+        }
+    }
+
+    e->records++;
+    return true;
+}
+
+void feature_encoder_finish(feature_encoder_t *e)
+{
+    feature_block_header_t *h = (feature_block_header_t *)e->block;
+    h->magic    = FEATURE_BLOCK_MAGIC;
+    h->records  = e->records;
+    h->bytes    = (uint16_t)(HEADER_BYTES + (e->bit + 7) / 8);
+    h->first_us = e->first_us;
+    h->last_us  = e->prev_us;
+}
+
+// Decoder
+static bool get_float(bit_reader_t *r, uint32_t *prev, uint8_t *lead, uint8_t *trail)
+{
+    uint64_t v, ctl;
+    if (!get_bits(r, 1, &ctl)) return false;
+    if (ctl == 0) return true;
+
+    if (!get_bits(r, 1, &ctl)) return false;
+    if (ctl == 0) {
+        if (!get_bits(r, 32 - *lead - *trail, &v)) return false;
+        *prev ^= (uint32_t)v << *trail;
+        return true;
+    }
+
+    uint64_t l, len;
+    if (!get_bits(r, 5, &l) || !get_bits(r, 5, &len)) return false;
+    len += 1;
+    if (l + len > 32) return false;
+    if (!get_bits(r, (unsigned)len, &v)) return false;
+    *lead = (uint8_t)l;
+    *trail = (uint8_t)(32 - l - len);
+    *prev ^= (uint32_t)v << *trail;
+    return true;
+}
+
+size_t feature_block_decode(const uint8_t *block, size_t size,
+                            feature_record_cb cb, void *ctx)
+{
+    feature_block_header_t h;
+    if (size < HEADER_BYTES) return 0;
+    memcpy(&h, block, sizeof(h));
+    if (h.magic != FEATURE_BLOCK_MAGIC || h.bytes > size || h.bytes < HEADER_BYTES) {
+        return 0;
+    }
+
+    bit_reader_t r = {
+        .p   = block + HEADER_BYTES,
+        .bit = 0,
+        .end = (size_t)(h.bytes - HEADER_BYTES) * 8,
+    };
+
+    feature_record_t rec;
+    uint32_t bits[2] = { 0, 0 };
+    uint8_t lead[2] = { 0, 0 };
+    uint8_t trail[2] = { 0, 0 };
+    int64_t delta = 0;
+    uint64_t v;
+    size_t n;
+
+    for (n = 0; n < h.records; n++) {
+        if (n == 0) {
+            uint64_t ts, a, b, s;
+            if (!get_bits(&r, 64, &ts) || !get_bits(&r, 32, &a) ||
+                !get_bits(&r, 32, &b) || !get_bits(&r, 2, &s)) break;
+            rec.timestamp_us = (int64_t)ts;
+            bits[0] = (uint32_t)a;
+            bits[1] = (uint32_t)b;
+            rec.scene = (uint8_t)s;
+        } else {
+            // Timestamp
+            int64_t dod = 0;
+            if (!get_bits(&r, 1, &v)) break;
+            if (v) {
+                if (!get_bits(&r, 1, &v)) break;
+                if (!v) {
+                    if (!get_bits(&r, 20, &v)) break;
+                    dod = sign_extend(v, 20);
+                } else {
+                    if (!get_bits(&r, 1, &v)) break;
+                    unsigned width = v ? 64 : 32;
+                    if (!get_bits(&r, width, &v)) break;
+                    dod = (width == 64) ? (int64_t)v : sign_extend(v, 32);
+                }
+            }
+            delta += dod;
+            rec.timestamp_us += delta;
+
+            if (!get_float(&r, &bits[0], &lead[0], &trail[0]) ||
+                !get_float(&r, &bits[1], &lead[1], &trail[1])) break;
+
+            if (!get_bits(&r, 1, &v)) break;
+            if (v) {
+                if (!get_bits(&r, 2, &v)) break;
+                rec.scene = (uint8_t)v;
+            }
+        }
+
+        rec.rms = bits_float(bits[0]);
+        rec.centroid = bits_float(bits[1]);
+        if (!cb(&rec, ctx)) {
+            n++;
+            break;
+        }
+    }
+    return n;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FEATURE_BLOCK_MAGIC     0x30474C46  /* "FLG0" */
+#define FEATURE_BLOCK_SIZE      4096        // one flash sector
+
+// One logged point
+typedef struct {
+    int64_t timestamp_us;   // esp_timer time of the first sample
+    float rms;
+    float centroid;         // Hz, 0 when not computed
+    uint8_t scene;          // audio_scene_t
+} feature_record_t;
+
+/*
+ * Block layout (little-endian header, then a big-endian bit stream):
+ *
+ *   feature_block_header_t
+ *   record 0: timestamp (64 bits), rms (32), centroid (32), scene (2)
+ *   record n: timestamp delta-of-delta
+ *                 '0'            unchanged period
+ *                 '10'  + 20     signed
+ *                 '110' + 32     signed
+ *                 '111' + 64     signed
+ *             rms, centroid: XOR with the previous value (Gorilla)
+ *                 '0'            identical
+ *                 '10'  + bits   inside the previous leading/trailing window
+ *                 '11'  + 5 leading zeros + 5 (length - 1) + bits
+ *             scene
+ *                 '0'            unchanged
+ *                 '1'   + 2      new scene
+ *
+ * Floats are rounded to `mantissa_bits` before XOR so sensor noise in the
+ * low mantissa bits does not defeat the compression.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;         // FEATURE_BLOCK_MAGIC
+    uint32_t seq;           // block number since the log was created
+    uint32_t boot;          // boot the records belong to
+    uint16_t records;
+    uint16_t bytes;         // header + used payload bytes
+    int64_t first_us;
+    int64_t last_us;
+    uint32_t crc;           // CRC-32 of the used bytes with this field zero
+} feature_block_header_t;
+
+typedef struct {
+    uint8_t *block;
+    size_t size;
+    size_t bit;             // write position in the payload
+
+    uint8_t mantissa_bits;
+    uint16_t records;
+    int64_t first_us;
+    int64_t prev_us;
+    int64_t prev_delta;
+    uint32_t prev_bits[2];  // rms, centroid
+    uint8_t lead[2];
+    uint8_t trail[2];
+    uint8_t prev_scene;
+} feature_encoder_t;
+
+// Start a new block in `block` (at least FEATURE_BLOCK_SIZE bytes)
+void feature_encoder_begin(feature_encoder_t *e, uint8_t *block, size_t size,
+                           uint8_t mantissa_bits);
+
+// Append one record; false when the block is full (nothing written)
+bool feature_encoder_append(feature_encoder_t *e, const feature_record_t *rec);
+
+/*
+ * Fill the header fields owned by the encoder (records, bytes, first/last
+ * time). The caller sets seq, boot and crc. Can be called repeatedly while
+ * appending.
+ */
+void feature_encoder_finish(feature_encoder_t *e);
+
+// Decode every record of a block; the callback returns false to stop.
+// Returns the number of records decoded.
+typedef bool (*feature_record_cb)(const feature_record_t *rec, void *ctx);
+size_t feature_block_decode(const uint8_t *block, size_t size,
+                            feature_record_cb cb, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,317 @@
+/**
+ * @file feature_log.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements the flash-backed feature history: decimation and block
+ *        compression off the real-time path, a ring of one-sector blocks on a
+ *        raw flash partition and an in-RAM block index for time-range queries.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+
+#include "feature_log.h"
+#include "metrics.h"
+#include "sdkconfig.h"
+
+#if CONFIG_FEATURE_LOG_ENABLE
+
+#define PARTITION       "featlog"
+#define MAX_BLOCKS      CONFIG_FEATURE_LOG_MAX_BLOCKS
+#define DECIMATION      CONFIG_FEATURE_LOG_DECIMATION
+#define QUEUE_LEN       32
+#define WRITER_CORE     0
+
+static const char *TAG = "feature_log";
+
+typedef struct {
+    bool valid;
+    uint32_t seq;
+    uint32_t boot;
+    int64_t first_us;
+    int64_t last_us;
+} block_index_t;
+
+// Guarded by s_lock: partition access, index and the block being filled
+static SemaphoreHandle_t s_lock;
+static const esp_partition_t *s_part;
+static block_index_t s_index[MAX_BLOCKS];
+static uint32_t s_next_seq;         // seq of the block in RAM
+static uint8_t *s_block;
+static feature_encoder_t s_enc;
+
+static uint32_t s_boot;
+static QueueHandle_t s_queue;
+
+static uint32_t block_crc(uint8_t *block, size_t bytes)
+{
+    feature_block_header_t *h = (feature_block_header_t *)block;
+    uint32_t saved = h->crc;
+    h->crc = 0;
+    uint32_t crc = esp_rom_crc32_le(0, block, bytes);
+    h->crc = saved;
+    return crc;
+}
+
+// Write the RAM block to its ring slot and start the next one. Lock held.
+static void flush_block(void)
+{
+    feature_block_header_t *h = (feature_block_header_t *)s_block;
+    uint32_t slot = s_next_seq % MAX_BLOCKS;
+
+    feature_encoder_finish(&s_enc);
+    h->seq  = s_next_seq;
+    h->boot = s_boot;
+    h->crc  = block_crc(s_block, h->bytes);
+
+    // A block is one sector: one erase and one write per block, nothing else
+    const size_t offset = (size_t)slot * FEATURE_BLOCK_SIZE;
+    esp_err_t err = esp_partition_erase_range(s_part, offset, FEATURE_BLOCK_SIZE);
+    if (err == ESP_OK) {
+        err = esp_partition_write(s_part, offset, s_block, FEATURE_BLOCK_SIZE);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Block %u write failed: %s", (unsigned)s_next_seq, esp_err_to_name(err));
+        s_index[slot].valid = false;
+    } else {
+        s_index[slot] = (block_index_t){
+            .valid    = true,
+            .seq      = h->seq,
+            .boot     = h->boot,
+            .first_us = h->first_us,
+            .last_us  = h->last_us,
+        };
+        metrics_inc(METRIC_FEATURE_LOG_BLOCKS);
+    }
+
+    s_next_seq++;
+    feature_encoder_begin(&s_enc, s_block, FEATURE_BLOCK_SIZE, CONFIG_FEATURE_LOG_MANTISSA_BITS);
+}
+
+static void encode_record(const feature_record_t *rec)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (!feature_encoder_append(&s_enc, rec)) {
+        flush_block();
+        feature_encoder_append(&s_enc, rec);
+    }
+    xSemaphoreGive(s_lock);
+}
+
+// Averages DECIMATION frames into one record; the centroid only over frames that computed it
+static void feature_log_task(void *arg)
+{
+    feature_record_t acc = { 0 };
+    uint32_t frames = 0;
+    uint32_t centroids = 0;
+
+    for (;;) {
+        feature_record_t rec;
+        if (xQueueReceive(s_queue, &rec, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        if (frames == 0) {
+            acc.timestamp_us = rec.timestamp_us;
+            acc.rms = 0.0f;
+            acc.centroid = 0.0f;
+            centroids = 0;
+        }
+        acc.rms += rec.rms;
+        if (rec.centroid > 0.0f) {
+            acc.centroid += rec.centroid;
+            centroids++;
+        }
+        acc.scene = rec.scene;
+
+        if (++frames == DECIMATION) {
+            acc.rms /= frames;
+            acc.centroid = centroids ? acc.centroid / centroids : 0.0f;
+            encode_record(&acc);
+            frames = 0;
+        }
+    }
+}
+
+// Rebuild the index from the block headers and pick the next seq and boot
+static void scan_blocks(void)
+{
+    feature_block_header_t h;
+    uint32_t next_seq = 0;
+    uint32_t last_boot = 0;
+    bool any = false;
+
+    // Erased sectors read as 0xFF and fail the magic check
+    for (uint32_t slot = 0; slot < MAX_BLOCKS; slot++) {
+        if (esp_partition_read(s_part, (size_t)slot * FEATURE_BLOCK_SIZE, &h, sizeof(h)) != ESP_OK) {
+            continue;
+        }
+        if (h.magic != FEATURE_BLOCK_MAGIC || (h.seq % MAX_BLOCKS) != slot) {
+            continue;
+        }
+        s_index[slot] = (block_index_t){
+            .valid    = true,
+            .seq      = h.seq,
+            .boot     = h.boot,
+            .first_us = h.first_us,
+            .last_us  = h.last_us,
+        };
+        if (!any || h.seq >= next_seq) next_seq = h.seq + 1;
+        if (!any || h.boot > last_boot) last_boot = h.boot;
+        any = true;
+    }
+
+    s_next_seq = next_seq;
+    s_boot = any ? last_boot + 1 : 0;
+}
+
+esp_err_t feature_log_init(void)
+{
+    s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                      PARTITION);
+    if (!s_part) {
+        ESP_LOGE(TAG, "Partition '%s' not found", PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if ((size_t)MAX_BLOCKS * FEATURE_BLOCK_SIZE > s_part->size ||
+        s_part->erase_size != FEATURE_BLOCK_SIZE) {
+        ESP_LOGE(TAG, "Partition '%s' (%u bytes, %u-byte sectors) cannot hold %d blocks",
+                 PARTITION, (unsigned)s_part->size, (unsigned)s_part->erase_size, MAX_BLOCKS);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    s_block = malloc(FEATURE_BLOCK_SIZE);
+    s_lock  = xSemaphoreCreateMutex();
+    s_queue = xQueueCreate(QUEUE_LEN, sizeof(feature_record_t));
+    if (!s_block || !s_lock || !s_queue) {
+        ESP_LOGE(TAG, "Initialization failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    scan_blocks();
+    feature_encoder_begin(&s_enc, s_block, FEATURE_BLOCK_SIZE, CONFIG_FEATURE_LOG_MANTISSA_BITS);
+
+    // Off the pipeline's core; flash writes still pause both caches briefly
+    if (xTaskCreatePinnedToCore(feature_log_task, "feature_log", 3072, NULL,
+                                tskIDLE_PRIORITY + 2, NULL, WRITER_CORE) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Boot %u, %u blocks of %d in the ring, next block %u",
+             (unsigned)s_boot,
+             (unsigned)(s_next_seq < MAX_BLOCKS ? s_next_seq : MAX_BLOCKS),
+             MAX_BLOCKS, (unsigned)s_next_seq);
+    return ESP_OK;
+}
+
+void feature_log_append(const feature_record_t *rec)
+{
+    if (!s_queue) return;
+    if (xQueueSend(s_queue, rec, 0) != pdTRUE) {
+        metrics_inc(METRIC_FEATURE_LOG_DROPPED);
+    }
+}
+
+uint32_t feature_log_boot(void)
+{
+    return s_boot;
+}
+
+static bool overlaps(int64_t first_us, int64_t last_us, int64_t from_us, int64_t to_us)
+{
+    return last_us >= from_us && first_us <= to_us;
+}
+
+esp_err_t feature_log_query(uint32_t boot, int64_t from_us, int64_t to_us,
+                            feature_log_block_cb cb, void *ctx)
+{
+    if (!s_lock) return ESP_ERR_INVALID_STATE;
+
+    uint8_t *buf = malloc(FEATURE_BLOCK_SIZE);
+    if (!buf) return ESP_ERR_NO_MEM;
+    feature_block_header_t *h = (feature_block_header_t *)buf;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    uint32_t end = s_next_seq;
+    xSemaphoreGive(s_lock);
+    uint32_t seq = (end > MAX_BLOCKS) ? end - MAX_BLOCKS : 0;
+
+    // Flash blocks, oldest first. Index check and read under one lock so the
+    // writer cannot recycle the slot in between.
+    for (; seq < end; seq++) {
+        uint32_t slot = seq % MAX_BLOCKS;
+        bool have = false;
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        const block_index_t *idx = &s_index[slot];
+        if (idx->valid && idx->seq == seq && idx->boot == boot &&
+            overlaps(idx->first_us, idx->last_us, from_us, to_us)) {
+            have = esp_partition_read(s_part, (size_t)slot * FEATURE_BLOCK_SIZE,
+                                      buf, FEATURE_BLOCK_SIZE) == ESP_OK;
+        }
+        xSemaphoreGive(s_lock);
+
+        if (!have) continue;
+        if (h->bytes > FEATURE_BLOCK_SIZE || block_crc(buf, h->bytes) != h->crc) {
+            ESP_LOGW(TAG, "Block %u failed its CRC, skipped", (unsigned)seq);
+            continue;
+        }
+        if (!cb(buf, h->bytes, ctx)) {
+            free(buf);
+            return ESP_OK;
+        }
+    }
+
+    // The block still being filled
+    bool have = false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_enc.records && boot == s_boot) {
+        feature_encoder_finish(&s_enc);
+        memcpy(buf, s_block, FEATURE_BLOCK_SIZE);
+        h->seq  = s_next_seq;
+        h->boot = s_boot;
+        have = overlaps(h->first_us, h->last_us, from_us, to_us);
+    }
+    xSemaphoreGive(s_lock);
+    if (have) {
+        h->crc = block_crc(buf, h->bytes);
+        cb(buf, h->bytes, ctx);
+    }
+
+    free(buf);
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t feature_log_init(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void feature_log_append(const feature_record_t *rec)
+{
+}
+
+uint32_t feature_log_boot(void)
+{
+    return 0;
+}
+
+esp_err_t feature_log_query(uint32_t boot, int64_t from_us, int64_t to_us,
+                            feature_log_block_cb cb, void *ctx)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif
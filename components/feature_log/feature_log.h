@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+#include "feature_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Append-only feature history in flash. Records are averaged over
+ * CONFIG_FEATURE_LOG_DECIMATION frames, compressed into FEATURE_BLOCK_SIZE
+ * blocks in RAM and written one whole block at a time to a ring of
+ * CONFIG_FEATURE_LOG_MAX_BLOCKS sectors of the raw "featlog" partition. A
+ * block costs exactly one sector erase and one 4 KB write, so each sector
+ * is erased once per lap of the ring. Encoding and flash
+ * writes happen in a low-priority task on core 0; the pipeline only posts
+ * records to a queue. The block still being filled is lost on power loss.
+ *
+ * Timestamps are esp_timer based, so every block records the boot it came
+ * from; boots are numbered from the log itself.
+ */
+
+// Find the "featlog" partition, rebuild the block index and start the writer
+esp_err_t feature_log_init(void);
+
+// Queue one frame's features. Never blocks; drops when the writer lags.
+void feature_log_append(const feature_record_t *rec);
+
+// Boot number of the records being written now
+uint32_t feature_log_boot(void);
+
+/*
+ * Visit, oldest first, every block of `boot` overlapping [from_us, to_us],
+ * including the block still in RAM. `block` holds a full header plus
+ * payload and is only valid during the call; return false to stop.
+ */
+typedef bool (*feature_log_block_cb)(const uint8_t *block, size_t len, void *ctx);
+esp_err_t feature_log_query(uint32_t boot, int64_t from_us, int64_t to_us,
+                            feature_log_block_cb cb, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,62 @@
+/**
+ * @file metrics.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements the lock-free counters shared by the capture, processing
+ *        and transport paths.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include "metrics.h"
+
+uint32_t g_metrics[METRIC_COUNT];
+metrics_client_t g_metrics_clients[METRICS_MAX_CLIENTS];
+
+static const struct {
+    const char *name;
+    const char *help;
+} s_desc[METRIC_COUNT] = {
+    [METRIC_I2S_FRAMES]           = { "i2s_frames_total",           "Frames read from I2S" },
+    [METRIC_I2S_SHORT_READS]      = { "i2s_short_reads_total",      "I2S reads returning fewer samples than requested" },
+    [METRIC_I2S_OVERRUNS]         = { "i2s_overruns_total",         "I2S DMA receive queue overflows" },
+    [METRIC_FRAMES_PROCESSED]     = { "frames_processed_total",     "Frames through feature extraction" },
+    [METRIC_FRAMES_ALLOC_FAILED]  = { "frames_alloc_failed_total",  "Frames dropped because the frame pool was exhausted" },
+    [METRIC_FRAMES_QUEUE_DROPPED] = { "frames_queue_dropped_total", "Frames dropped because the transport queue was full" },
+    [METRIC_SCENE_EVENTS_DROPPED] = { "scene_events_dropped_total", "Scene events dropped because the event queue was full" },
+    [METRIC_FRAMES_SENT]          = { "frames_sent_total",          "Frames serialized for at least one client" },
+    [METRIC_FRAMES_UNWANTED]      = { "frames_unwanted_total",      "Frames no client subscribed to" },
+    [METRIC_WS_SEND_ERRORS]       = { "ws_send_errors_total",       "WebSocket sends that failed or found the client gone" },
+    [METRIC_HTTP_REQUESTS]        = { "http_requests_total",        "HTTP connections accepted" },
+    [METRIC_SINK_FRAMES_DROPPED]  = { "sink_frames_dropped_total",  "Frames an extra sink missed because its queue was full" },
+    [METRIC_RTP_PACKETS_SENT]     = { "rtp_packets_sent_total",     "RTP packets handed to the UDP stack" },
+    [METRIC_RTP_SEND_ERRORS]      = { "rtp_send_errors_total",      "RTP packets the UDP stack refused" },
+    [METRIC_FEATURE_LOG_DROPPED]  = { "feature_log_dropped_total",  "Frames the feature log writer could not keep up with" },
+    [METRIC_FEATURE_LOG_BLOCKS]   = { "feature_log_blocks_total",   "Feature log blocks written to flash" },
+};
+
+void metrics_ws_client_reset(uint8_t client)
+{
+    if (client >= METRICS_MAX_CLIENTS) return;
+    __atomic_store_n(&g_metrics_clients[client].messages, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_metrics_clients[client].bytes, 0, __ATOMIC_RELAXED);
+}
+
+void metrics_ws_client_get(uint8_t client, metrics_client_t *out)
+{
+    if (client >= METRICS_MAX_CLIENTS) {
+        out->messages = out->bytes = 0;
+        return;
+    }
+    out->messages = __atomic_load_n(&g_metrics_clients[client].messages, __ATOMIC_RELAXED);
+    out->bytes    = __atomic_load_n(&g_metrics_clients[client].bytes, __ATOMIC_RELAXED);
+}
+
+const char *metrics_name(metric_id_t id)
+{
+    return (id < METRIC_COUNT) ? s_desc[id].name : "unknown";
+}
+
+const char *metrics_help(metric_id_t id)
+{
+    return (id < METRIC_COUNT) ? s_desc[id].help : "";
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Process-wide event counters. Every counter is a plain uint32_t updated
+ * with a relaxed atomic add, so instrumenting the real-time path costs a few
+ * cycles and never blocks. Readers see each counter consistently, but not
+ * a consistent snapshot across counters.
+ */
+typedef enum {
+    METRIC_I2S_FRAMES = 0,          // full frames read from I2S
+    METRIC_I2S_SHORT_READS,
+    METRIC_I2S_OVERRUNS,            // DMA receive queue overflowed
+    METRIC_FRAMES_PROCESSED,        // frames through feature extraction
+    METRIC_FRAMES_ALLOC_FAILED,
+    METRIC_FRAMES_QUEUE_DROPPED,    // audio_frame_queue full
+    METRIC_SCENE_EVENTS_DROPPED,
+    METRIC_FRAMES_SENT,             // frames serialized for at least one client
+    METRIC_FRAMES_UNWANTED,         // frames no client wanted
+    METRIC_WS_SEND_ERRORS,
+    METRIC_HTTP_REQUESTS,
+    METRIC_SINK_FRAMES_DROPPED,     // extra sink queue full
+    METRIC_RTP_PACKETS_SENT,
+    METRIC_RTP_SEND_ERRORS,
+    METRIC_FEATURE_LOG_DROPPED,     // feature log queue full
+    METRIC_FEATURE_LOG_BLOCKS,      // blocks written to flash
+    METRIC_COUNT
+} metric_id_t;
+
+#define METRICS_MAX_CLIENTS CONFIG_WEBSOCKET_SERVER_MAX_CLIENTS
+
+// Per-client WebSocket transmit counters
+typedef struct {
+    uint32_t messages;
+    uint32_t bytes;
+} metrics_client_t;
+
+extern uint32_t g_metrics[METRIC_COUNT];
+extern metrics_client_t g_metrics_clients[METRICS_MAX_CLIENTS];
+
+static inline void metrics_inc(metric_id_t id)
+{
+    __atomic_fetch_add(&g_metrics[id], 1, __ATOMIC_RELAXED);
+}
+
+static inline uint32_t metrics_get(metric_id_t id)
+{
+    return __atomic_load_n(&g_metrics[id], __ATOMIC_RELAXED);
+}
+
+static inline void metrics_ws_tx(uint8_t client, size_t bytes)
+{
+    if (client >= METRICS_MAX_CLIENTS) return;
+    __atomic_fetch_add(&g_metrics_clients[client].messages, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_metrics_clients[client].bytes, (uint32_t)bytes, __ATOMIC_RELAXED);
+}
+
+// Zero a client slot's counters when a new client takes it
+void metrics_ws_client_reset(uint8_t client);
+void metrics_ws_client_get(uint8_t client, metrics_client_t *out);
+
+// Prometheus-style name (without prefix) and help text
+const char *metrics_name(metric_id_t id);
+const char *metrics_help(metric_id_t id);
+
+#ifdef __cplusplus
+}
+#endif
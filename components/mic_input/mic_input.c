@@ -14,6 +14,9 @@
 #include "mic_input.h"
 #include "driver/i2s.h"
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "metrics.h"
 
 #define I2S_NUM I2S_NUM_0
 #define SAMPLE_RATE CONFIG_MIC_INPUT_SAMPLE_RATE
@@ -23,6 +26,10 @@
 
 #define DMA_BUF_LEN CONFIG_MIC_INPUT_BUFFER_SIZE
 #define DMA_BUF_COUNT CONFIG_MIC_INPUT_BUFFER_COUNT
+#define I2S_EVENT_QUEUE_LEN 8
+
+// Driver event queue, drained on every read to count DMA overruns
+static QueueHandle_t s_i2s_events;
 
 static const char *TAG = "mic_input";
 
@@ -50,7 +57,7 @@ void mic_input_init(void) {
         .data_out_num = I2S_PIN_NO_CHANGE
     };
 
-    ESP_ERROR_CHECK(i2s_driver_install(I2S_NUM, &i2s_config, 0, NULL));
+    ESP_ERROR_CHECK(i2s_driver_install(I2S_NUM, &i2s_config, I2S_EVENT_QUEUE_LEN, &s_i2s_events));
     ESP_ERROR_CHECK(i2s_set_pin(I2S_NUM, &pin_config));
     ESP_LOGI(TAG, "I2S mic initialized at %d Hz", SAMPLE_RATE);
 }
@@ -58,9 +65,20 @@ void mic_input_init(void) {
 size_t mic_input_read(int32_t *buffer, size_t samples) {
     size_t bytes_read = 0;
     esp_err_t err = i2s_read(I2S_NUM, buffer, samples * sizeof(int32_t), &bytes_read, portMAX_DELAY);
+
+    i2s_event_t evt;
+    while (s_i2s_events && xQueueReceive(s_i2s_events, &evt, 0) == pdTRUE) {
+        if (evt.type == I2S_EVENT_RX_Q_OVF) {
+            metrics_inc(METRIC_I2S_OVERRUNS);
+        }
+    }
+
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "i2s_read failed: %s", esp_err_to_name(err));
         return 0;
     }
-    return bytes_read / sizeof(int32_t); // Return number of samples
+
+    size_t n = bytes_read / sizeof(int32_t);
+    metrics_inc(n == samples ? METRIC_I2S_FRAMES : METRIC_I2S_SHORT_READS);
+    return n; // Return number of samples
 }
\ No newline at end of file
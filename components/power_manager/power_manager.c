@@ -0,0 +1,223 @@
+/**
+ * @file power_manager.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements dynamic frequency scaling, light sleep and WiFi modem sleep
+ *        driven by pipeline load and client demand, and measures the duty cycle
+ *        and processing latency of each power mode.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_wifi.h"
+#include "esp_timer.h"
+
+#include "power_manager.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "power_manager";
+
+static const char *s_mode_names[POWER_MODE_COUNT] = {
+    "streaming", "events-only", "idle"
+};
+
+typedef struct {
+    power_mode_stats_t pub;
+    uint64_t latency_sum_us;
+} mode_stats_t;
+
+static esp_pm_lock_handle_t s_cpu_lock;
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static volatile power_mode_t s_mode = POWER_MODE_IDLE;
+static power_mode_t s_requested = POWER_MODE_IDLE;  // last set_mode()
+static uint32_t s_streaming_holds;
+static int64_t s_mode_start_us;
+static int64_t s_busy_start_us;
+static uint32_t s_ramp_us;
+static mode_stats_t s_stats[POWER_MODE_COUNT];
+
+static void apply_wifi_power_save(power_mode_t mode)
+{
+#if CONFIG_POWER_WIFI_MODEM_SLEEP
+    static const wifi_ps_type_t ps[POWER_MODE_COUNT] = {
+        [POWER_MODE_STREAMING]   = WIFI_PS_NONE,
+        [POWER_MODE_EVENTS_ONLY] = WIFI_PS_MIN_MODEM,
+        [POWER_MODE_IDLE]        = WIFI_PS_MAX_MODEM,
+    };
+
+    esp_err_t err = esp_wifi_set_ps(ps[mode]);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "esp_wifi_set_ps failed: %s", esp_err_to_name(err));
+    }
+#endif
+}
+
+esp_err_t power_manager_init(void)
+{
+    s_mode_start_us = esp_timer_get_time();
+
+#if CONFIG_PM_ENABLE
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz       = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz       = CONFIG_POWER_MIN_CPU_FREQ_MHZ,
+#if CONFIG_POWER_LIGHT_SLEEP && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+        .light_sleep_enable = true
+#else
+        .light_sleep_enable = false
+#endif
+    };
+    esp_err_t err = esp_pm_configure(&pm_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_pm_configure failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "pipeline", &s_cpu_lock);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create CPU lock: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    ESP_LOGI(TAG, "DFS %d-%d MHz, light sleep %s",
+             pm_config.min_freq_mhz, pm_config.max_freq_mhz,
+             pm_config.light_sleep_enable ? "on" : "off");
+#else
+    ESP_LOGW(TAG, "CONFIG_PM_ENABLE is off, running at a fixed CPU frequency");
+#endif
+
+    apply_wifi_power_save(s_mode);
+
+#if CONFIG_PM_ENABLE
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+// Log what the outgoing mode cost, so modes can be compared on the bench
+static void log_mode_summary(power_mode_t mode, const power_mode_stats_t *st)
+{
+    if (st->time_us == 0 || st->frames == 0) return;
+
+    ESP_LOGI(TAG, "%s: %.1f s, duty %.1f%%, latency mean %u us max %u us, ramp max %u us",
+             s_mode_names[mode], st->time_us / 1e6,
+             100.0 * st->busy_us / st->time_us,
+             (unsigned)st->latency_mean_us, (unsigned)st->latency_max_us,
+             (unsigned)st->ramp_max_us);
+}
+
+// Called with s_mux held; holds override the requested mode
+static power_mode_t effective_mode(void)
+{
+    return s_streaming_holds ? POWER_MODE_STREAMING : s_requested;
+}
+
+static void update_mode(void)
+{
+    power_mode_stats_t prev;
+    power_mode_t old, mode;
+    bool changed;
+
+    portENTER_CRITICAL(&s_mux);
+    mode = effective_mode();
+    old = s_mode;
+    changed = (mode != old);
+    if (changed) {
+        int64_t now = esp_timer_get_time();
+        s_stats[old].pub.time_us += now - s_mode_start_us;
+        s_mode_start_us = now;
+        s_mode = mode;
+    }
+    prev = s_stats[old].pub;
+    portEXIT_CRITICAL(&s_mux);
+
+    if (changed) {
+        apply_wifi_power_save(mode);
+        log_mode_summary(old, &prev);
+        ESP_LOGI(TAG, "Power mode: %s", s_mode_names[mode]);
+    }
+}
+
+void power_manager_set_mode(power_mode_t mode)
+{
+    if (mode >= POWER_MODE_COUNT) return;
+
+    portENTER_CRITICAL(&s_mux);
+    s_requested = mode;
+    portEXIT_CRITICAL(&s_mux);
+    update_mode();
+}
+
+void power_manager_hold_streaming(bool hold)
+{
+    portENTER_CRITICAL(&s_mux);
+    if (hold) {
+        s_streaming_holds++;
+    } else if (s_streaming_holds) {
+        s_streaming_holds--;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    update_mode();
+}
+
+power_mode_t power_manager_get_mode(void)
+{
+    return s_mode;
+}
+
+const char *power_mode_name(power_mode_t mode)
+{
+    return (mode < POWER_MODE_COUNT) ? s_mode_names[mode] : "unknown";
+}
+
+void power_manager_pipeline_begin(void)
+{
+    int64_t t0 = esp_timer_get_time();
+    if (s_cpu_lock) {
+        esp_pm_lock_acquire(s_cpu_lock);
+    }
+    s_busy_start_us = esp_timer_get_time();
+    s_ramp_us = (uint32_t)(s_busy_start_us - t0);
+}
+
+void power_manager_pipeline_end(int64_t capture_us)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t busy = (uint32_t)(now - s_busy_start_us);
+    uint32_t latency = (uint32_t)(now - capture_us);
+
+    portENTER_CRITICAL(&s_mux);
+    mode_stats_t *st = &s_stats[s_mode];
+    st->pub.busy_us += busy;
+    st->pub.frames++;
+    st->latency_sum_us += latency;
+    st->pub.latency_mean_us = (uint32_t)(st->latency_sum_us / st->pub.frames);
+    if (latency > st->pub.latency_max_us) st->pub.latency_max_us = latency;
+    if (s_ramp_us > st->pub.ramp_max_us) st->pub.ramp_max_us = s_ramp_us;
+    portEXIT_CRITICAL(&s_mux);
+
+    if (s_cpu_lock) {
+        esp_pm_lock_release(s_cpu_lock);
+    }
+}
+
+void power_manager_get_stats(power_mode_t mode, power_mode_stats_t *out)
+{
+    if (mode >= POWER_MODE_COUNT) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+
+    portENTER_CRITICAL(&s_mux);
+    *out = s_stats[mode].pub;
+    if (mode == s_mode) {
+        out->time_us += esp_timer_get_time() - s_mode_start_us;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Power modes, chosen from what connected clients subscribe to:
+ *   STREAMING    - some client wants per-frame data: WiFi always awake
+ *   EVENTS_ONLY  - clients only want scene events: WiFi modem sleep (DTIM)
+ *   IDLE         - no clients: WiFi maximum modem sleep
+ * In every mode the CPU runs at the minimum frequency unless the pipeline
+ * holds its lock, and may enter light sleep when nothing else blocks it.
+ */
+typedef enum {
+    POWER_MODE_STREAMING = 0,
+    POWER_MODE_EVENTS_ONLY,
+    POWER_MODE_IDLE,
+    POWER_MODE_COUNT
+} power_mode_t;
+
+// Measurements accumulated while a mode was active
+typedef struct {
+    uint64_t time_us;           // wall time spent in the mode
+    uint64_t busy_us;           // time the pipeline held the CPU lock
+    uint32_t frames;
+    uint32_t latency_mean_us;   // capture -> end of processing
+    uint32_t latency_max_us;
+    uint32_t ramp_max_us;       // worst lock acquire (frequency switch) time
+} power_mode_stats_t;
+
+/*
+ * Configure dynamic frequency scaling and light sleep from Kconfig and
+ * create the pipeline CPU lock. Call once WiFi is up. Returns
+ * ESP_ERR_NOT_SUPPORTED when CONFIG_PM_ENABLE is off; the rest of the API
+ * then only does bookkeeping.
+ */
+esp_err_t power_manager_init(void);
+
+// Switch power mode; applies the matching WiFi power-save setting
+void power_manager_set_mode(power_mode_t mode);
+
+/*
+ * Keep the STREAMING mode regardless of set_mode() while at least one
+ * hold is taken, for consumers outside the WebSocket subscriptions (e.g.
+ * a TCP stream whose ACKs must not wait for a DTIM beacon). Calls nest.
+ */
+void power_manager_hold_streaming(bool hold);
+power_mode_t power_manager_get_mode(void);
+const char *power_mode_name(power_mode_t mode);
+
+/*
+ * Bracket one frame of pipeline work. begin() raises the CPU to maximum
+ * frequency, end() releases it. capture_us is the esp_timer time at which
+ * the frame's samples became available.
+ */
+void power_manager_pipeline_begin(void);
+void power_manager_pipeline_end(int64_t capture_us);
+
+// Copy the statistics of `mode` (including the running mode up to now)
+void power_manager_get_stats(power_mode_t mode, power_mode_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,255 @@
+/**
+ * @file rtp_sink.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements the RTP over UDP audio sink: packetizes pooled frames as
+ *        L16 or DVI4 and sends them without per-packet allocation.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include "lwip/sockets.h"
+
+#include "esp_log.h"
+#include "esp_random.h"
+
+#include "audio_frame.h"
+#include "sample_process.h"
+#include "ima_adpcm.h"
+#include "metrics.h"
+#include "power_manager.h"
+#include "rtp_sink.h"
+#include "sdkconfig.h"
+
+#if CONFIG_RTP_SINK_ENABLE
+
+#define RTP_VERSION         2
+#define RTP_HEADER_BYTES    12
+#define RTP_PT_L16          96      // dynamic: a=rtpmap:96 L16/<capture rate>/1
+#define RTP_PT_DVI4_16K     6       // static, RFC 3551 table 4
+#define RTP_TOS_EF          0xB8    // DSCP 46, lands in the WMM voice queue
+
+#define PACKET_SAMPLES      (AUDIO_FRAME_SAMPLE_RATE * CONFIG_RTP_PTIME_MS / 1000)
+
+#if CONFIG_RTP_PAYLOAD_DVI4
+#define PAYLOAD_TYPE        RTP_PT_DVI4_16K
+#define PAYLOAD_NAME        "DVI4"
+#define PAYLOAD_MAX_BYTES   (4 + PACKET_SAMPLES / 2)
+_Static_assert(AUDIO_FRAME_SAMPLE_RATE == 16000,
+               "DVI4 payload type 6 is defined for 16 kHz");
+_Static_assert((PACKET_SAMPLES % 2) == 0, "ADPCM packs two samples per byte");
+#else
+#define PAYLOAD_TYPE        RTP_PT_L16
+#define PAYLOAD_NAME        "L16"
+#define PAYLOAD_MAX_BYTES   (PACKET_SAMPLES * 2)
+#endif
+
+#if CONFIG_RTP_SOURCE_PROC
+#define SOURCE_STREAM       AUDIO_STREAM_PROC
+#else
+#define SOURCE_STREAM       AUDIO_STREAM_RAW
+#endif
+
+static const char *TAG = "rtp_sink";
+
+typedef struct {
+    int sock;
+    struct sockaddr_in dest;
+
+    uint32_t ssrc;
+    uint16_t seq;
+    uint32_t ts_base;           // random offset added to the sample index
+    bool synced;                // pending_index follows the frame stream
+    bool marker;                // next packet starts after a gap
+
+    // Samples collected for the next packet
+    int16_t pending[PACKET_SAMPLES];
+    size_t pending_count;
+    uint64_t pending_index;     // sample_index of pending[0]
+
+#if CONFIG_RTP_PAYLOAD_DVI4
+    ima_adpcm_state_t adpcm;
+#endif
+    uint8_t packet[RTP_HEADER_BYTES + PAYLOAD_MAX_BYTES];
+} rtp_state_t;
+
+static QueueHandle_t s_queue;
+static rtp_state_t s_rtp;
+
+static inline void put_be16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static inline void put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static void send_packet(rtp_state_t *r)
+{
+    uint8_t *h = r->packet;
+    h[0] = RTP_VERSION << 6;
+    h[1] = (r->marker ? 0x80 : 0x00) | PAYLOAD_TYPE;
+    put_be16(h + 2, r->seq);
+    put_be32(h + 4, r->ts_base + (uint32_t)r->pending_index);
+    put_be32(h + 8, r->ssrc);
+
+    uint8_t *p = h + RTP_HEADER_BYTES;
+    size_t len;
+#if CONFIG_RTP_PAYLOAD_DVI4
+    // RFC 3551 4.5.1: encoder state at the start of the packet, then the
+    // first sample of each byte in the high nibble
+    put_be16(p, (uint16_t)r->adpcm.predictor);
+    p[2] = (uint8_t)r->adpcm.index;
+    p[3] = 0;
+    len = 4 + ima_adpcm_encode(&r->adpcm, r->pending, PACKET_SAMPLES, p + 4);
+    for (size_t i = 4; i < len; i++) {
+        p[i] = (uint8_t)((p[i] << 4) | (p[i] >> 4));
+    }
+#else
+    // L16 is network byte order
+    for (size_t i = 0; i < PACKET_SAMPLES; i++) {
+        put_be16(p + 2 * i, (uint16_t)r->pending[i]);
+    }
+    len = PACKET_SAMPLES * 2;
+#endif
+
+    if (sendto(r->sock, r->packet, RTP_HEADER_BYTES + len, 0,
+               (struct sockaddr *)&r->dest, sizeof(r->dest)) < 0) {
+        // Out of lwIP buffers or no route; the sequence number is still used
+        // so receivers count the packet as lost
+        metrics_inc(METRIC_RTP_SEND_ERRORS);
+    } else {
+        metrics_inc(METRIC_RTP_PACKETS_SENT);
+    }
+
+    r->seq++;
+    r->marker = false;
+    r->pending_count = 0;
+    r->pending_index += PACKET_SAMPLES;
+}
+
+static void packetize(rtp_state_t *r, const audio_frame_t *frame)
+{
+    const int16_t *src = (SOURCE_STREAM == AUDIO_STREAM_PROC) ?
+                         frame->samples_out : frame->samples_in;
+    if (!src) return;
+
+    const uint64_t expected = r->pending_index + r->pending_count;
+    if (!r->synced || frame->sample_index != expected) {
+        // Frames were lost upstream: drop the partial packet and skip the
+        // sequence numbers of the packets that never existed
+        if (r->synced && frame->sample_index > r->pending_index) {
+            r->seq += (uint16_t)((frame->sample_index - r->pending_index) / PACKET_SAMPLES);
+        }
+        r->pending_index = frame->sample_index;
+        r->pending_count = 0;
+        r->synced = true;
+        r->marker = true;
+    }
+
+    size_t off = 0;
+    while (off < frame->sample_count) {
+        size_t n = PACKET_SAMPLES - r->pending_count;
+        if (n > frame->sample_count - off) {
+            n = frame->sample_count - off;
+        }
+        memcpy(&r->pending[r->pending_count], &src[off], n * sizeof(int16_t));
+        r->pending_count += n;
+        off += n;
+
+        if (r->pending_count == PACKET_SAMPLES) {
+            send_packet(r);
+        }
+    }
+}
+
+static void rtp_sink_task(void *arg)
+{
+    while (1) {
+        audio_frame_t *frame = NULL;
+        if (xQueueReceive(s_queue, &frame, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (frame && frame->magic == AUDIO_FRAME_MAGIC) {
+            packetize(&s_rtp, frame);
+        }
+        audio_frame_release(frame);
+    }
+}
+
+esp_err_t rtp_sink_start(void)
+{
+    rtp_state_t *r = &s_rtp;
+
+    r->dest.sin_family = AF_INET;
+    r->dest.sin_port   = htons(CONFIG_RTP_DEST_PORT);
+    if (inet_pton(AF_INET, CONFIG_RTP_DEST_IP, &r->dest.sin_addr) != 1) {
+        ESP_LOGE(TAG, "Invalid destination address '%s'", CONFIG_RTP_DEST_IP);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    r->sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (r->sock < 0) {
+        ESP_LOGE(TAG, "Socket creation failed: errno %d", errno);
+        return ESP_FAIL;
+    }
+
+    int tos = RTP_TOS_EF;
+    setsockopt(r->sock, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+
+    // RFC 3550 5.1: random SSRC, initial sequence number and timestamp
+    r->ssrc    = esp_random();
+    r->seq     = (uint16_t)esp_random();
+    r->ts_base = esp_random();
+
+    s_queue = xQueueCreate(CONFIG_RTP_QUEUE_LEN, sizeof(audio_frame_t *));
+    if (!s_queue) {
+        close(r->sock);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Live audio: after a stall the receiver wants the newest frames
+    esp_err_t err = sample_process_add_sink(s_queue, "rtp", SOURCE_STREAM,
+                                            SAMPLE_PROCESS_DROP_OLDEST);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "No free frame sink slot");
+        close(r->sock);
+        vQueueDelete(s_queue);
+        return err;
+    }
+
+    xTaskCreatePinnedToCore(rtp_sink_task, "rtp_sink", 3072, NULL, 5, NULL,
+                            SAMPLE_PROCESS_SINK_CORE(CONFIG_RTP_TASK_CORE));
+
+    // The sink streams for the device's lifetime; without the hold, modem
+    // sleep batches its packets at DTIM intervals when no client is streaming
+    power_manager_hold_streaming(true);
+
+    ESP_LOGI(TAG, "RTP %s (pt %d) to %s:%d, %d ms packets, ssrc %08x",
+             PAYLOAD_NAME, PAYLOAD_TYPE,
+             CONFIG_RTP_DEST_IP, CONFIG_RTP_DEST_PORT, CONFIG_RTP_PTIME_MS,
+             (unsigned)r->ssrc);
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t rtp_sink_start(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif
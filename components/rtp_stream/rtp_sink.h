@@ -0,0 +1,27 @@
+#pragma once
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * RTP over UDP audio sink (RFC 3550 / RFC 3551). Sends the raw or processed
+ * samples of every frame to CONFIG_RTP_DEST_IP:CONFIG_RTP_DEST_PORT, in
+ * packets of CONFIG_RTP_PTIME_MS, as
+ *   L16  (payload type 96, 16-bit big-endian PCM, mono), or
+ *   DVI4 (payload type 6 at 16 kHz, IMA ADPCM with a per-packet state header).
+ * The RTP timestamp counts samples from the capture clock, so gaps left by
+ * dropped frames show up as skipped sequence numbers.
+ *
+ * Frames are shared with the WebSocket path through the frame pool; the sink
+ * only reads them. Call once after WiFi is up and before the processing
+ * task starts. Returns ESP_ERR_NOT_SUPPORTED when CONFIG_RTP_SINK_ENABLE
+ * is off.
+ */
+esp_err_t rtp_sink_start(void);
+
+#ifdef __cplusplus
+}
+#endif
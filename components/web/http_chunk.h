@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdio.h>
+#include "lwip/api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * One HTTP/1.1 chunk in a single write: size line, data, CRLF. Returns
+ * ERR_TIMEOUT if the send timeout hit mid-chunk; the response cannot be
+ * resumed after that.
+ */
+static inline err_t http_write_chunk(struct netconn *conn, const void *data, size_t len)
+{
+    char size_line[12];
+    int n = snprintf(size_line, sizeof(size_line), "%x\r\n", (unsigned)len);
+
+    struct netvector vec[3] = {
+        { .ptr = size_line, .len = (size_t)n },
+        { .ptr = data,      .len = len },
+        { .ptr = "\r\n",    .len = 2 },
+    };
+    size_t total = n + len + 2;
+    size_t written = 0;
+
+    err_t err = netconn_write_vectors_partly(conn, vec, 3, NETCONN_COPY, &written);
+    if (err == ERR_OK && written != total) {
+        err = ERR_TIMEOUT;
+    }
+    return err;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,372 @@
+/**
+ * @file metrics_export.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements the Prometheus text and MET0 binary encodings of the
+ *        device metrics: counters, tasks, heap, clients, cascade and power.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+#include "metrics.h"
+#include "metrics_export.h"
+#include "audio_frame.h"
+#include "sample_process.h"
+#include "power_manager.h"
+#include "websocket_server.h"
+#include "sdkconfig.h"
+
+#define METRIC_PREFIX   "das_"
+#define MAX_TASKS       32
+
+typedef struct {
+    char name[16];
+    uint32_t runtime;
+    uint16_t cpu_permille;
+    uint16_t stack_free_bytes;
+} task_sample_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t uptime_ms;
+    uint32_t heap_free;
+    uint32_t heap_min_free;
+    uint32_t heap_largest_block;
+    uint8_t counter_count;
+    uint8_t task_count;
+    uint8_t client_count;
+    uint8_t power_mode;
+} metrics_bin_header_t;
+
+typedef struct __attribute__((packed)) {
+    char name[16];
+    uint16_t cpu_permille;
+    uint16_t stack_free_bytes;
+} metrics_bin_task_t;
+
+// Fills up to `max` tasks; returns the count (0 without run-time stats)
+static int sample_tasks(task_sample_t *out, int max)
+{
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    UBaseType_t n = uxTaskGetNumberOfTasks();
+    TaskStatus_t *st = malloc(n * sizeof(TaskStatus_t));
+    if (!st) return 0;
+
+    uint32_t total = 0;
+    n = uxTaskGetSystemState(st, n, &total);
+
+    // Run time is counted per core
+    uint64_t capacity = (uint64_t)total * portNUM_PROCESSORS;
+    int count = 0;
+
+    for (UBaseType_t i = 0; i < n && count < max; i++, count++) {
+        strlcpy(out[count].name, st[i].pcTaskName, sizeof(out[count].name));
+        out[count].runtime = st[i].ulRunTimeCounter;
+        out[count].cpu_permille = capacity
+            ? (uint16_t)((uint64_t)st[i].ulRunTimeCounter * 1000 / capacity)
+            : 0;
+        uint32_t stack = st[i].usStackHighWaterMark;
+        out[count].stack_free_bytes = stack > UINT16_MAX ? UINT16_MAX : (uint16_t)stack;
+    }
+
+    free(st);
+    return count;
+#else
+    (void)out;
+    (void)max;
+    return 0;
+#endif
+}
+
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t used;
+} text_out_t;
+
+static void appendf(text_out_t *o, const char *fmt, ...)
+{
+    if (o->used >= o->len) return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(o->buf + o->used, o->len - o->used, fmt, ap);
+    va_end(ap);
+
+    if (n > 0) {
+        o->used += (size_t)n;
+        if (o->used > o->len - 1) o->used = o->len - 1;
+    }
+}
+
+static void header(text_out_t *o, const char *name, const char *type, const char *help)
+{
+    appendf(o, "# HELP " METRIC_PREFIX "%s %s\n# TYPE " METRIC_PREFIX "%s %s\n",
+            name, help, name, type);
+}
+
+size_t metrics_format_prometheus(char *buf, size_t len)
+{
+    if (!buf || len == 0) return 0;
+    text_out_t o = { .buf = buf, .len = len, .used = 0 };
+    buf[0] = '\0';
+
+    header(&o, "uptime_seconds", "gauge", "Time since boot");
+    appendf(&o, METRIC_PREFIX "uptime_seconds %.3f\n", esp_timer_get_time() / 1e6);
+
+    // Event counters
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        header(&o, metrics_name(id), "counter", metrics_help(id));
+        appendf(&o, METRIC_PREFIX "%s %u\n", metrics_name(id), (unsigned)metrics_get(id));
+    }
+
+    // Heap
+    size_t free_b    = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    size_t largest_b = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    header(&o, "heap_free_bytes", "gauge", "Free 8-bit capable heap");
+    appendf(&o, METRIC_PREFIX "heap_free_bytes %u\n", (unsigned)free_b);
+    header(&o, "heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+    appendf(&o, METRIC_PREFIX "heap_min_free_bytes %u\n",
+            (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+    header(&o, "heap_largest_block_bytes", "gauge", "Largest allocatable block");
+    appendf(&o, METRIC_PREFIX "heap_largest_block_bytes %u\n", (unsigned)largest_b);
+    header(&o, "heap_fragmentation_ratio", "gauge", "1 - largest block / free heap");
+    appendf(&o, METRIC_PREFIX "heap_fragmentation_ratio %.3f\n",
+            free_b ? 1.0 - (double)largest_b / free_b : 0.0);
+    header(&o, "frame_pool_free", "gauge", "Audio frame pool slots not held by any consumer");
+    appendf(&o, METRIC_PREFIX "frame_pool_free %u\n", (unsigned)audio_frame_pool_available());
+
+    // Tasks
+    task_sample_t *tasks = calloc(MAX_TASKS, sizeof(task_sample_t));
+    int task_count = tasks ? sample_tasks(tasks, MAX_TASKS) : 0;
+    if (task_count) {
+        header(&o, "task_runtime_total", "counter", "Task run time in run-time-stats ticks");
+        for (int i = 0; i < task_count; i++) {
+            appendf(&o, METRIC_PREFIX "task_runtime_total{task=\"%s\"} %u\n",
+                    tasks[i].name, (unsigned)tasks[i].runtime);
+        }
+        header(&o, "task_cpu_share", "gauge", "Share of total CPU time since boot");
+        for (int i = 0; i < task_count; i++) {
+            appendf(&o, METRIC_PREFIX "task_cpu_share{task=\"%s\"} %.3f\n",
+                    tasks[i].name, tasks[i].cpu_permille / 1000.0);
+        }
+        header(&o, "task_stack_free_bytes", "gauge", "Stack high-water mark (minimum free)");
+        for (int i = 0; i < task_count; i++) {
+            appendf(&o, METRIC_PREFIX "task_stack_free_bytes{task=\"%s\"} %u\n",
+                    tasks[i].name, (unsigned)tasks[i].stack_free_bytes);
+        }
+    }
+    free(tasks);
+
+    // WebSocket clients (slots that have sent anything)
+    header(&o, "ws_client_messages_total", "counter", "WebSocket messages sent per client slot");
+    for (int i = 0; i < METRICS_MAX_CLIENTS; i++) {
+        metrics_client_t c;
+        metrics_ws_client_get(i, &c);
+        if (c.messages) {
+            appendf(&o, METRIC_PREFIX "ws_client_messages_total{client=\"%d\"} %u\n",
+                    i, (unsigned)c.messages);
+        }
+    }
+    header(&o, "ws_client_bytes_total", "counter", "WebSocket payload bytes sent per client slot");
+    for (int i = 0; i < METRICS_MAX_CLIENTS; i++) {
+        metrics_client_t c;
+        metrics_ws_client_get(i, &c);
+        if (c.messages) {
+            appendf(&o, METRIC_PREFIX "ws_client_bytes_total{client=\"%d\"} %u\n",
+                    i, (unsigned)c.bytes);
+        }
+    }
+
+    // Analysis cascade
+    sample_cascade_stats_t cs;
+    sample_process_get_cascade_stats(&cs);
+    header(&o, "cascade_frames_total", "counter", "Frames by the analysis stage that decided them");
+    appendf(&o, METRIC_PREFIX "cascade_frames_total{stage=\"rms\"} %u\n", (unsigned)cs.rms_decided);
+    appendf(&o, METRIC_PREFIX "cascade_frames_total{stage=\"zcr\"} %u\n", (unsigned)cs.zcr_decided);
+    appendf(&o, METRIC_PREFIX "cascade_frames_total{stage=\"fft\"} %u\n", (unsigned)cs.fft_decided);
+    header(&o, "cascade_spectrum_only_fft_total", "counter", "FFTs run only for the spectrum stream");
+    appendf(&o, METRIC_PREFIX "cascade_spectrum_only_fft_total %u\n", (unsigned)cs.fft_for_spectrum);
+
+    // Sound level meter
+    sound_level_stats_t sl;
+    if (sample_process_get_sound_level(&sl)) {
+        const char *w = sound_level_weighting_name(sl.weighting);
+        header(&o, "sound_level_db", "gauge", "Weighted sound pressure level (dB SPL)");
+        appendf(&o, METRIC_PREFIX "sound_level_db{weighting=\"%s\",time=\"fast\"} %.1f\n", w, sl.fast_db);
+        appendf(&o, METRIC_PREFIX "sound_level_db{weighting=\"%s\",time=\"slow\"} %.1f\n", w, sl.slow_db);
+        if (sl.intervals) {
+            header(&o, "sound_level_interval_db", "gauge", "Leq, Lmax and Lmin (fast) over the last interval");
+            appendf(&o, METRIC_PREFIX "sound_level_interval_db{weighting=\"%s\",stat=\"leq\"} %.1f\n", w, sl.leq_db);
+            appendf(&o, METRIC_PREFIX "sound_level_interval_db{weighting=\"%s\",stat=\"max\"} %.1f\n", w, sl.lmax_db);
+            appendf(&o, METRIC_PREFIX "sound_level_interval_db{weighting=\"%s\",stat=\"min\"} %.1f\n", w, sl.lmin_db);
+        }
+    }
+
+    // Frame deadlines
+    deadline_stats_t ds;
+    sample_process_get_deadline_stats(&ds);
+    header(&o, "frame_budget_us", "gauge", "Frame period the pipeline must keep up with");
+    appendf(&o, METRIC_PREFIX "frame_budget_us %u\n", (unsigned)ds.period_us);
+    header(&o, "frame_exec_us", "histogram", "Capture-to-handoff time per frame");
+    uint32_t cumulative = 0;
+    for (int b = 0; b < DEADLINE_EXEC_BINS - 1; b++) {
+        cumulative += ds.exec_hist[b];
+        appendf(&o, METRIC_PREFIX "frame_exec_us_bucket{le=\"%u\"} %u\n",
+                (unsigned)(ds.period_us * (b + 1) / 10), (unsigned)cumulative);
+    }
+    appendf(&o, METRIC_PREFIX "frame_exec_us_bucket{le=\"+Inf\"} %u\n", (unsigned)ds.frames);
+    appendf(&o, METRIC_PREFIX "frame_exec_us_sum %llu\n", (unsigned long long)ds.exec_sum_us);
+    appendf(&o, METRIC_PREFIX "frame_exec_us_count %u\n", (unsigned)ds.frames);
+    header(&o, "frame_exec_wcet_us", "gauge", "Worst-case frame execution time");
+    appendf(&o, METRIC_PREFIX "frame_exec_wcet_us %u\n", (unsigned)ds.wcet_us);
+    header(&o, "frame_arrival_jitter_us", "histogram", "|capture interval - frame period|");
+    cumulative = 0;
+    for (int b = 0; b < DEADLINE_JITTER_BINS - 1; b++) {
+        cumulative += ds.jitter_hist[b];
+        appendf(&o, METRIC_PREFIX "frame_arrival_jitter_us_bucket{le=\"%u\"} %u\n",
+                64u << b, (unsigned)cumulative);
+    }
+    cumulative += ds.jitter_hist[DEADLINE_JITTER_BINS - 1];
+    appendf(&o, METRIC_PREFIX "frame_arrival_jitter_us_bucket{le=\"+Inf\"} %u\n", (unsigned)cumulative);
+    appendf(&o, METRIC_PREFIX "frame_arrival_jitter_us_count %u\n", (unsigned)cumulative);
+    header(&o, "deadline_misses_total", "counter", "Frames whose processing exceeded the frame period");
+    appendf(&o, METRIC_PREFIX "deadline_misses_total %u\n", (unsigned)ds.misses);
+    header(&o, "late_arrivals_total", "counter", "Frames captured more than 1.5 periods after the previous one");
+    appendf(&o, METRIC_PREFIX "late_arrivals_total %u\n", (unsigned)ds.late_arrivals);
+    header(&o, "deadline_degraded", "gauge", "1 while spectrum extraction is shed for headroom");
+    appendf(&o, METRIC_PREFIX "deadline_degraded %d\n", ds.degraded ? 1 : 0);
+    header(&o, "deadline_degrade_entries_total", "counter", "Times degrade mode was entered");
+    appendf(&o, METRIC_PREFIX "deadline_degrade_entries_total %u\n", (unsigned)ds.degrade_entries);
+
+    // Frame sinks
+    sample_process_sink_stats_t sinks[1 + SAMPLE_PROCESS_MAX_SINKS];
+    size_t sink_count = sample_process_get_sink_stats(sinks, 1 + SAMPLE_PROCESS_MAX_SINKS);
+    if (sink_count) {
+        header(&o, "sink_frames_total", "counter", "Frames per sink: queued, dropped when full, evicted by newer");
+        for (size_t k = 0; k < sink_count; k++) {
+            appendf(&o, METRIC_PREFIX "sink_frames_total{sink=\"%s\",result=\"posted\"} %u\n",
+                    sinks[k].name, (unsigned)sinks[k].posted);
+            appendf(&o, METRIC_PREFIX "sink_frames_total{sink=\"%s\",result=\"dropped\"} %u\n",
+                    sinks[k].name, (unsigned)sinks[k].dropped);
+            appendf(&o, METRIC_PREFIX "sink_frames_total{sink=\"%s\",result=\"evicted\"} %u\n",
+                    sinks[k].name, (unsigned)sinks[k].evicted);
+        }
+        header(&o, "sink_queue_max", "gauge", "Queue high-water mark per sink");
+        for (size_t k = 0; k < sink_count; k++) {
+            appendf(&o, METRIC_PREFIX "sink_queue_max{sink=\"%s\",depth=\"%u\"} %u\n",
+                    sinks[k].name, (unsigned)sinks[k].depth, (unsigned)sinks[k].max_waiting);
+        }
+    }
+
+    // Pipeline stages; cycles at the locked processing frequency
+    pipeline_stage_stats_t stages[PIPELINE_MAX_STAGES];
+    size_t stage_count = sample_process_get_stage_stats(stages, PIPELINE_MAX_STAGES);
+    if (stage_count > PIPELINE_MAX_STAGES) stage_count = PIPELINE_MAX_STAGES;
+    if (stage_count) {
+        const double mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+        header(&o, "stage_exec_us", "summary", "Processing time per pipeline stage");
+        for (size_t k = 0; k < stage_count; k++) {
+            appendf(&o, METRIC_PREFIX "stage_exec_us_sum{stage=\"%s\"} %.0f\n",
+                    stages[k].name, stages[k].total_cycles / mhz);
+            appendf(&o, METRIC_PREFIX "stage_exec_us_count{stage=\"%s\"} %u\n",
+                    stages[k].name, (unsigned)stages[k].calls);
+        }
+        header(&o, "stage_exec_max_us", "gauge", "Worst-case processing time per pipeline stage");
+        for (size_t k = 0; k < stage_count; k++) {
+            appendf(&o, METRIC_PREFIX "stage_exec_max_us{stage=\"%s\"} %.0f\n",
+                    stages[k].name, stages[k].max_cycles / mhz);
+        }
+    }
+
+    // Power modes
+    power_mode_t current = power_manager_get_mode();
+    header(&o, "power_mode", "gauge", "1 for the active power mode");
+    for (int m = 0; m < POWER_MODE_COUNT; m++) {
+        appendf(&o, METRIC_PREFIX "power_mode{mode=\"%s\"} %d\n",
+                power_mode_name(m), m == (int)current);
+    }
+    header(&o, "power_duty_ratio", "gauge", "Pipeline busy time / wall time per mode");
+    for (int m = 0; m < POWER_MODE_COUNT; m++) {
+        power_mode_stats_t ps;
+        power_manager_get_stats(m, &ps);
+        appendf(&o, METRIC_PREFIX "power_duty_ratio{mode=\"%s\"} %.4f\n", power_mode_name(m),
+                ps.time_us ? (double)ps.busy_us / ps.time_us : 0.0);
+    }
+    header(&o, "power_latency_max_us", "gauge", "Worst capture-to-processed latency per mode");
+    for (int m = 0; m < POWER_MODE_COUNT; m++) {
+        power_mode_stats_t ps;
+        power_manager_get_stats(m, &ps);
+        appendf(&o, METRIC_PREFIX "power_latency_max_us{mode=\"%s\"} %u\n",
+                power_mode_name(m), (unsigned)ps.latency_max_us);
+    }
+
+    return o.used;
+}
+
+size_t metrics_format_binary(uint8_t *buf, size_t len)
+{
+    task_sample_t *tasks = calloc(MAX_TASKS, sizeof(task_sample_t));
+    int task_count = tasks ? sample_tasks(tasks, MAX_TASKS) : 0;
+
+    size_t need = sizeof(metrics_bin_header_t) +
+                  METRIC_COUNT * sizeof(uint32_t) +
+                  task_count * sizeof(metrics_bin_task_t) +
+                  METRICS_MAX_CLIENTS * sizeof(metrics_client_t);
+    if (!buf || len < need) {
+        free(tasks);
+        return 0;
+    }
+
+    metrics_bin_header_t hdr = {
+        .magic              = METRICS_BINARY_MAGIC,
+        .uptime_ms          = (uint32_t)(esp_timer_get_time() / 1000),
+        .heap_free          = heap_caps_get_free_size(MALLOC_CAP_8BIT),
+        .heap_min_free      = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+        .heap_largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+        .counter_count      = METRIC_COUNT,
+        .task_count         = (uint8_t)task_count,
+        .client_count       = METRICS_MAX_CLIENTS,
+        .power_mode         = (uint8_t)power_manager_get_mode()
+    };
+
+    uint8_t *p = buf;
+    memcpy(p, &hdr, sizeof(hdr));
+    p += sizeof(hdr);
+
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        uint32_t v = metrics_get(id);
+        memcpy(p, &v, sizeof(v));
+        p += sizeof(v);
+    }
+
+    for (int i = 0; i < task_count; i++) {
+        metrics_bin_task_t t = {
+            .cpu_permille     = tasks[i].cpu_permille,
+            .stack_free_bytes = tasks[i].stack_free_bytes
+        };
+        memcpy(t.name, tasks[i].name, sizeof(t.name));
+        memcpy(p, &t, sizeof(t));
+        p += sizeof(t);
+    }
+    free(tasks);
+
+    for (int i = 0; i < METRICS_MAX_CLIENTS; i++) {
+        metrics_client_t c;
+        metrics_ws_client_get(i, &c);
+        memcpy(p, &c, sizeof(c));
+        p += sizeof(c);
+    }
+
+    return (size_t)(p - buf);
+}
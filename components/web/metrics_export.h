@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Snapshot of device metrics in two encodings:
+ *
+ *  - Prometheus text exposition format, served at GET /metrics
+ *  - MET0 binary message, sent in reply to the WebSocket text command
+ *    "metrics" (all fields little-endian):
+ *
+ *    [Header]
+ *     uint32_t magic              // "MET0"
+ *     uint32_t uptime_ms
+ *     uint32_t heap_free
+ *     uint32_t heap_min_free
+ *     uint32_t heap_largest_block
+ *     uint8_t  counter_count      // METRIC_COUNT, in metric_id_t order
+ *     uint8_t  task_count
+ *     uint8_t  client_count
+ *     uint8_t  power_mode         // power_mode_t
+ *    [Payload]
+ *     uint32_t counters[counter_count]
+ *     { char name[16]; uint16_t cpu_permille; uint16_t stack_free_bytes; } tasks[task_count]
+ *     { uint32_t messages; uint32_t bytes; } clients[client_count]
+ *
+ * Task CPU shares are cumulative since boot and need
+ * CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS; without it task_count is 0.
+ */
+
+#define METRICS_BINARY_MAGIC 0x4D455430  /* "MET0" */
+
+// Both return the number of bytes written (output is truncated to len)
+size_t metrics_format_prometheus(char *buf, size_t len);
+size_t metrics_format_binary(uint8_t *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
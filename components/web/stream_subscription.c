@@ -0,0 +1,182 @@
+/**
+ * @file stream_subscription.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements per-client stream subscriptions and keeps the pipeline's
+ *        stream mask equal to the union of what connected clients want.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+
+#include "audio_frame.h"
+#include "sample_process.h"
+#include "power_manager.h"
+#include "stream_subscription.h"
+#include "websocket_server.h"
+
+static const char *TAG = "stream_sub";
+
+#define DIVISOR_MAX     1000
+
+// Streams produced for a legacy client (AUD0 + SPC0)
+#define LEGACY_STREAMS  (AUDIO_STREAM_RAW | AUDIO_STREAM_PROC | \
+                         AUDIO_STREAM_FEATURES | AUDIO_STREAM_SPECTRUM)
+
+/*
+ * One word per client: low 16 bits stream mask (+ STREAM_SUB_LEGACY),
+ * high 16 bits divisor. 0 means not connected. Written from the WebSocket
+ * server task, read by the transport task; aligned 32-bit accesses are
+ * atomic, so no lock is needed.
+ */
+static volatile uint32_t s_subs[WEBSOCKET_SERVER_MAX_CLIENTS];
+
+static const struct {
+    const char *name;
+    uint32_t bits;
+} s_stream_names[] = {
+    { "raw",      AUDIO_STREAM_RAW },
+    { "proc",     AUDIO_STREAM_PROC },
+    { "features", AUDIO_STREAM_FEATURES },
+    { "spectrum", AUDIO_STREAM_SPECTRUM },
+    { "envelope", AUDIO_STREAM_ENVELOPE },
+    { "events",   AUDIO_STREAM_EVENTS },
+    { "all",      AUDIO_STREAM_ALL },
+    { "none",     0 },
+};
+
+static inline uint32_t pack(uint32_t mask, uint16_t divisor)
+{
+    return ((uint32_t)divisor << 16) | (mask & 0xFFFF);
+}
+
+static uint32_t effective_streams(uint32_t word)
+{
+    uint32_t mask = word & 0xFFFF & ~STREAM_SUB_V2;
+    if (mask & STREAM_SUB_LEGACY) {
+        mask = (mask & ~STREAM_SUB_LEGACY) | LEGACY_STREAMS;
+    }
+    return mask;
+}
+
+// Recompute what the pipeline must produce for the current client set
+static void publish_union(void)
+{
+    uint32_t all = 0;
+    for (int i = 0; i < WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+        all |= effective_streams(s_subs[i]);
+    }
+    sample_process_set_streams(all);
+
+    // Keep the radio awake only while someone needs per-frame data
+    if (all & ~AUDIO_STREAM_EVENTS) {
+        power_manager_set_mode(POWER_MODE_STREAMING);
+    } else if (all) {
+        power_manager_set_mode(POWER_MODE_EVENTS_ONLY);
+    } else {
+        power_manager_set_mode(POWER_MODE_IDLE);
+    }
+}
+
+void stream_sub_client_connected(uint8_t num)
+{
+    if (num >= WEBSOCKET_SERVER_MAX_CLIENTS) return;
+    s_subs[num] = pack(STREAM_SUB_LEGACY, 1);
+    publish_union();
+}
+
+void stream_sub_client_disconnected(uint8_t num)
+{
+    if (num >= WEBSOCKET_SERVER_MAX_CLIENTS) return;
+    s_subs[num] = 0;
+    publish_union();
+}
+
+uint32_t stream_sub_get(uint8_t num, uint16_t *divisor)
+{
+    uint32_t word = (num < WEBSOCKET_SERVER_MAX_CLIENTS) ? s_subs[num] : 0;
+    if (divisor) {
+        *divisor = (uint16_t)(word >> 16);
+    }
+    return word & 0xFFFF;
+}
+
+static int parse_streams(char *list, uint32_t *mask_out)
+{
+    uint32_t mask = 0;
+    char *save = NULL;
+
+    for (char *tok = strtok_r(list, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        size_t i;
+        for (i = 0; i < sizeof(s_stream_names) / sizeof(s_stream_names[0]); i++) {
+            if (!strcmp(tok, s_stream_names[i].name)) {
+                mask |= s_stream_names[i].bits;
+                break;
+            }
+        }
+        if (i == sizeof(s_stream_names) / sizeof(s_stream_names[0])) {
+            return -1;
+        }
+    }
+
+    *mask_out = mask;
+    return 0;
+}
+
+int stream_sub_handle_command(uint8_t num, const char *msg, char *reply, size_t reply_len)
+{
+    char cmd[96];
+    char *save = NULL;
+
+    if (num >= WEBSOCKET_SERVER_MAX_CLIENTS || !msg) {
+        return -1;
+    }
+
+    strlcpy(cmd, msg, sizeof(cmd));
+    const char *verb = strtok_r(cmd, " \t\r\n", &save);
+    char *streams = strtok_r(NULL, " \t\r\n", &save);
+
+    if (!verb || strcmp(verb, "subscribe") || !streams) {
+        snprintf(reply, reply_len, "error usage: subscribe <streams> [divisor] [v1|v2]");
+        return -1;
+    }
+
+    uint32_t mask;
+    if (parse_streams(streams, &mask) != 0) {
+        snprintf(reply, reply_len, "error unknown stream");
+        return -1;
+    }
+
+    long divisor = 1;
+    int version = 1;
+    for (const char *opt = strtok_r(NULL, " \t\r\n", &save); opt;
+         opt = strtok_r(NULL, " \t\r\n", &save)) {
+        if (!strcmp(opt, "v1") || !strcmp(opt, "v2")) {
+            version = opt[1] - '0';
+            continue;
+        }
+        char *end = NULL;
+        divisor = strtol(opt, &end, 10);
+        if (*end != '\0' || divisor < 1 || divisor > DIVISOR_MAX) {
+            snprintf(reply, reply_len, "error divisor must be 1..%d", DIVISOR_MAX);
+            return -1;
+        }
+    }
+
+    if (version == 2) {
+        mask |= STREAM_SUB_V2;
+    }
+
+    s_subs[num] = pack(mask, (uint16_t)divisor);
+    publish_union();
+
+    mask &= ~STREAM_SUB_V2;
+    ESP_LOGI(TAG, "client %u: streams=0x%02" PRIx32 " divisor=%ld v%d", num, mask, divisor, version);
+    snprintf(reply, reply_len, "ok streams=0x%02" PRIx32 " divisor=%ld v%d", mask, divisor, version);
+    return 0;
+}
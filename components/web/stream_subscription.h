@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Per-client stream subscriptions, negotiated over the WebSocket text channel.
+ *
+ * Control messages (one command per text message):
+ *   subscribe <stream>[,<stream>...] [divisor] [v1|v2]
+ *       streams: raw, proc, features, spectrum, envelope, events, all, none
+ *       divisor: send every Nth frame (1..1000, default 1); scene events
+ *                are never divided
+ *       v1/v2:   wire format (default v1); v2 frames carry the aligned
+ *                DAS2 header described in web_client.c
+ *
+ * Clients that never send a command stay in legacy mode and receive the
+ * combined AUD0 frame plus SPC0, as before subscriptions existed.
+ */
+
+// Set when a client has not negotiated yet (legacy AUD0 stream)
+#define STREAM_SUB_LEGACY   (1u << 15)
+// Set when a client asked for the v2 wire format
+#define STREAM_SUB_V2       (1u << 14)
+
+void stream_sub_client_connected(uint8_t num);
+void stream_sub_client_disconnected(uint8_t num);
+
+/*
+ * Parse one control message from client `num`. Writes a short text reply
+ * into `reply` and returns 0 on success, -1 if the command was rejected.
+ */
+int stream_sub_handle_command(uint8_t num, const char *msg, char *reply, size_t reply_len);
+
+/*
+ * Returns the AUDIO_STREAM_* mask of client `num` (0 if not connected) and
+ * its rate divisor. Lock-free; safe to call from the transport task.
+ */
+uint32_t stream_sub_get(uint8_t num, uint16_t *divisor);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,192 @@
+/**
+ * @file summary_export.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements the JSON and SUM0 binary encodings of the long-term
+ *        feature aggregates kept by the sample processing task.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "esp_timer.h"
+
+#include "feature_stats.h"
+#include "sample_process.h"
+#include "summary_export.h"
+
+static const char *const WINDOW_NAMES[FEATURE_STATS_WINDOWS] = { "1s", "1min", "1h" };
+static const char *const SCENE_NAMES[FEATURE_STATS_SCENES] = { "quiet", "speech", "noise" };
+static const float PERCENTILES[] = { 0.10f, 0.50f, 0.90f, 0.99f };
+
+#define PERCENTILE_COUNT (sizeof(PERCENTILES) / sizeof(PERCENTILES[0]))
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t uptime_ms;
+    uint32_t frame_us;
+    uint8_t window_count;
+    uint8_t scene_count;
+    uint8_t reserved[2];
+} summary_bin_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t complete;
+    uint8_t reserved[3];
+    uint32_t start_ms;
+    uint32_t duration_ms;
+    uint32_t frames;
+    float rms_mean;
+    float rms_std;
+    float rms_min;
+    float rms_max;
+    uint32_t centroid_frames;
+    float centroid_mean_hz;
+    float centroid_std_hz;
+    float level_dbfs[PERCENTILE_COUNT];
+    uint32_t scene_ms[FEATURE_STATS_SCENES];
+    uint32_t scene_changes;
+} summary_bin_window_t;
+
+// The aggregates are ~2 KB; keep them off the caller's stack
+static feature_stats_t *snapshot(void)
+{
+    feature_stats_t *st = malloc(sizeof(*st));
+    if (st) sample_process_get_feature_stats(st);
+    return st;
+}
+
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t used;
+} text_out_t;
+
+static void appendf(text_out_t *o, const char *fmt, ...)
+{
+    if (o->used >= o->len) return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(o->buf + o->used, o->len - o->used, fmt, ap);
+    va_end(ap);
+
+    if (n > 0) {
+        o->used += (size_t)n;
+        if (o->used > o->len - 1) o->used = o->len - 1;
+    }
+}
+
+size_t summary_format_json(char *buf, size_t len)
+{
+    if (!buf || len == 0) return 0;
+    feature_stats_t *st = snapshot();
+    if (!st) return 0;
+
+    text_out_t o = { .buf = buf, .len = len, .used = 0 };
+    buf[0] = '\0';
+
+    appendf(&o, "{\"uptime_s\":%.3f,\"frame_ms\":%.3f,\"windows\":{",
+            esp_timer_get_time() / 1e6, st->frame_us / 1e3);
+
+    for (int w = 0; w < FEATURE_STATS_WINDOWS; w++) {
+        bool complete;
+        const feature_window_t *win = feature_stats_latest(st, w, &complete);
+
+        appendf(&o, "%s\"%s\":{\"complete\":%s,\"start_s\":%.3f,\"duration_s\":%.3f,\"frames\":%u,",
+                w ? "," : "", WINDOW_NAMES[w], complete ? "true" : "false",
+                win->start_us / 1e6, (win->end_us - win->start_us) / 1e6,
+                (unsigned)win->frames);
+        appendf(&o, "\"rms\":{\"mean\":%.5f,\"std\":%.5f,\"min\":%.5f,\"max\":%.5f},",
+                win->rms.mean, running_stat_stddev(&win->rms),
+                win->frames ? win->rms_min : 0.0f, win->rms_max);
+        appendf(&o, "\"centroid_hz\":{\"frames\":%u,\"mean\":%.1f,\"std\":%.1f},",
+                (unsigned)win->centroid.n, win->centroid.mean,
+                running_stat_stddev(&win->centroid));
+
+        appendf(&o, "\"level_dbfs\":{");
+        for (size_t p = 0; p < PERCENTILE_COUNT; p++) {
+            appendf(&o, "%s\"p%d\":%.1f", p ? "," : "", (int)(PERCENTILES[p] * 100 + 0.5f),
+                    feature_window_level_quantile(win, PERCENTILES[p]));
+        }
+
+        appendf(&o, "},\"dwell_s\":{");
+        for (int s = 0; s < FEATURE_STATS_SCENES; s++) {
+            appendf(&o, "%s\"%s\":%.3f", s ? "," : "", SCENE_NAMES[s],
+                    (double)win->scene_frames[s] * st->frame_us / 1e6);
+        }
+        appendf(&o, "},\"scene_changes\":%u}", (unsigned)win->scene_changes);
+    }
+    appendf(&o, "}");
+
+    sound_level_stats_t sl;
+    if (sample_process_get_sound_level(&sl)) {
+        appendf(&o, ",\"sound_level\":{\"weighting\":\"%s\",\"fast_db\":%.1f,\"slow_db\":%.1f",
+                sound_level_weighting_name(sl.weighting), sl.fast_db, sl.slow_db);
+        if (sl.intervals) {
+            appendf(&o, ",\"interval_s\":%.0f,\"leq_db\":%.1f,\"lmax_db\":%.1f,\"lmin_db\":%.1f",
+                    sl.interval_s, sl.leq_db, sl.lmax_db, sl.lmin_db);
+        }
+        appendf(&o, "}");
+    }
+    appendf(&o, "}");
+
+    free(st);
+    return o.used;
+}
+
+size_t summary_format_binary(uint8_t *buf, size_t len)
+{
+    size_t need = sizeof(summary_bin_header_t) +
+                  FEATURE_STATS_WINDOWS * sizeof(summary_bin_window_t);
+    if (!buf || len < need) return 0;
+
+    feature_stats_t *st = snapshot();
+    if (!st) return 0;
+
+    summary_bin_header_t hdr = {
+        .magic        = SUMMARY_BINARY_MAGIC,
+        .uptime_ms    = (uint32_t)(esp_timer_get_time() / 1000),
+        .frame_us     = st->frame_us,
+        .window_count = FEATURE_STATS_WINDOWS,
+        .scene_count  = FEATURE_STATS_SCENES,
+    };
+
+    uint8_t *p = buf;
+    memcpy(p, &hdr, sizeof(hdr));
+    p += sizeof(hdr);
+
+    for (int w = 0; w < FEATURE_STATS_WINDOWS; w++) {
+        bool complete;
+        const feature_window_t *win = feature_stats_latest(st, w, &complete);
+
+        summary_bin_window_t b = {
+            .complete         = complete,
+            .start_ms         = (uint32_t)(win->start_us / 1000),
+            .duration_ms      = (uint32_t)((win->end_us - win->start_us) / 1000),
+            .frames           = win->frames,
+            .rms_mean         = win->rms.mean,
+            .rms_std          = running_stat_stddev(&win->rms),
+            .rms_min          = win->frames ? win->rms_min : 0.0f,
+            .rms_max          = win->rms_max,
+            .centroid_frames  = win->centroid.n,
+            .centroid_mean_hz = win->centroid.mean,
+            .centroid_std_hz  = running_stat_stddev(&win->centroid),
+            .scene_changes    = win->scene_changes,
+        };
+        for (size_t q = 0; q < PERCENTILE_COUNT; q++) {
+            b.level_dbfs[q] = feature_window_level_quantile(win, PERCENTILES[q]);
+        }
+        for (int s = 0; s < FEATURE_STATS_SCENES; s++) {
+            b.scene_ms[s] = (uint32_t)((uint64_t)win->scene_frames[s] * st->frame_us / 1000);
+        }
+        memcpy(p, &b, sizeof(b));
+        p += sizeof(b);
+    }
+
+    free(st);
+    return (size_t)(p - buf);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Long-term feature summary (1 s, 1 min, 1 h windows) in two encodings:
+ *
+ *  - JSON, served at GET /summary
+ *  - SUM0 binary message, served at GET /summary?format=bin and sent in
+ *    reply to the WebSocket text command "summary" (little-endian):
+ *
+ *    [Header]
+ *     uint32_t magic              // "SUM0"
+ *     uint32_t uptime_ms
+ *     uint32_t frame_us           // frame period
+ *     uint8_t  window_count       // 1 s, 1 min, 1 h
+ *     uint8_t  scene_count        // audio_scene_t order
+ *     uint8_t  reserved[2]
+ *    [Payload] window_count x
+ *     uint8_t  complete           // 0 while the first window is still open
+ *     uint8_t  reserved[3]
+ *     uint32_t start_ms           // since boot, sample clock
+ *     uint32_t duration_ms
+ *     uint32_t frames
+ *     float    rms_mean, rms_std, rms_min, rms_max
+ *     uint32_t centroid_frames
+ *     float    centroid_mean_hz, centroid_std_hz
+ *     float    level_p10_dbfs, level_p50_dbfs, level_p90_dbfs, level_p99_dbfs
+ *     uint32_t scene_ms[scene_count]  // dwell time per scene
+ *     uint32_t scene_changes
+ */
+
+#define SUMMARY_BINARY_MAGIC 0x304D5553  /* "SUM0" */
+
+// Both return the number of bytes written (0 or truncated when len is too small)
+size_t summary_format_json(char *buf, size_t len);
+size_t summary_format_binary(uint8_t *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
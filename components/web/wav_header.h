@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WAV_HEADER_SIZE         44
+#define WAV_UNKNOWN_LENGTH      0xFFFFFFFFu   // for open-ended streams
+
+static inline void wav_put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static inline void wav_put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+/*
+ * Canonical 44-byte PCM WAV header. Pass WAV_UNKNOWN_LENGTH as data_bytes
+ * for a live stream whose length is not known up front.
+ */
+static inline void wav_build_header(uint8_t out[WAV_HEADER_SIZE], uint32_t sample_rate,
+                                    uint16_t channels, uint16_t bits, uint32_t data_bytes)
+{
+    uint16_t block_align = channels * bits / 8;
+    uint32_t riff_size = (data_bytes == WAV_UNKNOWN_LENGTH) ? WAV_UNKNOWN_LENGTH
+                                                            : data_bytes + 36;
+
+    memcpy(out, "RIFF", 4);
+    wav_put_le32(out + 4, riff_size);
+    memcpy(out + 8, "WAVEfmt ", 8);
+    wav_put_le32(out + 16, 16);                 // fmt chunk size
+    wav_put_le16(out + 20, 1);                  // PCM
+    wav_put_le16(out + 22, channels);
+    wav_put_le32(out + 24, sample_rate);
+    wav_put_le32(out + 28, sample_rate * block_align);
+    wav_put_le16(out + 32, block_align);
+    wav_put_le16(out + 34, bits);
+    memcpy(out + 36, "data", 4);
+    wav_put_le32(out + 40, data_bytes);
+}
+
+#ifdef __cplusplus
+}
+#endif
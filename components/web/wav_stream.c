@@ -0,0 +1,191 @@
+/**
+ * @file wav_stream.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements the live /stream.wav endpoint: open-ended WAV over chunked
+ *        HTTP, fed from the frame pool with one queue per reader.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include "esp_log.h"
+
+#include "audio_frame.h"
+#include "sample_process.h"
+#include "power_manager.h"
+#include "http_chunk.h"
+#include "wav_header.h"
+#include "wav_stream.h"
+#include "sdkconfig.h"
+
+#define MAX_READERS         CONFIG_WAV_STREAM_MAX_READERS
+#define MAX_GAP_FILL        AUDIO_FRAME_SAMPLE_RATE     // silence written per gap, at most
+
+static const char *TAG = "wav_stream";
+
+typedef struct {
+    QueueHandle_t frames;           // audio_frame_t *, one reference each
+    TaskHandle_t task;
+    struct netconn *conn;
+    uint32_t stream;
+    volatile bool busy;             // set by the server task, cleared by the reader
+    uint8_t index;
+} wav_reader_t;
+
+static wav_reader_t s_readers[MAX_READERS];
+
+// Silence for gaps; const, so it lives in flash
+static const int16_t s_zeros[AUDIO_FRAME_MAX_SAMPLES];
+
+static err_t write_silence(struct netconn *conn, uint64_t samples)
+{
+    if (samples > MAX_GAP_FILL) {
+        samples = MAX_GAP_FILL;
+    }
+
+    err_t err = ERR_OK;
+    while (err == ERR_OK && samples) {
+        size_t n = samples < AUDIO_FRAME_MAX_SAMPLES ? (size_t)samples : AUDIO_FRAME_MAX_SAMPLES;
+        err = http_write_chunk(conn, s_zeros, n * sizeof(int16_t));
+        samples -= n;
+    }
+    return err;
+}
+
+static void release_queued(wav_reader_t *r)
+{
+    audio_frame_t *frame;
+    while (xQueueReceive(r->frames, &frame, 0) == pdTRUE) {
+        audio_frame_release(frame);
+    }
+}
+
+static void stream_to_client(wav_reader_t *r)
+{
+    const bool proc = (r->stream == AUDIO_STREAM_PROC);
+    char hdr[192];
+    int n = snprintf(hdr, sizeof(hdr),
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: audio/wav\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Cache-Control: no-cache\r\n"
+        "X-Audio-Source: %s\r\n"
+        "Connection: close\r\n\r\n",
+        proc ? "proc" : "raw");
+
+    netconn_set_sendtimeout(r->conn, CONFIG_WAV_STREAM_SEND_TIMEOUT_MS);
+    err_t err = netconn_write(r->conn, hdr, n, NETCONN_COPY);
+
+    uint8_t wav[WAV_HEADER_SIZE];
+    wav_build_header(wav, AUDIO_FRAME_SAMPLE_RATE, 1, 16, WAV_UNKNOWN_LENGTH);
+    if (err == ERR_OK) err = http_write_chunk(r->conn, wav, sizeof(wav));
+
+    // Frames start flowing from here on
+    sample_process_set_sink_streams(r->frames, r->stream);
+
+    uint64_t next_index = 0;
+    bool started = false;
+    uint32_t chunks = 0;
+    uint64_t gap_samples = 0;
+
+    while (err == ERR_OK) {
+        audio_frame_t *frame = NULL;
+        if (xQueueReceive(r->frames, &frame, pdMS_TO_TICKS(1000)) != pdTRUE) {
+            continue;
+        }
+
+        const int16_t *pcm = proc ? frame->samples_out : frame->samples_in;
+        if (pcm) {
+            // Frames this reader missed while it was blocked become silence
+            if (started && frame->sample_index > next_index) {
+                gap_samples += frame->sample_index - next_index;
+                err = write_silence(r->conn, frame->sample_index - next_index);
+            }
+            if (err == ERR_OK) {
+                err = http_write_chunk(r->conn, pcm, frame->sample_count * sizeof(int16_t));
+            }
+            next_index = frame->sample_index + frame->sample_count;
+            started = true;
+            chunks++;
+        }
+        audio_frame_release(frame);
+    }
+
+    sample_process_set_sink_streams(r->frames, 0);
+    release_queued(r);
+
+    ESP_LOGI(TAG, "reader %u closed (err %d): %u chunks, %u samples of gap filled",
+             r->index, err, (unsigned)chunks, (unsigned)gap_samples);
+}
+
+static void wav_reader_task(void *arg)
+{
+    wav_reader_t *r = arg;
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // TCP ACKs must not wait for DTIM beacons while streaming
+        power_manager_hold_streaming(true);
+        stream_to_client(r);
+        power_manager_hold_streaming(false);
+
+        netconn_close(r->conn);
+        netconn_delete(r->conn);
+        r->conn = NULL;
+        r->busy = false;
+    }
+}
+
+esp_err_t wav_stream_init(void)
+{
+    for (int i = 0; i < MAX_READERS; i++) {
+        wav_reader_t *r = &s_readers[i];
+        char name[16];
+
+        r->index = i;
+        r->frames = xQueueCreate(CONFIG_WAV_STREAM_QUEUE_LEN, sizeof(audio_frame_t *));
+        if (!r->frames) {
+            return ESP_ERR_NO_MEM;
+        }
+
+        // Registered idle: no streams, so nothing is queued until a client connects.
+        // Gaps become silence either way; dropping the oldest keeps the listener live
+        snprintf(name, sizeof(name), "wav%d", i);
+        esp_err_t err = sample_process_add_sink(r->frames, name, 0, SAMPLE_PROCESS_DROP_OLDEST);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "No frame sink slot for reader %d", i);
+            return err;
+        }
+
+        snprintf(name, sizeof(name), "wav_reader%d", i);
+        if (xTaskCreatePinnedToCore(wav_reader_task, name, 3072, r, 5, &r->task,
+                                    SAMPLE_PROCESS_SINK_CORE(CONFIG_WAV_STREAM_TASK_CORE)) != pdPASS) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+bool wav_stream_start(struct netconn *conn, uint32_t stream)
+{
+    for (int i = 0; i < MAX_READERS; i++) {
+        wav_reader_t *r = &s_readers[i];
+        if (r->task && !r->busy) {
+            r->busy   = true;
+            r->conn   = conn;
+            r->stream = stream;
+            xTaskNotifyGive(r->task);
+            ESP_LOGI(TAG, "reader %d: streaming %s", i,
+                     stream == AUDIO_STREAM_PROC ? "proc" : "raw");
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lwip/api.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Live audio over HTTP (GET /stream.wav): a WAV header with unknown length
+ * followed by 16-bit PCM in chunked transfer encoding, one chunk per frame,
+ * written straight from the pooled frame. Each of the
+ * CONFIG_WAV_STREAM_MAX_READERS readers has its own task and frame queue:
+ * a slow reader only loses its own frames, and the gap is filled with
+ * silence so the file keeps the capture timeline.
+ */
+
+// Create the reader tasks and register their frame sinks
+esp_err_t wav_stream_init(void);
+
+/*
+ * Hand an accepted connection, request already read, to a free reader.
+ * `stream` is AUDIO_STREAM_RAW or AUDIO_STREAM_PROC. On success the reader
+ * owns `conn` and closes it; returns false when every reader is busy.
+ */
+bool wav_stream_start(struct netconn *conn, uint32_t stream);
+
+#ifdef __cplusplus
+}
+#endif
@@ -16,28 +16,128 @@
 #include "esp_log.h"
 
 #include "audio_frame.h"
+#include "dsp_features.h"
+#include "scene_detector.h"
 #include "websocket_server.h"
+#include "stream_subscription.h"
+#include "metrics.h"
 
 static const char *TAG = "web_client";
 
-// External queue handle                                
+// External queue handles                                
 extern QueueHandle_t audio_frame_queue;
+extern QueueHandle_t scene_event_queue;
 
-// WebSocket packet format                                  
+// WebSocket packet formats
 /*
- * [Header]
- *  uint32_t magic
- *  uint32_t sample_count
- *  float    rms
- *  float    centroid
- *  float    gain
- *  uint8_t  scene
+ * Every message starts with a uint32_t magic identifying its type. Which
+ * messages a client receives depends on its subscription (see
+ * stream_subscription.h); each message is serialized at most once per frame
+ * and only if at least one client wants it.
  *
- * [Payload]
- *  int16_t samples_in[sample_count]
- *  int16_t samples_out[sample_count]
+ * AUD0 - legacy combined frame (clients that never subscribed)
+ *  [Header]
+ *   uint32_t magic
+ *   uint32_t sample_count
+ *   float    rms
+ *   float    centroid
+ *   float    gain
+ *   uint8_t  scene
+ *  [Payload]
+ *   int16_t samples_in[sample_count]
+ *   int16_t samples_out[sample_count]
+ *
+ * FEA0 - features only: same 21-byte header as AUD0, no payload
+ *
+ * PCM0 - one PCM block
+ *  [Header]
+ *   uint32_t magic
+ *   uint32_t sample_count
+ *   uint8_t  stream          // 0 = raw input, 1 = processed output
+ *   uint8_t  reserved[3]
+ *  [Payload]
+ *   int16_t samples[sample_count]
+ *
+ * ENV0 - min/max envelope of the processed output
+ *  [Header]
+ *   uint32_t magic
+ *   uint32_t point_count
+ *   uint32_t samples_per_point
+ *  [Payload]
+ *   int16_t minmax[2 * point_count]   // {min, max} pairs
+ *
+ * SPC0 - quantized log-magnitude spectrum
+ *  [Header]
+ *   uint32_t magic
+ *   uint32_t bin_count
+ *   float    bin_hz
+ *   float    db_floor
+ *   float    db_ceil
+ *  [Payload]
+ *   uint8_t  bins[bin_count]   // 0 = db_floor, 255 = db_ceil
+ *
+ * EVT0 - debounced scene transition (sent once per change, never divided)
+ *   uint32_t magic
+ *   uint32_t frame_index       // pipeline frame that confirmed the change
+ *   int64_t  timestamp_us      // esp_timer time of that frame's capture
+ *   uint8_t  from_scene
+ *   uint8_t  to_scene
+ *   uint8_t  reserved[2]
+ *   float    confidence        // 0..1, agreement of recent raw labels
+ *   float    mean_rms          // averaged over the dwell window
+ *   float    mean_centroid
+ *   uint32_t prev_duration_ms  // time spent in from_scene
+ *
+ * DAS2 - v2 frame messages (clients that subscribed with "v2")
+ *  [Header, 40 bytes, payload starts 8-byte aligned]
+ *   uint32_t magic             // "DAS2"
+ *   uint8_t  version           // 2
+ *   uint8_t  kind              // WS_V2_KIND_*
+ *   uint8_t  encoding          // WS_V2_ENC_*, how to read the payload
+ *   uint8_t  flags             // AUDIO_FRAME_FLAG_*
+ *   uint32_t sequence          // per captured frame; gaps = dropped frames
+ *   uint32_t count             // samples, points or bins in the payload
+ *   int64_t  timestamp_us      // capture time of the first sample
+ *   uint64_t sample_index      // first sample since capture start
+ *   uint32_t payload_len       // bytes following the header
+ *   float    param             // kind specific, see below
+ *  [Payload]
+ *   FEATURES  F32:        float rms, centroid, gain; uint32_t scene;
+ *                         float bandwidth_hz, rolloff_hz, flatness, flux;
+ *                         float band_db[5];  // 0-300, 300-1k, 1k-2k, 2k-4k, 4k+ Hz
+ *                         the spectral fields are 0 unless flags has
+ *                         AUDIO_FRAME_FLAG_SPECTRAL; count = samples in the frame
+ *   PCM_RAW   S16LE:      int16_t samples[count]
+ *   PCM_PROC  S16LE:      int16_t samples[count]
+ *   ENVELOPE  MINMAX_S16: int16_t minmax[2 * count]; param = samples/point
+ *   SPECTRUM  DB_U8:      float db_floor, db_ceil; uint8_t bins[count];
+ *                         param = bin_hz
+ * Every message of one frame shares sequence, timestamp and sample_index.
  */
 
+#define WS_FEATURES_MAGIC 0x46454130  /* "FEA0" */
+#define WS_PCM_MAGIC      0x50434D30  /* "PCM0" */
+#define WS_ENVELOPE_MAGIC 0x454E5630  /* "ENV0" */
+#define WS_SPECTRUM_MAGIC 0x53504330  /* "SPC0" */
+#define WS_EVENT_MAGIC    0x45565430  /* "EVT0" */
+#define WS_V2_MAGIC       0x32534144  /* "DAS2" */
+
+#define WS_V2_VERSION     2
+
+#define WS_V2_KIND_FEATURES   0
+#define WS_V2_KIND_PCM_RAW    1
+#define WS_V2_KIND_PCM_PROC   2
+#define WS_V2_KIND_ENVELOPE   3
+#define WS_V2_KIND_SPECTRUM   4
+
+#define WS_V2_ENC_F32         0
+#define WS_V2_ENC_S16LE       1
+#define WS_V2_ENC_MINMAX_S16  2
+#define WS_V2_ENC_DB_U8       3
+
+#define WS_PCM_STREAM_RAW   0
+#define WS_PCM_STREAM_PROC  1
+
 typedef struct __attribute__((packed)) {
     uint32_t magic;
     uint32_t sample_count;
@@ -47,20 +147,150 @@ typedef struct __attribute__((packed)) {
     uint8_t scene;
 } ws_audio_header_t;
 
-// Serializatio
-static size_t serialize_audio_frame(
-    const audio_frame_t *frame,
-    uint8_t *out_buf,
-    size_t buf_size)
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t sample_count;
+    uint8_t stream;
+    uint8_t reserved[3];
+} ws_pcm_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t point_count;
+    uint32_t samples_per_point;
+} ws_envelope_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t bin_count;
+    float bin_hz;
+    float db_floor;
+    float db_ceil;
+} ws_spectrum_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t frame_index;
+    int64_t timestamp_us;
+    uint8_t from_scene;
+    uint8_t to_scene;
+    uint8_t reserved[2];
+    float confidence;
+    float mean_rms;
+    float mean_centroid;
+    uint32_t prev_duration_ms;
+} ws_event_msg_t;
+
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t kind;
+    uint8_t encoding;
+    uint8_t flags;
+    uint32_t sequence;
+    uint32_t count;
+    int64_t timestamp_us;
+    uint64_t sample_index;
+    uint32_t payload_len;
+    float param;
+} ws_v2_header_t;
+
+_Static_assert(sizeof(ws_v2_header_t) == 40, "v2 header must stay 40 bytes");
+
+typedef struct {
+    float rms;
+    float centroid;
+    float gain;
+    uint32_t scene;
+    float bandwidth_hz;
+    float rolloff_hz;
+    float flatness;
+    float flux;
+    float band_db[DSP_SPECTRAL_BANDS];
+} ws_v2_features_t;
+
+_Static_assert(DSP_SPECTRAL_BANDS == 5, "v2 feature payload documents five bands");
+
+typedef struct {
+    float db_floor;
+    float db_ceil;
+} ws_v2_spectrum_prefix_t;
+
+// One serialized message, the subscription bits that select it and the
+// wire format version it was encoded with
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    uint32_t sub_bits;
+    uint8_t version;
+} ws_message_t;
+
+#define WS_MAX_MESSAGES 12
+
+// Worst case of one frame: every stream at full size, in both wire formats
+#define WS_PCM_MAX_BYTES      (AUDIO_FRAME_MAX_SAMPLES * sizeof(int16_t))
+#define WS_ENVELOPE_MAX_BYTES (2 * AUDIO_FRAME_MAX_ENVELOPE_POINTS * sizeof(int16_t))
+#define WS_V1_FRAME_MAX_BYTES                                               \
+    (sizeof(ws_audio_header_t) + 2 * WS_PCM_MAX_BYTES   /* AUD0 */          \
+     + sizeof(ws_audio_header_t)                        /* FEA0 */          \
+     + 2 * (sizeof(ws_pcm_header_t) + WS_PCM_MAX_BYTES) /* PCM0 raw, proc */\
+     + sizeof(ws_envelope_header_t) + WS_ENVELOPE_MAX_BYTES                 \
+     + sizeof(ws_spectrum_header_t) + AUDIO_FRAME_MAX_SPECTRUM_BINS)
+#define WS_V1_MAX_MESSAGES    6
+#define WS_V2_FRAME_MAX_BYTES                                               \
+    (5 * sizeof(ws_v2_header_t) + sizeof(ws_v2_features_t)                  \
+     + 2 * WS_PCM_MAX_BYTES + WS_ENVELOPE_MAX_BYTES                         \
+     + sizeof(ws_v2_spectrum_prefix_t) + AUDIO_FRAME_MAX_SPECTRUM_BINS)
+#define WS_V2_MAX_MESSAGES    5
+
+// Scales with AUDIO_FRAME_MAX_SAMPLES, i.e. with the feature decimation
+#define WS_TX_ARENA_SIZE      ((WS_V1_FRAME_MAX_BYTES + WS_V2_FRAME_MAX_BYTES + 1023) & ~(size_t)1023)
+
+_Static_assert(WS_TX_ARENA_SIZE >= WS_V1_FRAME_MAX_BYTES + WS_V2_FRAME_MAX_BYTES,
+               "tx arena must hold every v1 and v2 message of one frame");
+_Static_assert(WS_MAX_MESSAGES >= WS_V1_MAX_MESSAGES + WS_V2_MAX_MESSAGES,
+               "tx arena must index every v1 and v2 message of one frame");
+
+// Serialization helpers: append header + payload to the tx arena
+typedef struct {
+    uint8_t *buf;
+    size_t size;
+    size_t used;
+    ws_message_t msgs[WS_MAX_MESSAGES];
+    int count;
+    uint8_t version;    // stamped on messages added from now on
+} ws_tx_arena_t;
+
+static void arena_add(ws_tx_arena_t *a, uint32_t sub_bits,
+                      const void *hdr, size_t hdr_len,
+                      const void *p1, size_t p1_len,
+                      const void *p2, size_t p2_len)
 {
-    size_t header_size = sizeof(ws_audio_header_t);
-    size_t audio_bytes = frame->sample_count * sizeof(int16_t);
-    size_t total_size  = header_size + 2 * audio_bytes;
+    size_t total = hdr_len + p1_len + p2_len;
 
-    if (buf_size < total_size) {
-        return 0;
+    if (a->count >= WS_MAX_MESSAGES || a->size - a->used < total) {
+        ESP_LOGW(TAG, "WebSocket packet too large, dropping message");
+        return;
     }
 
+    uint8_t *p = a->buf + a->used;
+    memcpy(p, hdr, hdr_len);
+    if (p1_len) memcpy(p + hdr_len, p1, p1_len);
+    if (p2_len) memcpy(p + hdr_len + p1_len, p2, p2_len);
+
+    a->msgs[a->count++] = (ws_message_t) {
+        .data     = p,
+        .len      = total,
+        .sub_bits = sub_bits,
+        .version  = a->version
+    };
+    a->used += total;
+}
+
+static void serialize_frame(const audio_frame_t *frame, uint32_t wanted, ws_tx_arena_t *a)
+{
+    size_t audio_bytes = frame->sample_count * sizeof(int16_t);
+
     ws_audio_header_t hdr = {
         .magic        = frame->magic,
         .sample_count = frame->sample_count,
@@ -70,16 +300,172 @@ static size_t serialize_audio_frame(
         .scene        = (uint8_t)frame->scene
     };
 
-    uint8_t *p = out_buf;
-    memcpy(p, &hdr, header_size);
-    p += header_size;
+    if ((wanted & STREAM_SUB_LEGACY) && frame->samples_in && frame->samples_out) {
+        arena_add(a, STREAM_SUB_LEGACY, &hdr, sizeof(hdr),
+                  frame->samples_in, audio_bytes,
+                  frame->samples_out, audio_bytes);
+    }
+
+    if (wanted & AUDIO_STREAM_FEATURES) {
+        ws_audio_header_t fea = hdr;
+        fea.magic = WS_FEATURES_MAGIC;
+        arena_add(a, AUDIO_STREAM_FEATURES, &fea, sizeof(fea), NULL, 0, NULL, 0);
+    }
+
+    if ((wanted & AUDIO_STREAM_RAW) && frame->samples_in) {
+        ws_pcm_header_t pcm = {
+            .magic        = WS_PCM_MAGIC,
+            .sample_count = frame->sample_count,
+            .stream       = WS_PCM_STREAM_RAW
+        };
+        arena_add(a, AUDIO_STREAM_RAW, &pcm, sizeof(pcm),
+                  frame->samples_in, audio_bytes, NULL, 0);
+    }
+
+    if ((wanted & AUDIO_STREAM_PROC) && frame->samples_out) {
+        ws_pcm_header_t pcm = {
+            .magic        = WS_PCM_MAGIC,
+            .sample_count = frame->sample_count,
+            .stream       = WS_PCM_STREAM_PROC
+        };
+        arena_add(a, AUDIO_STREAM_PROC, &pcm, sizeof(pcm),
+                  frame->samples_out, audio_bytes, NULL, 0);
+    }
+
+    if ((wanted & AUDIO_STREAM_ENVELOPE) && frame->envelope) {
+        ws_envelope_header_t env = {
+            .magic             = WS_ENVELOPE_MAGIC,
+            .point_count       = frame->envelope_points,
+            .samples_per_point = frame->sample_count / frame->envelope_points
+        };
+        arena_add(a, AUDIO_STREAM_ENVELOPE, &env, sizeof(env),
+                  frame->envelope, 2 * frame->envelope_points * sizeof(int16_t),
+                  NULL, 0);
+    }
+
+    if ((wanted & (AUDIO_STREAM_SPECTRUM | STREAM_SUB_LEGACY)) && frame->spectrum) {
+        ws_spectrum_header_t spc = {
+            .magic     = WS_SPECTRUM_MAGIC,
+            .bin_count = frame->spectrum_bins,
+            .bin_hz    = frame->spectrum_bin_hz,
+            .db_floor  = DSP_SPECTRUM_DB_FLOOR,
+            .db_ceil   = DSP_SPECTRUM_DB_CEIL
+        };
+        arena_add(a, AUDIO_STREAM_SPECTRUM | STREAM_SUB_LEGACY, &spc, sizeof(spc),
+                  frame->spectrum, frame->spectrum_bins, NULL, 0);
+    }
+}
+
+static ws_v2_header_t v2_header(const audio_frame_t *frame, uint8_t kind, uint8_t encoding,
+                                uint32_t count, uint32_t payload_len, float param)
+{
+    return (ws_v2_header_t) {
+        .magic        = WS_V2_MAGIC,
+        .version      = WS_V2_VERSION,
+        .kind         = kind,
+        .encoding     = encoding,
+        .flags        = (uint8_t)frame->flags,
+        .sequence     = frame->sequence,
+        .count        = count,
+        .timestamp_us = frame->timestamp_us,
+        .sample_index = frame->sample_index,
+        .payload_len  = payload_len,
+        .param        = param
+    };
+}
+
+static void serialize_frame_v2(const audio_frame_t *frame, uint32_t wanted, ws_tx_arena_t *a)
+{
+    size_t audio_bytes = frame->sample_count * sizeof(int16_t);
+
+    if (wanted & AUDIO_STREAM_FEATURES) {
+        ws_v2_features_t fea = {
+            .rms          = frame->rms,
+            .centroid     = frame->centroid,
+            .gain         = frame->gain,
+            .scene        = (uint32_t)frame->scene,
+            .bandwidth_hz = frame->spectral.bandwidth_hz,
+            .rolloff_hz   = frame->spectral.rolloff_hz,
+            .flatness     = frame->spectral.flatness,
+            .flux         = frame->spectral.flux
+        };
+        memcpy(fea.band_db, frame->spectral.band_db, sizeof(fea.band_db));
+        ws_v2_header_t hdr = v2_header(frame, WS_V2_KIND_FEATURES, WS_V2_ENC_F32,
+                                       frame->sample_count, sizeof(fea), 0.0f);
+        arena_add(a, AUDIO_STREAM_FEATURES, &hdr, sizeof(hdr), &fea, sizeof(fea), NULL, 0);
+    }
+
+    if ((wanted & AUDIO_STREAM_RAW) && frame->samples_in) {
+        ws_v2_header_t hdr = v2_header(frame, WS_V2_KIND_PCM_RAW, WS_V2_ENC_S16LE,
+                                       frame->sample_count, audio_bytes, 0.0f);
+        arena_add(a, AUDIO_STREAM_RAW, &hdr, sizeof(hdr),
+                  frame->samples_in, audio_bytes, NULL, 0);
+    }
+
+    if ((wanted & AUDIO_STREAM_PROC) && frame->samples_out) {
+        ws_v2_header_t hdr = v2_header(frame, WS_V2_KIND_PCM_PROC, WS_V2_ENC_S16LE,
+                                       frame->sample_count, audio_bytes, 0.0f);
+        arena_add(a, AUDIO_STREAM_PROC, &hdr, sizeof(hdr),
+                  frame->samples_out, audio_bytes, NULL, 0);
+    }
 
-    memcpy(p, frame->samples_in, audio_bytes);
-    p += audio_bytes;
+    if ((wanted & AUDIO_STREAM_ENVELOPE) && frame->envelope) {
+        size_t env_bytes = 2 * frame->envelope_points * sizeof(int16_t);
+        ws_v2_header_t hdr = v2_header(frame, WS_V2_KIND_ENVELOPE, WS_V2_ENC_MINMAX_S16,
+                                       frame->envelope_points, env_bytes,
+                                       (float)(frame->sample_count / frame->envelope_points));
+        arena_add(a, AUDIO_STREAM_ENVELOPE, &hdr, sizeof(hdr),
+                  frame->envelope, env_bytes, NULL, 0);
+    }
 
-    memcpy(p, frame->samples_out, audio_bytes);
+    if ((wanted & AUDIO_STREAM_SPECTRUM) && frame->spectrum) {
+        ws_v2_spectrum_prefix_t range = {
+            .db_floor = DSP_SPECTRUM_DB_FLOOR,
+            .db_ceil  = DSP_SPECTRUM_DB_CEIL
+        };
+        ws_v2_header_t hdr = v2_header(frame, WS_V2_KIND_SPECTRUM, WS_V2_ENC_DB_U8,
+                                       frame->spectrum_bins,
+                                       sizeof(range) + frame->spectrum_bins,
+                                       frame->spectrum_bin_hz);
+        arena_add(a, AUDIO_STREAM_SPECTRUM, &hdr, sizeof(hdr), &range, sizeof(range),
+                  frame->spectrum, frame->spectrum_bins);
+    }
+}
 
-    return total_size;
+// Send one binary message to one client and account for it
+static void send_to_client(int num, const void *data, size_t len)
+{
+    if (ws_server_send_bin_client(num, (char *)data, len)) {
+        metrics_ws_tx((uint8_t)num, len);
+    } else {
+        metrics_inc(METRIC_WS_SEND_ERRORS);
+    }
+}
+
+// Forward pending scene events to every client subscribed to them
+static void send_scene_events(void)
+{
+    scene_event_t ev;
+
+    while (xQueueReceive(scene_event_queue, &ev, 0) == pdTRUE) {
+        ws_event_msg_t msg = {
+            .magic            = WS_EVENT_MAGIC,
+            .frame_index      = ev.frame_index,
+            .timestamp_us     = ev.timestamp_us,
+            .from_scene       = (uint8_t)ev.from,
+            .to_scene         = (uint8_t)ev.to,
+            .confidence       = ev.confidence,
+            .mean_rms         = ev.mean_rms,
+            .mean_centroid    = ev.mean_centroid,
+            .prev_duration_ms = ev.prev_duration_ms
+        };
+
+        for (int i = 0; i < WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+            if (stream_sub_get(i, NULL) & AUDIO_STREAM_EVENTS) {
+                send_to_client(i, &msg, sizeof(msg));
+            }
+        }
+    }
 }
 
 // Web client task                                  
@@ -87,8 +473,9 @@ void web_client_task(void *pvParameters)
 {
     ESP_LOGI(TAG, "Web client task started");
 
-    // Static transmit buffer
-    static uint8_t tx_buffer[4096];
+    // Static transmit arena, holds every message of one frame
+    static uint8_t tx_buffer[WS_TX_ARENA_SIZE];
+    uint32_t frame_index = 0;
 
     while (1) {
         audio_frame_t *frame = NULL;
@@ -98,29 +485,66 @@ void web_client_task(void *pvParameters)
             continue;
         }
 
+        // Events are queued before the frame that confirmed them
+        send_scene_events();
+
         if (!frame || frame->magic != AUDIO_FRAME_MAGIC) {
             ESP_LOGW(TAG, "Invalid audio frame received");
             goto cleanup;
         }
 
-        // Serialize frame      
-        size_t pkt_len = serialize_audio_frame(
-            frame, tx_buffer, sizeof(tx_buffer));
+        // Snapshot subscriptions and drop clients whose divisor skips this frame
+        uint32_t subs[WEBSOCKET_SERVER_MAX_CLIENTS];
+        uint32_t wanted_v1 = 0;
+        uint32_t wanted_v2 = 0;
+
+        for (int i = 0; i < WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+            uint16_t divisor = 1;
+            subs[i] = stream_sub_get(i, &divisor);
+            if (divisor > 1 && (frame_index % divisor) != 0) {
+                subs[i] = 0;
+            }
+            if (subs[i] & STREAM_SUB_V2) {
+                wanted_v2 |= subs[i];
+            } else {
+                wanted_v1 |= subs[i];
+            }
+        }
+        frame_index++;
 
-        if (pkt_len == 0) {
-            ESP_LOGW(TAG, "WebSocket packet too large, dropping frame");
+        if (!wanted_v1 && !wanted_v2) {
+            metrics_inc(METRIC_FRAMES_UNWANTED);
             goto cleanup;
         }
+        metrics_inc(METRIC_FRAMES_SENT);
 
-        // Send over WebSocket
-        ws_server_send_bin_all((char *)tx_buffer, pkt_len);
+        // Serialize each wanted message once per wire format
+        ws_tx_arena_t arena = {
+            .buf  = tx_buffer,
+            .size = sizeof(tx_buffer)
+        };
+        if (wanted_v1) {
+            arena.version = 1;
+            serialize_frame(frame, wanted_v1, &arena);
+        }
+        if (wanted_v2) {
+            arena.version = WS_V2_VERSION;
+            serialize_frame_v2(frame, wanted_v2, &arena);
+        }
 
-cleanup:
-        // Free frame + buffers
-        if (frame) {
-            free(frame->samples_in);
-            free(frame->samples_out);
-            free(frame);
+        // Send each client only what it subscribed to, in its format
+        for (int i = 0; i < WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+            if (!subs[i]) continue;
+            uint8_t version = (subs[i] & STREAM_SUB_V2) ? WS_V2_VERSION : 1;
+            for (int m = 0; m < arena.count; m++) {
+                if ((arena.msgs[m].sub_bits & subs[i]) && arena.msgs[m].version == version) {
+                    send_to_client(i, arena.msgs[m].data, arena.msgs[m].len);
+                }
+            }
         }
+
+cleanup:
+        // Drop our reference; other sinks may still hold the frame
+        audio_frame_release(frame);
     }
 }
@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <inttypes.h>
 #include <string.h>
+#include <stdlib.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -16,6 +17,17 @@
 #include "esp_log.h"
 
 #include "websocket_server.h"
+#include "stream_subscription.h"
+#include "metrics.h"
+#include "metrics_export.h"
+#include "summary_export.h"
+#include "flight_recorder.h"
+#include "http_chunk.h"
+#include "wav_header.h"
+#include "wav_stream.h"
+#include "feature_log.h"
+#include "audio_frame.h"
+#include "sdkconfig.h"
 
 static QueueHandle_t client_queue;
 
@@ -23,6 +35,71 @@ static QueueHandle_t client_queue;
 const static int client_queue_size = 10;
 const static char* TAG = "web_server";
 
+#define METRICS_TEXT_MAX   12288
+#define METRICS_BIN_MAX    1024
+#define SUMMARY_TEXT_MAX   2048
+#define SUMMARY_BIN_MAX    512
+
+// replies to the "metrics" control command with a MET0 snapshot
+static void send_metrics_binary(uint8_t num) {
+	uint8_t* bin = malloc(METRICS_BIN_MAX);
+	if(!bin) return;
+	size_t n = metrics_format_binary(bin, METRICS_BIN_MAX);
+	if(n && ws_server_send_bin_client_from_callback(num, (char*)bin, n)) metrics_ws_tx(num, n);
+	free(bin);
+}
+
+// serves the Prometheus text snapshot
+static void send_metrics_text(struct netconn *conn) {
+	const static char METRICS_HEADER[] = "HTTP/1.1 200 OK\nContent-type: text/plain; version=0.0.4\n\n";
+	char* text = malloc(METRICS_TEXT_MAX);
+	if(!text) return;
+	size_t n = metrics_format_prometheus(text, METRICS_TEXT_MAX);
+	netconn_write(conn, METRICS_HEADER, sizeof(METRICS_HEADER)-1, NETCONN_NOCOPY);
+	netconn_write(conn, text, n, NETCONN_COPY);
+	free(text);
+}
+
+// value of a query parameter in the request line, NULL when absent
+static const char* query_param(const char* req, const char* name) {
+	const char* end = strstr(req, " HTTP/");
+	const char* p = strchr(req, '?');
+	size_t n = strlen(name);
+	if(!p || !end || p > end) return NULL;
+	p++;
+	while(p && p < end) {
+		if(strncmp(p, name, n) == 0 && p[n] == '=') return p + n + 1;
+		p = strchr(p, '&');
+		if(p) p++;
+	}
+	return NULL;
+}
+
+// replies to the "summary" control command with a SUM0 snapshot
+static void send_summary_binary(uint8_t num) {
+	uint8_t* bin = malloc(SUMMARY_BIN_MAX);
+	if(!bin) return;
+	size_t n = summary_format_binary(bin, SUMMARY_BIN_MAX);
+	if(n && ws_server_send_bin_client_from_callback(num, (char*)bin, n)) metrics_ws_tx(num, n);
+	free(bin);
+}
+
+// serves the 1 s / 1 min / 1 h feature summary, JSON or SUM0 with ?format=bin
+static void send_summary(struct netconn *conn, const char* req) {
+	const static char JSON_HEADER[] = "HTTP/1.1 200 OK\nContent-type: application/json\nCache-Control: no-cache\n\n";
+	const static char BIN_HEADER[] = "HTTP/1.1 200 OK\nContent-type: application/octet-stream\nCache-Control: no-cache\n\n";
+	const char* format = query_param(req, "format");
+	const bool bin = format && strncmp(format, "bin", 3) == 0;
+	char* out = malloc(bin ? SUMMARY_BIN_MAX : SUMMARY_TEXT_MAX);
+	if(!out) return;
+	size_t n = bin ? summary_format_binary((uint8_t*)out, SUMMARY_BIN_MAX)
+	               : summary_format_json(out, SUMMARY_TEXT_MAX);
+	if(bin) netconn_write(conn, BIN_HEADER, sizeof(BIN_HEADER)-1, NETCONN_NOCOPY);
+	else netconn_write(conn, JSON_HEADER, sizeof(JSON_HEADER)-1, NETCONN_NOCOPY);
+	netconn_write(conn, out, n, NETCONN_COPY);
+	free(out);
+}
+
 // handles websocket events
 void websocket_callback(uint8_t num,WEBSOCKET_TYPE_t type,char* msg,uint64_t len) {
 	const static char* TAG = "websocket_callback";
@@ -30,32 +107,160 @@ void websocket_callback(uint8_t num,WEBSOCKET_TYPE_t type,char* msg,uint64_t len
 	switch(type) {
 		case WEBSOCKET_CONNECT:
 			ESP_LOGI(TAG,"client %i connected!",num);
+			metrics_ws_client_reset(num);
+			stream_sub_client_connected(num);
 			break;
 		case WEBSOCKET_DISCONNECT_EXTERNAL:
 			ESP_LOGI(TAG,"client %i sent a disconnect message",num);
+			stream_sub_client_disconnected(num);
 			break;
 		case WEBSOCKET_DISCONNECT_INTERNAL:
 			ESP_LOGI(TAG,"client %i was disconnected",num);
+			stream_sub_client_disconnected(num);
 			break;
 		case WEBSOCKET_DISCONNECT_ERROR:
 			ESP_LOGI(TAG,"client %i was disconnected due to an error",num);
+			stream_sub_client_disconnected(num);
 			break;
-		case WEBSOCKET_TEXT:
-			ESP_LOGI(TAG, "Received text message from client %d (len=%" PRIu32 ")", 
-					num, (uint32_t)len);
+		case WEBSOCKET_TEXT: {
+			if(len >= 7 && strncmp(msg, "metrics", 7) == 0) {
+				send_metrics_binary(num);
+				break;
+			}
+			if(len >= 7 && strncmp(msg, "summary", 7) == 0) {
+				send_summary_binary(num);
+				break;
+			}
+			// control channel: stream subscriptions
+			char reply[64];
+			stream_sub_handle_command(num, msg, reply, sizeof(reply));
+			ws_server_send_text_client_from_callback(num, reply, strlen(reply));
 			break;
+		}
 		case WEBSOCKET_BIN:
-			ESP_LOGI(TAG,"client %i sent binary message of size %"PRIu32":\n%s",num,(uint32_t)len,msg);
+			ESP_LOGD(TAG,"client %i sent binary message of size %"PRIu32,num,(uint32_t)len);
 			break;
 		case WEBSOCKET_PING:
-			ESP_LOGI(TAG,"client %i pinged us with message of size %"PRIu32":\n%s",num,(uint32_t)len,msg);
+			ESP_LOGD(TAG,"client %i pinged us with message of size %"PRIu32,num,(uint32_t)len);
 			break;
 		case WEBSOCKET_PONG:
-			ESP_LOGI(TAG,"client %i responded to the ping",num);
+			ESP_LOGD(TAG,"client %i responded to the ping",num);
 			break;
 	}
 }
 
+#if CONFIG_FEATURE_LOG_ENABLE
+typedef struct {
+	struct netconn* conn;
+	err_t err;
+	bool csv;
+	int64_t from_us;
+	int64_t to_us;
+	size_t used;
+	char text[1024];
+} feature_query_t;
+
+static bool feature_csv_record(const feature_record_t* rec, void* arg) {
+	static const char* const SCENES[] = { "quiet", "speech", "noise", "?" };
+	feature_query_t* q = arg;
+	if(rec->timestamp_us < q->from_us || rec->timestamp_us > q->to_us) return true;
+	if(q->used > sizeof(q->text) - 64) {
+		q->err = http_write_chunk(q->conn, q->text, q->used);
+		q->used = 0;
+		if(q->err != ERR_OK) return false;
+	}
+	q->used += snprintf(q->text + q->used, sizeof(q->text) - q->used, "%.3f,%.5f,%.0f,%s\n",
+	                    rec->timestamp_us / 1e6, rec->rms, rec->centroid, SCENES[rec->scene & 3]);
+	return true;
+}
+
+static bool feature_block(const uint8_t* block, size_t len, void* arg) {
+	feature_query_t* q = arg;
+	if(q->csv) feature_block_decode(block, len, feature_csv_record, q);
+	else q->err = http_write_chunk(q->conn, block, len);
+	return q->err == ERR_OK;
+}
+
+// streams logged features of one boot in [from, to] seconds, as CSV or raw blocks
+static void send_feature_log(struct netconn *conn, const char* req) {
+	static feature_query_t q;	// only the server handle task serves requests
+	const char* v;
+
+	q.conn    = conn;
+	q.err     = ERR_OK;
+	q.used    = 0;
+	q.from_us = (v = query_param(req, "from")) ? (int64_t)(strtod(v, NULL) * 1e6) : INT64_MIN;
+	q.to_us   = (v = query_param(req, "to")) ? (int64_t)(strtod(v, NULL) * 1e6) : INT64_MAX;
+	q.csv     = !((v = query_param(req, "format")) && strncmp(v, "bin", 3) == 0);
+	uint32_t boot = (v = query_param(req, "boot")) ? strtoul(v, NULL, 10) : feature_log_boot();
+
+	char hdr[192];
+	int n = snprintf(hdr, sizeof(hdr),
+		"HTTP/1.1 200 OK\r\n"
+		"Content-Type: %s\r\n"
+		"Transfer-Encoding: chunked\r\n"
+		"X-Boot: %" PRIu32 "\r\n"
+		"Connection: close\r\n\r\n",
+		q.csv ? "text/csv" : "application/octet-stream", boot);
+	q.err = netconn_write(conn, hdr, n, NETCONN_COPY);
+	if(q.csv && q.err == ERR_OK) {
+		q.used = snprintf(q.text, sizeof(q.text), "# boot %" PRIu32 "\ntime_s,rms,centroid_hz,scene\n", boot);
+	}
+
+	if(q.err == ERR_OK) feature_log_query(boot, q.from_us, q.to_us, feature_block, &q);
+	if(q.err == ERR_OK && q.used) q.err = http_write_chunk(conn, q.text, q.used);
+	if(q.err == ERR_OK) netconn_write(conn, "0\r\n\r\n", 5, NETCONN_NOCOPY);
+}
+#endif
+
+#if CONFIG_AUDIO_RECORDER_ENABLE
+
+// streams the held flight recorder clip as WAV, decoding one block per chunk
+static void send_recorder_clip(struct netconn *conn) {
+	const static char NO_CLIP[] = "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\n"
+	                              "Connection: close\r\n\r\nno clip captured\n";
+	recorder_clip_t clip;
+
+	if(!flight_recorder_open_clip(&clip)) {
+		netconn_write(conn, NO_CLIP, sizeof(NO_CLIP)-1, NETCONN_NOCOPY);
+		return;
+	}
+
+	int16_t *pcm = malloc(clip.block_samples * sizeof(int16_t));
+	if(!pcm) {
+		flight_recorder_close_clip(false);
+		return;
+	}
+
+	char hdr[256];
+	int n = snprintf(hdr, sizeof(hdr),
+		"HTTP/1.1 200 OK\r\n"
+		"Content-Type: audio/wav\r\n"
+		"Content-Disposition: attachment; filename=\"recorder.wav\"\r\n"
+		"Transfer-Encoding: chunked\r\n"
+		"X-Trigger-Cause: %s\r\n"
+		"X-Pre-Trigger-Samples: %" PRIu32 "\r\n"
+		"Connection: close\r\n\r\n",
+		flight_recorder_cause_name(clip.cause), clip.pre_samples);
+	err_t err = netconn_write(conn, hdr, n, NETCONN_COPY);
+
+	uint8_t wav[WAV_HEADER_SIZE];
+	wav_build_header(wav, clip.sample_rate, 1, 16,
+	                 clip.block_count * clip.block_samples * sizeof(int16_t));
+	if(err == ERR_OK) err = http_write_chunk(conn, wav, sizeof(wav));
+
+	for(uint32_t b = 0; err == ERR_OK && b < clip.block_count; b++) {
+		flight_recorder_read_block(&clip, b, pcm);
+		err = http_write_chunk(conn, pcm, clip.block_samples * sizeof(int16_t));
+	}
+	if(err == ERR_OK) err = netconn_write(conn, "0\r\n\r\n", 5, NETCONN_NOCOPY);
+
+	free(pcm);
+	// only a complete download releases the clip
+	flight_recorder_close_clip(err == ERR_OK);
+}
+#endif
+
 // serves any clients
 static void http_server(struct netconn *conn) {
 	const static char* TAG = "http_server";
@@ -65,6 +270,11 @@ static void http_server(struct netconn *conn) {
 	const static char CSS_HEADER[] = "HTTP/1.1 200 OK\nContent-type: text/css\n\n";
 	//const static char PNG_HEADER[] = "HTTP/1.1 200 OK\nContent-type: image/png\n\n";
 	const static char ICO_HEADER[] = "HTTP/1.1 200 OK\nContent-type: image/x-icon\n\n";
+	const static char BUSY_HEADER[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Type: text/plain\r\n"
+	                                  "Retry-After: 5\r\nConnection: close\r\n\r\nall stream readers busy\n";
+#if CONFIG_AUDIO_RECORDER_ENABLE
+	const static char ACCEPTED_HEADER[] = "HTTP/1.1 202 Accepted\nContent-type: text/plain\n\ntriggered\n";
+#endif
 	//const static char PDF_HEADER[] = "HTTP/1.1 200 OK\nContent-type: application/pdf\n\n";
 	//const static char EVENT_HEADER[] = "HTTP/1.1 200 OK\nContent-Type: text/event-stream\nCache-Control: no-cache\nretry: 3000\n\n";
 	struct netbuf* inbuf;
@@ -97,9 +307,8 @@ static void http_server(struct netconn *conn) {
 	const uint32_t error_html_len = error_html_end - error_html_start;
 
 	netconn_set_recvtimeout(conn,1000); // allow a connection timeout of 1 second
-	ESP_LOGI(TAG,"reading from client...");
+	metrics_inc(METRIC_HTTP_REQUESTS);
 	err = netconn_recv(conn, &inbuf);
-	ESP_LOGI(TAG,"read from client");
 	if(err==ERR_OK) {
 		netbuf_data(inbuf, (void**)&buf, &buflen);
 		if(buf) {
@@ -108,7 +317,7 @@ static void http_server(struct netconn *conn) {
 			// default page
 			if (strstr(buf,"GET / ")
 					&& !strstr(buf,"Upgrade: websocket")) {
-				ESP_LOGI(TAG,"Sending /");
+				ESP_LOGD(TAG,"Sending /");
 				netconn_write(conn, HTML_HEADER, sizeof(HTML_HEADER)-1,NETCONN_NOCOPY);
 				netconn_write(conn, root_html_start,root_html_len,NETCONN_NOCOPY);
 				netconn_close(conn);
@@ -124,8 +333,22 @@ static void http_server(struct netconn *conn) {
 				netbuf_delete(inbuf);
 			}
 
+			else if(strstr(buf,"GET /metrics ")) {
+				send_metrics_text(conn);
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+
+			else if(strstr(buf,"GET /summary")) {
+				send_summary(conn, buf);
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+
 			else if(strstr(buf,"GET /main.js ")) {
-				ESP_LOGI(TAG,"Sending /main.js");
+				ESP_LOGD(TAG,"Sending /main.js");
 				netconn_write(conn, JS_HEADER, sizeof(JS_HEADER)-1,NETCONN_NOCOPY);
 				netconn_write(conn, main_js_start, main_js_len,NETCONN_NOCOPY);
 				netconn_close(conn);
@@ -134,7 +357,7 @@ static void http_server(struct netconn *conn) {
 			}
 
 			else if(strstr(buf,"GET /main.css ")) {
-				ESP_LOGI(TAG,"Sending /main.css");
+				ESP_LOGD(TAG,"Sending /main.css");
 				netconn_write(conn, CSS_HEADER, sizeof(CSS_HEADER)-1,NETCONN_NOCOPY);
 				netconn_write(conn, main_css_start, main_css_len,NETCONN_NOCOPY);
 				netconn_close(conn);
@@ -143,7 +366,7 @@ static void http_server(struct netconn *conn) {
 			}
 
 			else if(strstr(buf,"GET /favicon.ico ")) {
-				ESP_LOGI(TAG,"Sending favicon.ico");
+				ESP_LOGD(TAG,"Sending favicon.ico");
 				netconn_write(conn,ICO_HEADER,sizeof(ICO_HEADER)-1,NETCONN_NOCOPY);
 				netconn_write(conn,favicon_ico_start,favicon_ico_len,NETCONN_NOCOPY);
 				netconn_close(conn);
@@ -151,6 +374,50 @@ static void http_server(struct netconn *conn) {
 				netbuf_delete(inbuf);
 			}
 
+			else if(strstr(buf,"GET /stream.wav")) {
+				// ?source=proc selects the gain-adjusted samples, raw otherwise
+				const char* line_end = strstr(buf," HTTP/");
+				const char* proc = strstr(buf,"source=proc");
+				uint32_t stream = (proc && line_end && proc < line_end) ? AUDIO_STREAM_PROC : AUDIO_STREAM_RAW;
+				netbuf_delete(inbuf);
+				// the reader task owns the connection from here on
+				if(!wav_stream_start(conn, stream)) {
+					ESP_LOGW(TAG,"No free stream reader");
+					netconn_write(conn, BUSY_HEADER, sizeof(BUSY_HEADER)-1,NETCONN_NOCOPY);
+					netconn_close(conn);
+					netconn_delete(conn);
+				}
+			}
+
+#if CONFIG_FEATURE_LOG_ENABLE
+			else if(strstr(buf,"GET /features")) {
+				ESP_LOGI(TAG,"Sending /features");
+				send_feature_log(conn, buf);
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+#endif
+
+#if CONFIG_AUDIO_RECORDER_ENABLE
+			else if(strstr(buf,"GET /recorder.wav ")) {
+				ESP_LOGI(TAG,"Sending /recorder.wav");
+				send_recorder_clip(conn);
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+
+			else if(strstr(buf,"GET /recorder/trigger ")) {
+				ESP_LOGI(TAG,"Manual recorder trigger");
+				flight_recorder_trigger(RECORDER_CAUSE_MANUAL);
+				netconn_write(conn, ACCEPTED_HEADER, sizeof(ACCEPTED_HEADER)-1,NETCONN_NOCOPY);
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+#endif
+
 			else if(strstr(buf,"GET /")) {
 				ESP_LOGE(TAG,"Unknown request, sending error page: %s",buf);
 				netconn_write(conn, ERROR_HEADER, sizeof(ERROR_HEADER)-1,NETCONN_NOCOPY);
@@ -207,10 +474,12 @@ void server_task(void* pvParameters) {
 	client_queue = xQueueCreate(client_queue_size,sizeof(struct netconn*));
 	configASSERT( client_queue );
 
+	if(wav_stream_init() != ESP_OK) ESP_LOGE(TAG,"stream readers not started");
+
 	
 	UBaseType_t PriorityGet = uxTaskPriorityGet(NULL);
 	ESP_LOGI(TAG, "PriorityGet=%d", PriorityGet);
-	xTaskCreate(&server_handle_task, "server_handle_task", 1024*3, NULL, PriorityGet, NULL);
+	xTaskCreate(&server_handle_task, "server_handle_task", 1024*4, NULL, PriorityGet, NULL);
 
 
 	conn = netconn_new(NETCONN_TCP);
@@ -219,7 +488,6 @@ void server_task(void* pvParameters) {
 	ESP_LOGI(TAG,"server listening");
 	do {
 		err = netconn_accept(conn, &newconn);
-		ESP_LOGI(TAG,"new client");
 		if(err == ERR_OK) {
 			xQueueSendToBack(client_queue,&newconn,portMAX_DELAY);
 			//http_server(newconn);
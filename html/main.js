@@ -1,60 +1,472 @@
-const ws = new WebSocket("ws://" + location.hostname + "/");
-ws.binaryType = "arraybuffer";
+// Self-contained live view: no external libraries, so the dashboard works on
+// isolated networks. Frames are decoded with typed-array views over the
+// received ArrayBuffer and drawn to a canvas once per animation frame, no
+// matter how many WebSocket messages arrived in between.
 
-const inputTrace = { y: [], mode: "lines", name: "Input" };
-const outputTrace = { y: [], mode: "lines", name: "Output" };
+const HISTORY = 1 << 15;           // samples kept per trace (power of two)
+const SCENES = ["quiet", "speech", "noise"];
+const COLORS = { input: "#1f77b4", output: "#ff7f0e", envelope: "#2ca02c" };
 
-Plotly.newPlot("chart", [inputTrace, outputTrace], {
-  title: "Dmitri Lyalikov - Dynamic Audio Sensing - Audio Waveforms",
-  xaxis: { title: "Sample" },
-  yaxis: { title: "Amplitude" }
-});
+// URL options:
+//   ?worker              decode in a Web Worker instead of the main thread
+//   ?streams=a,b,...     raw, proc, features, spectrum, envelope, events
+//   ?divisor=N           only receive every Nth frame
+//   ?format=v1           request the legacy packed headers instead of v2
+const PARAMS = new URLSearchParams(location.search);
+const USE_WORKER = PARAMS.has("worker");
+const STREAMS = PARAMS.get("streams") || "raw,proc,features,spectrum,events";
+const DIVISOR = parseInt(PARAMS.get("divisor") || "1", 10);
+const FORMAT = PARAMS.get("format") || "v2";
 
-ws.onmessage = (evt) => {
-  if (!(evt.data instanceof ArrayBuffer)) {
-    console.warn("Non-binary frame ignored");
-    return;
-  }
+// Message decoding
+/*
+ * Messages are told apart by the uint32 magic in their first four bytes.
+ *
+ * "AUD0": legacy packed 21-byte header followed by two int16 blocks.
+ *  uint32 magic, uint32 N, f32 rms, f32 centroid, f32 gain, u8 scene
+ * "FEA0": the same 21-byte header, no payload.
+ * "PCM0": uint32 magic, uint32 N, u8 stream (0 raw, 1 proc), 3 pad, int16[N]
+ * "ENV0": uint32 magic, uint32 points, uint32 samples/point, int16[2*points]
+ * "SPC0": uint32 magic, uint32 bins, f32 bin_hz, f32 db_floor, f32 db_ceil,
+ *         uint8[bins]
+ * "DAS2": v2 frame message, 40-byte aligned header:
+ *         uint32 magic, u8 version, u8 kind, u8 encoding, u8 flags,
+ *         uint32 sequence, uint32 count, int64 timestamp_us,
+ *         uint64 sample_index, uint32 payload_len, f32 param
+ *         kind 0 features (f32 rms, centroid, gain; u32 scene; f32
+ *         bandwidth, rolloff, flatness, flux, band_db[5] - valid when
+ *         flags bit 2 is set),
+ *         1/2 raw/proc PCM, 3 envelope (param = samples/point),
+ *         4 spectrum (f32 db_floor, db_ceil, uint8[count]; param = bin Hz)
+ * "EVT0": uint32 magic, uint32 frame, int64 timestamp_us, u8 from, u8 to,
+ *         2 pad, f32 confidence, f32 mean_rms, f32 mean_centroid,
+ *         uint32 prev_duration_ms
+ *
+ * Kept free of outer references so it can be shipped to a worker verbatim.
+ */
+function decodeMessage(buf) {
+  const MAGIC_AUDIO = 0x41554430;
+  const MAGIC_FEATURES = 0x46454130;
+  const MAGIC_PCM = 0x50434D30;
+  const MAGIC_ENVELOPE = 0x454E5630;
+  const MAGIC_SPECTRUM = 0x53504330;
+  const MAGIC_EVENT = 0x45565430;
+  const MAGIC_V2 = 0x32534144;
+  const HEADER_AUDIO = 21;
+  const HEADER_PCM = 12;
+  const HEADER_ENVELOPE = 12;
+  const HEADER_SPECTRUM = 20;
+  const SIZE_EVENT = 36;
+  const HEADER_V2 = 40;
 
-  const buf = evt.data;
+  if (buf.byteLength < 4) return null;
   const dv = new DataView(buf);
-  let off = 0;
+  const magic = dv.getUint32(0, true);
+
+  const features = () => ({
+    n: dv.getUint32(4, true),
+    rms: dv.getFloat32(8, true),
+    centroid: dv.getFloat32(12, true),
+    gain: dv.getFloat32(16, true),
+    scene: dv.getUint8(20)
+  });
+
+  // v2: the aligned header allows zero-copy views for every payload
+  if (magic === MAGIC_V2 && buf.byteLength >= HEADER_V2) {
+    const kind = dv.getUint8(5);
+    const count = dv.getUint32(12, true);
+    if (buf.byteLength < HEADER_V2 + dv.getUint32(32, true)) return null;
+
+    const meta = {
+      seq: dv.getUint32(8, true),
+      flags: dv.getUint8(7),
+      timestampUs: Number(dv.getBigInt64(16, true)),
+      sampleIndex: Number(dv.getBigUint64(24, true))
+    };
+    const param = dv.getFloat32(36, true);
+
+    switch (kind) {
+      case 0: {
+        const fea = Object.assign(meta, {
+          kind: "features",
+          n: count,
+          rms: dv.getFloat32(HEADER_V2, true),
+          centroid: dv.getFloat32(HEADER_V2 + 4, true),
+          gain: dv.getFloat32(HEADER_V2 + 8, true),
+          scene: dv.getUint32(HEADER_V2 + 12, true)
+        });
+        // Older firmware sends only the first 16 bytes
+        if ((meta.flags & 4) && dv.getUint32(32, true) >= 52) {
+          const p = HEADER_V2 + 16;
+          fea.spectral = {
+            bandwidth: dv.getFloat32(p, true),
+            rolloff: dv.getFloat32(p + 4, true),
+            flatness: dv.getFloat32(p + 8, true),
+            flux: dv.getFloat32(p + 12, true),
+            bandDb: Array.from({ length: 5 }, (_, i) => dv.getFloat32(p + 16 + 4 * i, true))
+          };
+        }
+        return fea;
+      }
+      case 1:
+      case 2:
+        return Object.assign(meta, {
+          kind: "pcm",
+          stream: kind === 1 ? "input" : "output",
+          samples: new Int16Array(buf, HEADER_V2, count)
+        });
+      case 3:
+        return Object.assign(meta, {
+          kind: "envelope",
+          samplesPerPoint: param,
+          minmax: new Int16Array(buf, HEADER_V2, 2 * count)
+        });
+      case 4:
+        return Object.assign(meta, {
+          kind: "spectrum",
+          binHz: param,
+          dbFloor: dv.getFloat32(HEADER_V2, true),
+          dbCeil: dv.getFloat32(HEADER_V2 + 4, true),
+          bins: new Uint8Array(buf, HEADER_V2 + 8, count)
+        });
+    }
+    return null;
+  }
 
-  const magic =
-    String.fromCharCode(dv.getUint8(0)) +
-    String.fromCharCode(dv.getUint8(1)) +
-    String.fromCharCode(dv.getUint8(2)) +
-    String.fromCharCode(dv.getUint8(3));
-  off += 4;
+  if (magic === MAGIC_AUDIO && buf.byteLength >= HEADER_AUDIO) {
+    const n = dv.getUint32(4, true);
+    if (buf.byteLength < HEADER_AUDIO + 4 * n) return null;
 
-  if (magic !== "AUD0") {
-    console.warn("Invalid frame magic:", magic);
-    return;
+    // Int16Array views need an even byte offset; the legacy header leaves
+    // the payload odd-aligned, so fall back to one block copy instead of a
+    // per-sample loop.
+    const pcm = new Int16Array(buf.slice(HEADER_AUDIO, HEADER_AUDIO + 4 * n));
+
+    return Object.assign(features(), {
+      kind: "audio",
+      input: pcm.subarray(0, n),
+      output: pcm.subarray(n, 2 * n)
+    });
+  }
+
+  if (magic === MAGIC_FEATURES && buf.byteLength >= HEADER_AUDIO) {
+    return Object.assign(features(), { kind: "features" });
   }
 
-  const N = dv.getUint32(off, true); off += 4;
-  const rms = dv.getFloat32(off, true); off += 4;
-  const centroid = dv.getFloat32(off, true); off += 4;
-  const gain = dv.getFloat32(off, true); off += 4;
+  if (magic === MAGIC_PCM && buf.byteLength >= HEADER_PCM) {
+    const n = dv.getUint32(4, true);
+    if (buf.byteLength < HEADER_PCM + 2 * n) return null;
 
-  console.log(`Binary AUDIO: N=${N}, RMS=${rms.toFixed(3)}, C=${centroid.toFixed(1)}, Gain=${gain}`);
+    return {
+      kind: "pcm",
+      stream: dv.getUint8(8) === 0 ? "input" : "output",
+      samples: new Int16Array(buf, HEADER_PCM, n)      // zero-copy view
+    };
+  }
 
-  const input = new Int16Array(N);
-  const output = new Int16Array(N);
+  if (magic === MAGIC_ENVELOPE && buf.byteLength >= HEADER_ENVELOPE) {
+    const points = dv.getUint32(4, true);
+    if (buf.byteLength < HEADER_ENVELOPE + 4 * points) return null;
 
-  for (let i = 0; i < N; i++) {
-    input[i] = dv.getInt16(off, true);
-    off += 2;
+    return {
+      kind: "envelope",
+      samplesPerPoint: dv.getUint32(8, true),
+      minmax: new Int16Array(buf, HEADER_ENVELOPE, 2 * points)
+    };
   }
-  for (let i = 0; i < N; i++) {
-    output[i] = dv.getInt16(off, true);
-    off += 2;
+
+  if (magic === MAGIC_SPECTRUM && buf.byteLength >= HEADER_SPECTRUM) {
+    const bins = dv.getUint32(4, true);
+    if (buf.byteLength < HEADER_SPECTRUM + bins) return null;
+
+    return {
+      kind: "spectrum",
+      binHz: dv.getFloat32(8, true),
+      dbFloor: dv.getFloat32(12, true),
+      dbCeil: dv.getFloat32(16, true),
+      bins: new Uint8Array(buf, HEADER_SPECTRUM, bins)
+    };
   }
 
-  Plotly.update("chart", {
-    y: [Array.from(input), Array.from(output)]
-  });
+  if (magic === MAGIC_EVENT && buf.byteLength >= SIZE_EVENT) {
+    return {
+      kind: "event",
+      frame: dv.getUint32(4, true),
+      timestampUs: Number(dv.getBigInt64(8, true)),
+      from: dv.getUint8(16),
+      to: dv.getUint8(17),
+      confidence: dv.getFloat32(20, true),
+      meanRms: dv.getFloat32(24, true),
+      meanCentroid: dv.getFloat32(28, true),
+      prevDurationMs: dv.getUint32(32, true)
+    };
+  }
+
+  return null;
+}
+
+// Scrolling history ring
+class SampleRing {
+  constructor(size) {
+    this.buf = new Int16Array(size);
+    this.mask = size - 1;
+    this.head = 0;                 // next write position
+  }
+
+  push(src) {
+    const size = this.buf.length;
+    if (src.length >= size) {
+      this.buf.set(src.subarray(src.length - size));
+      this.head = 0;
+      return;
+    }
+    const first = Math.min(src.length, size - this.head);
+    this.buf.set(src.subarray(0, first), this.head);
+    this.buf.set(src.subarray(first), 0);
+    this.head = (this.head + src.length) & this.mask;
+  }
+}
+
+// The envelope gets its own ring: its min/max pairs are not PCM and would
+// interleave with proc samples if both streams are subscribed
+const rings = {
+  input: new SampleRing(HISTORY),
+  output: new SampleRing(HISTORY),
+  envelope: new SampleRing(HISTORY)
+};
+
+// Canvas renderer
+const canvas = document.getElementById("scope");
+const ctx = canvas.getContext("2d", { alpha: false });
+const statsEl = document.getElementById("stats");
+
+const waterfall = document.getElementById("waterfall");
+const wfLabel = document.getElementById("waterfall-label");
+const wctx = waterfall.getContext("2d", { alpha: false });
+const WATERFALL_ROWS = 256;
+const pendingRows = [];
+
+// 256-entry colour map (black -> blue -> red -> yellow -> white), packed
+// as little-endian RGBA so rows can be written through a Uint32Array.
+const COLORMAP = (() => {
+  const stops = [[0, 0, 0], [0, 0, 160], [200, 0, 60], [255, 200, 0], [255, 255, 255]];
+  const lut = new Uint32Array(256);
+  for (let i = 0; i < 256; i++) {
+    const t = i / 255 * (stops.length - 1);
+    const k = Math.min(stops.length - 2, Math.floor(t));
+    const f = t - k;
+    const c = stops[k].map((v, j) => Math.round(v + (stops[k + 1][j] - v) * f));
+    lut[i] = (255 << 24) | (c[2] << 16) | (c[1] << 8) | c[0];
+  }
+  return lut;
+})();
+
+const eventsEl = document.getElementById("events");
+const MAX_EVENTS = 50;
+
+const stats = {
+  frames: 0, fps: 0, last: null, windowStart: performance.now(), windowFrames: 0,
+  lastSeq: null, dropped: 0, spectral: null
 };
+let dirty = false;
+
+function resizeCanvas() {
+  const dpr = window.devicePixelRatio || 1;
+  canvas.width = Math.max(1, Math.floor(canvas.clientWidth * dpr));
+  canvas.height = Math.max(1, Math.floor(canvas.clientHeight * dpr));
+  dirty = true;
+}
+
+// Draws a min/max envelope per pixel column so cost is bounded by HISTORY,
+// independent of the incoming frame rate.
+function drawTrace(ring, color, width, height) {
+  const buf = ring.buf;
+  const perCol = HISTORY / width;
+  const mid = height / 2;
+  const scale = -mid / 32768;
+
+  ctx.beginPath();
+  for (let x = 0; x < width; x++) {
+    let i = (ring.head + Math.floor(x * perCol)) & ring.mask;
+    const end = Math.max(1, Math.floor((x + 1) * perCol) - Math.floor(x * perCol));
+    let lo = 32767;
+    let hi = -32768;
+    for (let k = 0; k < end; k++) {
+      const v = buf[i];
+      if (v < lo) lo = v;
+      if (v > hi) hi = v;
+      i = (i + 1) & ring.mask;
+    }
+    ctx.moveTo(x + 0.5, mid + hi * scale);
+    ctx.lineTo(x + 0.5, mid + lo * scale + 1);
+  }
+  ctx.strokeStyle = color;
+  ctx.stroke();
+}
+
+// Scrolls the waterfall up by the number of rows received since the last
+// animation frame and paints them at the bottom.
+function drawWaterfall() {
+  if (pendingRows.length === 0) return;
+
+  const bins = pendingRows[pendingRows.length - 1].length;
+  if (waterfall.width !== bins) {
+    waterfall.width = bins;
+    waterfall.height = WATERFALL_ROWS;
+  }
+
+  const rows = pendingRows.splice(0).filter(r => r.length === bins).slice(-WATERFALL_ROWS);
+  wctx.drawImage(waterfall, 0, -rows.length);
+
+  const img = wctx.createImageData(bins, rows.length);
+  const px = new Uint32Array(img.data.buffer);
+  rows.forEach((row, y) => {
+    for (let x = 0; x < bins; x++) px[y * bins + x] = COLORMAP[row[x]];
+  });
+  wctx.putImageData(img, 0, WATERFALL_ROWS - rows.length);
+}
+
+function render() {
+  requestAnimationFrame(render);
+  drawWaterfall();
+  if (!dirty) return;
+  dirty = false;
+
+  const w = canvas.width;
+  const h = canvas.height;
+  ctx.fillStyle = "#ffffff";
+  ctx.fillRect(0, 0, w, h);
+  ctx.lineWidth = 1;
+  drawTrace(rings.input, COLORS.input, w, h);
+  drawTrace(rings.output, COLORS.output, w, h);
+  drawTrace(rings.envelope, COLORS.envelope, w, h);
+
+  const f = stats.last;
+  const s = stats.spectral;   // last frame that ran the FFT
+  if (f) {
+    statsEl.textContent =
+      `scene=${SCENES[f.scene] || f.scene}  rms=${f.rms.toFixed(3)}  ` +
+      `centroid=${f.centroid.toFixed(1)} Hz  gain=${f.gain.toFixed(2)}  ` +
+      (s ? `rolloff=${s.rolloff.toFixed(0)} Hz  flatness=${s.flatness.toFixed(2)}  ` +
+           `flux=${s.flux.toFixed(2)}  ` : "") +
+      `N=${f.n}  ${stats.fps.toFixed(1)} frames/s` +
+      (stats.lastSeq !== null ? `  seq=${stats.lastSeq}  dropped=${stats.dropped}` : "");
+  }
+}
+
+function onSpectrum(spec) {
+  pendingRows.push(spec.bins);
+  wfLabel.textContent =
+    `Spectrum 0 - ${(spec.bins.length * spec.binHz / 1000).toFixed(1)} kHz, ` +
+    `${spec.dbFloor} to ${spec.dbCeil} dBFS`;
+}
+
+function onSceneEvent(ev) {
+  const li = document.createElement("li");
+  li.textContent =
+    `${(ev.timestampUs / 1e6).toFixed(2)} s  ` +
+    `${SCENES[ev.from] || ev.from} -> ${SCENES[ev.to] || ev.to}  ` +
+    `conf=${ev.confidence.toFixed(2)}  rms=${ev.meanRms.toFixed(3)}  ` +
+    `centroid=${ev.meanCentroid.toFixed(0)} Hz  ` +
+    `after ${(ev.prevDurationMs / 1000).toFixed(1)} s`;
+  eventsEl.prepend(li);
+  while (eventsEl.children.length > MAX_EVENTS) eventsEl.lastChild.remove();
+}
+
+function onFeatures(frame) {
+  stats.frames++;
+  stats.windowFrames++;
+  stats.last = frame;
+  if (frame.spectral) stats.spectral = frame.spectral;
+  const now = performance.now();
+  if (now - stats.windowStart >= 1000) {
+    stats.fps = stats.windowFrames * 1000 / (now - stats.windowStart);
+    stats.windowStart = now;
+    stats.windowFrames = 0;
+  }
+  dirty = true;
+}
+
+// v2 messages of one frame share a sequence number; a jump larger than the
+// divisor means frames were dropped on the device or in transit.
+function trackSequence(seq) {
+  if (stats.lastSeq !== null && seq !== stats.lastSeq) {
+    const gap = (seq - stats.lastSeq) >>> 0;
+    if (gap > DIVISOR && gap < 0x80000000) stats.dropped += gap - DIVISOR;
+  }
+  stats.lastSeq = seq;
+}
+
+function dispatch(msg) {
+  if (!msg) return;
+  if (msg.seq !== undefined) trackSequence(msg.seq);
+  switch (msg.kind) {
+    case "audio":
+      rings.input.push(msg.input);
+      rings.output.push(msg.output);
+      onFeatures(msg);
+      break;
+    case "features":
+      onFeatures(msg);
+      break;
+    case "pcm":
+      rings[msg.stream].push(msg.samples);
+      dirty = true;
+      break;
+    case "envelope":
+      // {min, max} pairs keep their extremes through the column renderer
+      rings.envelope.push(msg.minmax);
+      dirty = true;
+      break;
+    case "spectrum":
+      onSpectrum(msg);
+      break;
+    case "event":
+      onSceneEvent(msg);
+      break;
+  }
+}
+
+// Optional worker decoding
+function startDecoder() {
+  if (!USE_WORKER || typeof Worker === "undefined") {
+    return (buf) => dispatch(decodeMessage(buf));
+  }
+
+  const src =
+    decodeMessage.toString() + "\n" +
+    "onmessage = (e) => {\n" +
+    "  const m = decodeMessage(e.data);\n" +
+    "  if (!m) return;\n" +
+    "  const t = m.input || m.samples || m.minmax || m.bins;\n" +
+    "  postMessage(m, t ? [t.buffer] : []);\n" +
+    "};\n";
+  const worker = new Worker(URL.createObjectURL(new Blob([src], { type: "text/javascript" })));
+  worker.onmessage = (e) => dispatch(e.data);
+  return (buf) => worker.postMessage(buf, [buf]);
+}
+
+// WebSocket
+const decode = startDecoder();
+
+function connect() {
+  const ws = new WebSocket("ws://" + location.hostname + "/");
+  ws.binaryType = "arraybuffer";
+
+  ws.onmessage = (evt) => {
+    if (evt.data instanceof ArrayBuffer) decode(evt.data);
+    else console.log("control:", evt.data);
+  };
+  ws.onopen = () => {
+    console.log("WebSocket connected");
+    stats.lastSeq = null;
+    ws.send(`subscribe ${STREAMS} ${DIVISOR} ${FORMAT}`);
+  };
+  ws.onerror = e => console.error("WS error", e);
+  ws.onclose = () => setTimeout(connect, 1000);
+}
 
-ws.onopen = () => console.log("WebSocket connected");
-ws.onerror = e => console.error("WS error", e);
+window.addEventListener("resize", resizeCanvas);
+resizeCanvas();
+requestAnimationFrame(render);
+connect();
@@ -25,18 +25,20 @@
 #include "web_server.h"
 #include "web_client.h"
 #include "audio_frame.h"
+#include "sample_process.h"
+#include "scene_detector.h"
 #include "websocket_server.h"
+#include "power_manager.h"
+#include "rtp_sink.h"
+#include "feature_log.h"
 
 // Globals                       
 
 static const char *TAG = "main";
 
-// Shared queue: DSP -> transport 
+// Shared queues: DSP -> transport 
 QueueHandle_t audio_frame_queue;
-
-
-// Forward declarations
-void sample_process_task(void *pvParameters);
+QueueHandle_t scene_event_queue;
 
 // Init helpers
 static esp_err_t init_nvs(void)
@@ -76,10 +78,29 @@ void app_main(void)
     // 3. Initialize mDNS
     init_mdns();
 
+    // DFS + light sleep; WiFi modem sleep until a client subscribes
+    power_manager_init();
+
     // 4. Create audio frame queue (DSP -> Web)
-    audio_frame_queue = xQueueCreate(4, sizeof(audio_frame_t *));
+    audio_frame_queue = xQueueCreate(CONFIG_AUDIO_FRAME_QUEUE_LEN, sizeof(audio_frame_t *));
     configASSERT(audio_frame_queue);
 
+    // Scene transitions travel separately so frame drops never lose them
+    scene_event_queue = xQueueCreate(CONFIG_SCENE_EVENT_QUEUE_LEN, sizeof(scene_event_t));
+    configASSERT(scene_event_queue);
+
+    // Feature history in flash; the writer runs on core 0
+    esp_err_t log_err = feature_log_init();
+    if (log_err != ESP_OK && log_err != ESP_ERR_NOT_SUPPORTED) {
+        ESP_LOGW(TAG, "Feature log disabled: %s", esp_err_to_name(log_err));
+    }
+
+    // Optional RTP sink; registers with the pipeline before it starts
+    esp_err_t rtp_err = rtp_sink_start();
+    if (rtp_err != ESP_OK && rtp_err != ESP_ERR_NOT_SUPPORTED) {
+        ESP_LOGW(TAG, "RTP sink not started: %s", esp_err_to_name(rtp_err));
+    }
+
     // 5. Start WebSocket server core
     ws_server_start();
 
@@ -100,24 +121,27 @@ void app_main(void)
         ESP_LOGI(TAG, "ESP32 IP Address: " IPSTR, IP2STR(&ip_info.ip));
     }
 
-    // 8. Start audio processing task (mic + DSP + classification)
-    xTaskCreate(
+    // 8. Start audio processing task (mic + DSP + classification),
+    //    on the core WiFi and the flash writers do not use
+    xTaskCreatePinnedToCore(
         sample_process_task,
         "sample_process",
         8192,
         NULL,
         6,     // higher priority (real-time)
-        NULL
+        NULL,
+        portNUM_PROCESSORS - 1
     );
 
     // 9. Start WebSocket client task (transport only)
-    xTaskCreate(
+    xTaskCreatePinnedToCore(
         web_client_task,
         "web_client",
         4096,
         NULL,
         5,
-        NULL
+        NULL,
+        SAMPLE_PROCESS_SINK_CORE(CONFIG_WEB_CLIENT_TASK_CORE)
     );
 
     ESP_LOGI(TAG, "System initialization complete.");
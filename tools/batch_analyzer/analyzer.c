@@ -0,0 +1,124 @@
+/**
+ * @file analyzer.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements the host copy of the device's per-frame analysis path
+ *        shared by the batch analyzer and the golden-vector harness.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "analyzer.h"
+
+// Same zero-crossing gate as sample_process.c
+#define ZCR_GATE_MARGIN     2.0f
+#define ZCR_GATE_MIN_HZ     (SCENE_CENTROID_MIN / ZCR_GATE_MARGIN)
+#define ZCR_GATE_MAX_HZ     (SCENE_CENTROID_MAX * ZCR_GATE_MARGIN)
+
+// Input conditioning as built by sample_process.c from the same Kconfig values
+void analyzer_init(analyzer_t *a)
+{
+#if CONFIG_AUDIO_FILTER_ENABLE
+    biquad_chain_init(&a->filter, FEATURE_RATE);
+    if (CONFIG_AUDIO_FILTER_HPF_HZ > 0) {
+        biquad_chain_add_highpass(&a->filter, CONFIG_AUDIO_FILTER_HPF_HZ,
+                                  (CONFIG_AUDIO_FILTER_HPF_ORDER + 1) & ~1);
+    }
+    if (CONFIG_AUDIO_FILTER_NOTCH_HZ > 0) {
+        biquad_chain_add(&a->filter, BIQUAD_NOTCH, CONFIG_AUDIO_FILTER_NOTCH_HZ,
+                         CONFIG_AUDIO_FILTER_NOTCH_Q_X10 / 10.0f);
+    }
+    if (CONFIG_AUDIO_FILTER_BANDPASS_HZ > 0) {
+        biquad_chain_add(&a->filter, BIQUAD_BANDPASS, CONFIG_AUDIO_FILTER_BANDPASS_HZ,
+                         CONFIG_AUDIO_FILTER_BANDPASS_Q_X100 / 100.0f);
+    }
+#endif
+#if DECIMATION > 1
+    fir_decimator_init(&a->decimator, DECIMATION, SAMPLE_COUNT);
+#endif
+    scene_detector_config_t cfg;
+    scene_detector_default_config(&cfg, SAMPLE_RATE, SAMPLE_COUNT);
+    scene_detector_init(&a->detector, &cfg, SAMPLE_RATE, SAMPLE_COUNT);
+#if CONFIG_AUDIO_SPECTRAL_FEATURES
+    a->spectral_state.valid = false;
+#endif
+}
+
+void analyzer_deinit(analyzer_t *a)
+{
+#if DECIMATION > 1
+    fir_decimator_deinit(&a->decimator);
+#endif
+}
+
+void analyze_frame(analyzer_t *a, int64_t timestamp_us, int all_features,
+                   frame_record_t *rec)
+{
+#if DECIMATION > 1
+    fir_decimator_process(&a->decimator, a->raw, a->feat);
+    int32_t *feat = a->feat;
+#else
+    int32_t *feat = a->raw;
+#endif
+#if CONFIG_AUDIO_FILTER_ENABLE
+    biquad_chain_process(&a->filter, feat, FEATURE_COUNT);
+#endif
+
+#if CONFIG_DSP_FIXED_POINT
+    float rms = dsp_compute_rms_q31(feat, FEATURE_COUNT);
+#else
+    float rms = dsp_compute_rms(feat, FEATURE_COUNT);
+#endif
+
+    bool need_fft = scene_detector_needs_centroid(&a->detector, rms);
+#if CONFIG_AUDIO_CASCADE_ZCR_GATE
+    if (need_fft) {
+        float zcr_hz = dsp_compute_zcr(feat, FEATURE_COUNT) * FEATURE_RATE / 2;
+        if (zcr_hz < ZCR_GATE_MIN_HZ || zcr_hz > ZCR_GATE_MAX_HZ) {
+            need_fft = false;
+        }
+    }
+#endif
+
+    float centroid = NAN;
+    uint8_t flags = 0;
+    memset(&rec->spectral, 0, sizeof(rec->spectral));
+
+    if (need_fft || all_features) {
+        if (rms > 1e-6f) {
+#if CONFIG_DSP_FIXED_POINT
+            centroid = dsp_compute_spectral_centroid_sc16(feat, FEATURE_COUNT, FEATURE_RATE, &a->fft_scratch, NULL);
+#elif CONFIG_AUDIO_SPECTRAL_FEATURES
+            centroid = 0.0f;
+            if (dsp_compute_spectral_features_fft(feat, FEATURE_COUNT, FEATURE_RATE,
+                                                  &a->fft_scratch, NULL,
+                                                  &a->spectral_state, &rec->spectral)) {
+                centroid = rec->spectral.centroid_hz;
+                flags |= AUDIO_FRAME_FLAG_SPECTRAL;
+            }
+#else
+            centroid = dsp_compute_spectral_centroid_fft(feat, FEATURE_COUNT, FEATURE_RATE, &a->fft_scratch, NULL);
+#endif
+        } else {
+            centroid = 0.0f;
+        }
+    }
+#if CONFIG_AUDIO_SPECTRAL_FEATURES
+    if (!(flags & AUDIO_FRAME_FLAG_SPECTRAL)) {
+        a->spectral_state.valid = false;
+    }
+#endif
+
+    scene_event_t event;
+    if (scene_detector_update(&a->detector, rms, centroid, timestamp_us, &event)) {
+        flags |= AUDIO_FRAME_FLAG_SCENE_CHANGE;
+    }
+
+    rec->rms      = rms;
+    rec->centroid = isnan(centroid) ? 0.0f : centroid;
+    rec->scene    = (uint8_t)a->detector.scene;
+    rec->flags    = flags;
+}
+
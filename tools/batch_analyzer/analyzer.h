@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "sdkconfig.h"
+#include "audio_frame.h"
+#include "dsp_features.h"
+#include "dsp_fixed.h"
+#include "biquad_chain.h"
+#include "fir_decimator.h"
+#include "scene_detector.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The device's per-frame analysis path on the host: feature decimation,
+ * input filter, RMS, the RMS / ZCR cascade, the FFT features and the scene
+ * detector, built from the same sources and sdkconfig as sample_process.c.
+ */
+
+// Same frame geometry as sample_process.c
+#define SAMPLE_RATE     AUDIO_FRAME_SAMPLE_RATE
+#define SAMPLE_COUNT    AUDIO_FRAME_MAX_SAMPLES
+#define DECIMATION      AUDIO_FEATURE_DECIMATION
+#define FEATURE_RATE    AUDIO_FEATURE_SAMPLE_RATE
+#define FEATURE_COUNT   AUDIO_FEATURE_FRAME_SAMPLES
+
+typedef struct {
+    float rms;
+    float centroid;             // 0 = not computed, as in audio_frame_t
+    dsp_spectral_features_t spectral;
+    uint8_t scene;
+    uint8_t flags;              // AUDIO_FRAME_FLAG_SCENE_CHANGE / _SPECTRAL
+} frame_record_t;
+
+typedef struct {
+#if CONFIG_AUDIO_FILTER_ENABLE
+    biquad_chain_t filter;
+#endif
+#if DECIMATION > 1
+    fir_decimator_t decimator;
+    int32_t feat[FEATURE_COUNT];
+#endif
+    int32_t raw[SAMPLE_COUNT];
+    scene_detector_t detector;
+    dsp_fft_scratch_t fft_scratch;      // one per analyzer, so workers never share it
+#if CONFIG_AUDIO_SPECTRAL_FEATURES
+    dsp_spectral_state_t spectral_state;
+#endif
+} analyzer_t;
+
+void analyzer_init(analyzer_t *a);
+void analyzer_deinit(analyzer_t *a);
+
+/*
+ * Run the block in a->raw through the device's stages; without decimation
+ * a->raw is the feature block and is filtered in place. With all_features the FFT runs on every frame instead of only
+ * when the cascade needs the centroid; the labels do not change (except
+ * under the approximate ZCR gate).
+ */
+void analyze_frame(analyzer_t *a, int64_t timestamp_us, int all_features,
+                   frame_record_t *rec);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,408 @@
+/**
+ * @file batch_analyzer.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Host CLI that runs the device's feature extraction and scene
+ *        detector over archived WAV recordings on all cores, faster than
+ *        real time, and writes per-frame features as CSV or columnar binary.
+ * @version 0.1
+ * @date 2025-12-15
+ *
+ * Each frame goes through the same sources and the same sdkconfig as on the
+ * device: feature decimation, input filter, RMS, the RMS / ZCR cascade, the
+ * FFT features and the debounced scene detector.
+ *
+ * Work is split into units (a whole file, or with -c a chunk of one) that
+ * worker threads take longest first from a shared counter, so a few long
+ * recordings do not leave the other cores idle at the end. A chunk first
+ * runs -w seconds of the preceding audio to settle the filter, the
+ * decimator history and the scene detector, without emitting it.
+ *
+ * Binary output (-f bin), little-endian:
+ *   header  "DASB", u32 version (1), u32 sample_rate, u32 frame_samples,
+ *           u32 file_count, then per input file u32 length + path bytes
+ *   blocks  "DBLK", u32 file_index, u32 count, u64 first_frame, then one
+ *           column of `count` entries per field: f32 rms, centroid_hz,
+ *           bandwidth_hz, rolloff_hz, flatness, flux, band_db[0..4];
+ *           u8 scene, u8 flags
+ * Blocks arrive in completion order; rows within a block are consecutive.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "analyzer.h"
+#include "wav_reader.h"
+
+#define BIN_VERSION         1
+#define DEFAULT_WARMUP_S    10.0
+
+typedef struct {
+    const char *path;
+    uint64_t frames;
+    int ok;
+} input_file_t;
+
+typedef struct {
+    int file;
+    uint64_t first;             // first emitted frame
+    uint64_t count;             // emitted frames
+    uint64_t warmup;            // frames run before `first` and not emitted
+} work_unit_t;
+
+typedef struct {
+    input_file_t *files;
+    work_unit_t *units;
+    size_t unit_count;
+    atomic_size_t next_unit;
+    atomic_uint_fast64_t frames_done;
+    atomic_int failures;
+    int binary;
+    int all_features;
+    FILE *out;
+    pthread_mutex_t out_lock;
+} batch_t;
+
+// Output buffer of one unit, written under the output lock in one go
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} buffer_t;
+
+static const char *SCENE_NAMES[] = { "quiet", "speech", "noise" };
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int buffer_reserve(buffer_t *b, size_t extra)
+{
+    if (b->len + extra <= b->cap) return 0;
+    size_t cap = b->cap ? b->cap : 65536;
+    while (cap < b->len + extra) cap *= 2;
+    char *p = realloc(b->data, cap);
+    if (!p) return -1;
+    b->data = p;
+    b->cap = cap;
+    return 0;
+}
+
+static int buffer_append(buffer_t *b, const void *data, size_t len)
+{
+    if (buffer_reserve(b, len) != 0) return -1;
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    return 0;
+}
+
+static int emit_csv(buffer_t *b, int file, uint64_t frame, const frame_record_t *r)
+{
+    if (buffer_reserve(b, 256) != 0) return -1;
+    const double t = (double)frame * SAMPLE_COUNT / SAMPLE_RATE;
+    int n = snprintf(b->data + b->len, b->cap - b->len,
+                     "%d,%llu,%.3f,%.6g,%.1f,%.1f,%.1f,%.4f,%.4f,%.1f,%.1f,%.1f,%.1f,%.1f,%s,%u\n",
+                     file, (unsigned long long)frame, t, r->rms, r->centroid,
+                     r->spectral.bandwidth_hz, r->spectral.rolloff_hz,
+                     r->spectral.flatness, r->spectral.flux,
+                     r->spectral.band_db[0], r->spectral.band_db[1], r->spectral.band_db[2],
+                     r->spectral.band_db[3], r->spectral.band_db[4],
+                     SCENE_NAMES[r->scene], (unsigned)r->flags);
+    b->len += (size_t)n;
+    return 0;
+}
+
+// Transpose a unit's records into one DBLK block
+static int emit_block(buffer_t *b, int file, uint64_t first, const frame_record_t *r, uint32_t count)
+{
+    const uint32_t index = (uint32_t)file;
+    if (buffer_append(b, "DBLK", 4) || buffer_append(b, &index, 4) ||
+        buffer_append(b, &count, 4) || buffer_append(b, &first, 8)) {
+        return -1;
+    }
+
+#define COLUMN(type, expr)                                              \
+    do {                                                                \
+        if (buffer_reserve(b, (size_t)count * sizeof(type))) return -1; \
+        type *col = (type *)(b->data + b->len);                         \
+        for (uint32_t i = 0; i < count; i++) col[i] = (type)(expr);     \
+        b->len += (size_t)count * sizeof(type);                         \
+    } while (0)
+
+    COLUMN(float, r[i].rms);
+    COLUMN(float, r[i].centroid);
+    COLUMN(float, r[i].spectral.bandwidth_hz);
+    COLUMN(float, r[i].spectral.rolloff_hz);
+    COLUMN(float, r[i].spectral.flatness);
+    COLUMN(float, r[i].spectral.flux);
+    for (int k = 0; k < DSP_SPECTRAL_BANDS; k++) {
+        COLUMN(float, r[i].spectral.band_db[k]);
+    }
+    COLUMN(uint8_t, r[i].scene);
+    COLUMN(uint8_t, r[i].flags);
+#undef COLUMN
+    return 0;
+}
+
+static int run_unit(batch_t *batch, const work_unit_t *u)
+{
+    const input_file_t *f = &batch->files[u->file];
+    char err[96];
+    wav_reader_t wav;
+    if (wav_reader_open(&wav, f->path, err, sizeof(err)) != 0) {
+        fprintf(stderr, "%s: %s\n", f->path, err);
+        return -1;
+    }
+
+    analyzer_t *a = calloc(1, sizeof(*a));
+    frame_record_t *records = malloc(u->count * sizeof(*records));
+    buffer_t out = { 0 };
+    int rc = -1;
+    if (!a || !records) goto done;
+
+    analyzer_init(a);
+    const uint64_t start = u->first - u->warmup;
+    wav_reader_seek(&wav, start * SAMPLE_COUNT);
+
+    uint64_t emitted = 0;
+    for (uint64_t frame = start; frame < u->first + u->count; frame++) {
+        if (wav_reader_read(&wav, a->raw, SAMPLE_COUNT) != SAMPLE_COUNT) break;
+
+        const int64_t ts = (int64_t)(frame * SAMPLE_COUNT * 1000000ULL / SAMPLE_RATE);
+        frame_record_t rec;
+        analyze_frame(a, ts, batch->all_features, &rec);
+        if (frame >= u->first) {
+            records[emitted++] = rec;
+        }
+    }
+
+    if (batch->binary) {
+        if (emit_block(&out, u->file, u->first, records, (uint32_t)emitted)) goto done;
+    } else {
+        for (uint64_t i = 0; i < emitted; i++) {
+            if (emit_csv(&out, u->file, u->first + i, &records[i])) goto done;
+        }
+    }
+
+    pthread_mutex_lock(&batch->out_lock);
+    size_t written = fwrite(out.data, 1, out.len, batch->out);
+    pthread_mutex_unlock(&batch->out_lock);
+    if (written != out.len) goto done;
+
+    atomic_fetch_add(&batch->frames_done, emitted);
+    rc = 0;
+
+done:
+    if (rc != 0 && a && records) {
+        fprintf(stderr, "%s: out of memory or write error\n", f->path);
+    }
+    if (a) analyzer_deinit(a);
+    free(a);
+    free(records);
+    free(out.data);
+    wav_reader_close(&wav);
+    return rc;
+}
+
+static void *worker(void *arg)
+{
+    batch_t *batch = arg;
+    size_t i;
+    while ((i = atomic_fetch_add(&batch->next_unit, 1)) < batch->unit_count) {
+        if (run_unit(batch, &batch->units[i]) != 0) {
+            atomic_fetch_add(&batch->failures, 1);
+        }
+    }
+    return NULL;
+}
+
+static int compare_units(const void *x, const void *y)
+{
+    const work_unit_t *a = x;
+    const work_unit_t *b = y;
+    uint64_t wa = a->count + a->warmup;
+    uint64_t wb = b->count + b->warmup;
+    return (wa < wb) - (wa > wb);     // longest first
+}
+
+// Paths from a list file, one per line
+static int read_list(const char *list, const char ***paths, int *count)
+{
+    FILE *fp = fopen(list, "r");
+    if (!fp) return -1;
+
+    char line[4096];
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!line[0]) continue;
+        const char **p = realloc(*paths, (*count + 1) * sizeof(**paths));
+        if (!p) break;
+        *paths = p;
+        (*paths)[(*count)++] = strdup(line);
+    }
+    fclose(fp);
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [options] file.wav ...\n"
+        "  -j N      worker threads (default: all cores)\n"
+        "  -o PATH   output file (default: stdout)\n"
+        "  -f FMT    csv (default) or bin\n"
+        "  -c SEC    split files into chunks of SEC seconds (default: whole files)\n"
+        "  -w SEC    warm-up audio run before each chunk (default %.0f)\n"
+        "  -a        FFT features on every frame, not only where the cascade needs them\n"
+        "  -l LIST   read input paths from LIST, one per line\n"
+        "Input: %d Hz WAV (first channel), as configured in sdkconfig\n",
+        prog, DEFAULT_WARMUP_S, SAMPLE_RATE);
+}
+
+int main(int argc, char **argv)
+{
+    batch_t batch = { 0 };
+    int threads = 0;
+    const char *out_path = NULL;
+    double chunk_s = 0.0;
+    double warmup_s = DEFAULT_WARMUP_S;
+    const char **paths = NULL;
+    int path_count = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "j:o:f:c:w:al:h")) != -1) {
+        switch (opt) {
+        case 'j': threads = atoi(optarg); break;
+        case 'o': out_path = optarg; break;
+        case 'f':
+            if (strcmp(optarg, "bin") == 0) batch.binary = 1;
+            else if (strcmp(optarg, "csv") != 0) { usage(argv[0]); return 1; }
+            break;
+        case 'c': chunk_s = atof(optarg); break;
+        case 'w': warmup_s = atof(optarg); break;
+        case 'a': batch.all_features = 1; break;
+        case 'l':
+            if (read_list(optarg, &paths, &path_count) != 0) {
+                fprintf(stderr, "%s: cannot read list\n", optarg);
+                return 1;
+            }
+            break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    for (int i = optind; i < argc; i++) {
+        const char **p = realloc(paths, (path_count + 1) * sizeof(*paths));
+        if (!p) return 1;
+        paths = p;
+        paths[path_count++] = argv[i];
+    }
+    if (path_count == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (threads <= 0) {
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (threads <= 0) threads = 1;
+    }
+
+    const double frame_s = (double)SAMPLE_COUNT / SAMPLE_RATE;
+    const uint64_t chunk_frames = chunk_s > 0.0 ? (uint64_t)ceil(chunk_s / frame_s) : 0;
+    const uint64_t warmup_frames = (uint64_t)ceil(warmup_s / frame_s);
+
+    // Probe headers and cut the work into units
+    batch.files = calloc(path_count, sizeof(*batch.files));
+    if (!batch.files) return 1;
+    int bad_inputs = 0;
+    for (int i = 0; i < path_count; i++) {
+        input_file_t *f = &batch.files[i];
+        f->path = paths[i];
+
+        char err[96];
+        wav_reader_t wav;
+        if (wav_reader_open(&wav, f->path, err, sizeof(err)) != 0) {
+            fprintf(stderr, "%s: %s, skipped\n", f->path, err);
+            bad_inputs++;
+            continue;
+        }
+        if (wav.sample_rate != SAMPLE_RATE) {
+            fprintf(stderr, "%s: %u Hz, expected %d Hz, skipped\n",
+                    f->path, (unsigned)wav.sample_rate, SAMPLE_RATE);
+            wav_reader_close(&wav);
+            bad_inputs++;
+            continue;
+        }
+        f->frames = wav.samples / SAMPLE_COUNT;
+        f->ok = 1;
+        wav_reader_close(&wav);
+
+        uint64_t step = chunk_frames ? chunk_frames : (f->frames ? f->frames : 1);
+        for (uint64_t first = 0; first < f->frames; first += step) {
+            work_unit_t *u = realloc(batch.units, (batch.unit_count + 1) * sizeof(*u));
+            if (!u) return 1;
+            batch.units = u;
+            u += batch.unit_count++;
+            u->file   = i;
+            u->first  = first;
+            u->count  = (f->frames - first < step) ? f->frames - first : step;
+            u->warmup = first < warmup_frames ? first : warmup_frames;
+        }
+    }
+    qsort(batch.units, batch.unit_count, sizeof(*batch.units), compare_units);
+
+    batch.out = out_path ? fopen(out_path, "wb") : stdout;
+    if (!batch.out) {
+        fprintf(stderr, "%s: cannot create\n", out_path);
+        return 1;
+    }
+    pthread_mutex_init(&batch.out_lock, NULL);
+
+    if (batch.binary) {
+        const uint32_t hdr[4] = { BIN_VERSION, SAMPLE_RATE, SAMPLE_COUNT, (uint32_t)path_count };
+        fwrite("DASB", 1, 4, batch.out);
+        fwrite(hdr, sizeof(hdr[0]), 4, batch.out);
+        for (int i = 0; i < path_count; i++) {
+            uint32_t len = (uint32_t)strlen(paths[i]);
+            fwrite(&len, sizeof(len), 1, batch.out);
+            fwrite(paths[i], 1, len, batch.out);
+        }
+    } else {
+        fprintf(batch.out, "# files:");
+        for (int i = 0; i < path_count; i++) {
+            fprintf(batch.out, " %d=%s", i, paths[i]);
+        }
+        fprintf(batch.out, "\nfile,frame,time_s,rms,centroid_hz,bandwidth_hz,rolloff_hz,flatness,flux,"
+                           "band0_db,band1_db,band2_db,band3_db,band4_db,scene,flags\n");
+    }
+
+    const double t0 = now_s();
+    pthread_t *tids = calloc(threads, sizeof(*tids));
+    if (!tids) return 1;
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&tids[i], NULL, worker, &batch);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    const double wall_s = now_s() - t0;
+
+    if (batch.out != stdout) fclose(batch.out);
+
+    const double audio_h = atomic_load(&batch.frames_done) * frame_s / 3600.0;
+    fprintf(stderr, "%d files (%d skipped), %zu units, %d threads: %.2f h of audio in %.2f s, "
+                    "%.3f audio-hours per wall-second (%.0fx real time)\n",
+            path_count, bad_inputs, batch.unit_count, threads, audio_h, wall_s,
+            wall_s > 0 ? audio_h / wall_s : 0.0,
+            wall_s > 0 ? audio_h * 3600.0 / wall_s : 0.0);
+
+    free(tids);
+    return (bad_inputs || atomic_load(&batch.failures)) ? 2 : 0;
+}
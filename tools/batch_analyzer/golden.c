@@ -0,0 +1,906 @@
+/**
+ * @file golden.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Host regression harness for the DSP kernels: golden input vectors
+ *        with recorded RMS / centroid / spectral / scene outputs, tolerance
+ *        checks of every kernel path against them, and a per-kernel timing
+ *        gate against a recorded baseline.
+ * @version 0.1
+ * @date 2025-12-15
+ *
+ * The input vectors are synthesized from the specs below with a fixed
+ * seed, so the golden file only has to store their checksums next to the
+ * expected outputs. Outputs are recorded from the float path, the
+ * reference; every path in PATHS (today the float kernels of
+ * dsp_features.c and the fixed-point kernels of dsp_fixed.c) is checked
+ * against those values with its own tolerance, and its scene labels over
+ * the scripted sequences must match exactly.
+ *
+ * Everything here runs at a fixed 16 kHz / 512-sample geometry with a
+ * fixed scene detector configuration, so the golden file does not depend
+ * on sdkconfig. Timings depend on the machine; record the baseline on the
+ * machine that runs the gate.
+ *
+ *   das_golden record [-g golden.txt]            rewrite the golden outputs
+ *   das_golden check  [-g golden.txt] [-b baseline.txt] [-m pct] [-v]
+ *   das_golden bench  [-o baseline.txt]          time the kernels
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "dsp_features.h"
+#include "dsp_fixed.h"
+#include "biquad_chain.h"
+#include "fir_decimator.h"
+#include "sound_level.h"
+#include "scene_detector.h"
+
+#ifndef GOLDEN_DEFAULT_PATH
+#define GOLDEN_DEFAULT_PATH     "golden.txt"
+#endif
+
+#define GOLDEN_RATE             16000
+#define GOLDEN_COUNT            DSP_TABLES_FFT_SIZE
+#define GOLDEN_DECIMATION       3
+#define GOLDEN_SEED             0x5EEDu
+
+#define DEFAULT_MARGIN_PCT      10.0
+#define BENCH_ROUNDS            15
+#define BENCH_ROUND_S           0.005
+
+#define MAX_ENTRIES             1024
+#define KEY_LEN                 64
+#define VALUE_LEN               256
+
+typedef enum {
+    SIG_SILENCE,
+    SIG_SINE,
+    SIG_TWO_TONE,
+    SIG_NOISE,
+    SIG_VOICED,             // harmonics of f1 below 6 kHz at 1/k amplitude
+    SIG_CHIRP,              // linear f1 -> f2 over one frame
+    SIG_DC_SINE,            // sine of f1 on a DC offset of f2 (fraction of full scale)
+    SIG_CLIPPED,            // sine of f1 driven 6 dB into clipping
+    SIG_IMPULSE,
+} signal_kind_t;
+
+typedef struct {
+    const char *name;
+    signal_kind_t kind;
+    float f1;
+    float f2;
+    float level_db;         // peak, dBFS
+    float am_hz;            // > 0: syllabic amplitude modulation
+} vector_spec_t;
+
+static const vector_spec_t VECTORS[] = {
+    { "silence",        SIG_SILENCE,  0,     0,     0,   0 },
+    { "sine_250_m6",    SIG_SINE,     250,   0,    -6,   0 },
+    { "sine_1k_m20",    SIG_SINE,     1000,  0,   -20,   0 },
+    { "sine_3k_m40",    SIG_SINE,     3000,  0,   -40,   0 },
+    { "sine_7k_m10",    SIG_SINE,     7000,  0,   -10,   0 },
+    { "hum_50_m20",     SIG_SINE,     50,    0,   -20,   0 },
+    { "two_tone_m12",   SIG_TWO_TONE, 500,   2500, -12,  0 },
+    { "noise_m10",      SIG_NOISE,    0,     0,   -10,   0 },
+    { "noise_m50",      SIG_NOISE,    0,     0,   -50,   0 },
+    { "noise_m80",      SIG_NOISE,    0,     0,   -80,   0 },
+    { "voiced_150_m14", SIG_VOICED,   150,   0,   -14,   0 },
+    { "voiced_220_m30", SIG_VOICED,   220,   0,   -30,   0 },
+    { "chirp_m6",       SIG_CHIRP,    100,   6000, -6,   0 },
+    { "dc_sine_m20",    SIG_DC_SINE,  1000,  0.25f, -20, 0 },
+    { "clipped_1k",     SIG_CLIPPED,  1000,  0,     0,   0 },
+    { "impulse",        SIG_IMPULSE,  0,     0,    -6,   0 },
+};
+
+#define VECTOR_COUNT    (sizeof(VECTORS) / sizeof(VECTORS[0]))
+
+// Scripted scene sequences: segments of frames from one spec each
+typedef struct {
+    const vector_spec_t *spec;
+    int frames;
+} segment_t;
+
+static const vector_spec_t SEQ_ROOM      = { "room",     SIG_NOISE,   0,    0, -50, 0 };
+static const vector_spec_t SEQ_TALK      = { "talk",     SIG_VOICED,  150,  0, -14, 3.0f };
+static const vector_spec_t SEQ_STEADY    = { "steady",   SIG_VOICED,  200,  0, -14, 0 };
+static const vector_spec_t SEQ_FAN       = { "fan",      SIG_NOISE,   0,    0, -6,  0 };
+static const vector_spec_t SEQ_LOW_TONE  = { "low",      SIG_SINE,    250,  0, -20, 0 };
+static const vector_spec_t SEQ_MID_TONE  = { "mid",      SIG_SINE,    1000, 0, -20, 0 };
+static const vector_spec_t SEQ_HIGH_TONE = { "high",     SIG_SINE,    5000, 0, -20, 0 };
+
+static const segment_t SEQ_CONVERSATION[] = {
+    { &SEQ_ROOM, 40 }, { &SEQ_TALK, 120 }, { &SEQ_FAN, 60 },
+    { &SEQ_ROOM, 20 }, { &SEQ_STEADY, 60 }, { NULL, 0 },
+};
+
+static const segment_t SEQ_TONES[] = {
+    { &SEQ_LOW_TONE, 30 }, { &SEQ_MID_TONE, 30 }, { &SEQ_HIGH_TONE, 30 },
+    { &SEQ_MID_TONE, 2 }, { &SEQ_HIGH_TONE, 10 }, { NULL, 0 },
+};
+
+static const struct {
+    const char *name;
+    const segment_t *segments;
+} SEQUENCES[] = {
+    { "conversation", SEQ_CONVERSATION },
+    { "tones",        SEQ_TONES },
+};
+
+// Comparison tolerance: |got - want| <= abs + rel * |want|
+typedef struct {
+    double abs;
+    double rel;
+} tol_t;
+
+static const tol_t TOL_HZ       = { 0.05, 1e-4 };
+static const tol_t TOL_BIN_HZ   = { 0.5,  1e-4 };
+static const tol_t TOL_RATIO    = { 1e-5, 1e-3 };
+static const tol_t TOL_DB       = { 0.01, 0 };
+static const tol_t TOL_FILTERED = { 1e-9, 1e-4 };
+
+// Fixed-point error bounds stated in dsp_fixed.h; a quarter bin is 7.8 Hz here
+static const tol_t BOUND_RMS      = { 1e-9, 1e-5 };
+static const tol_t BOUND_CENTROID = { GOLDEN_RATE / (double)GOLDEN_COUNT / 4, 0.05 };
+#define BOUND_MAG_20DB  0.5     // dB error, bins within 20 dB of the peak
+#define BOUND_MAG_40DB  3.0     // dB error, bins within 40 dB of the peak
+
+// A kernel path the golden outputs are checked against; PATHS[0] records them
+typedef struct {
+    const char *name;
+    float (*rms)(const int32_t *samples, size_t count);
+    float (*centroid)(const int32_t *samples, size_t count, int sample_rate,
+                      dsp_fft_scratch_t *scratch, float *mag_out);
+    tol_t rms_tol;
+    tol_t centroid_tol;
+} dsp_path_t;
+
+static const dsp_path_t PATHS[] = {
+    { "float", dsp_compute_rms,     dsp_compute_spectral_centroid_fft,
+      { 1e-9, 1e-5 }, { 0.05, 1e-4 } },
+    { "fixed", dsp_compute_rms_q31, dsp_compute_spectral_centroid_sc16,
+      BOUND_RMS, BOUND_CENTROID },
+};
+
+#define PATH_COUNT      (sizeof(PATHS) / sizeof(PATHS[0]))
+
+typedef struct {
+    char key[KEY_LEN];
+    char value[VALUE_LEN];
+} entry_t;
+
+typedef struct {
+    FILE *out;              // record: golden file being written
+    entry_t *entries;       // check: loaded golden file
+    size_t entry_count;
+    int verbose;
+    int checks;
+    int failures;
+} golden_run_t;
+
+// ---------------------------------------------------------------------------
+// Input vectors
+
+static uint32_t lcg_next(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state;
+}
+
+static double sample_at(const vector_spec_t *s, uint64_t n, int rate, uint32_t *rng)
+{
+    const double t = (double)n / rate;
+    const double a = pow(10.0, s->level_db / 20.0);
+    double x = 0.0;
+
+    switch (s->kind) {
+    case SIG_SILENCE:
+        break;
+    case SIG_SINE:
+        x = a * sin(2.0 * M_PI * s->f1 * t);
+        break;
+    case SIG_TWO_TONE:
+        x = 0.5 * a * (sin(2.0 * M_PI * s->f1 * t) + sin(2.0 * M_PI * s->f2 * t));
+        break;
+    case SIG_NOISE:
+        x = a * ((double)(lcg_next(rng) >> 8) / 8388608.0 - 1.0);
+        break;
+    case SIG_VOICED: {
+        double sum = 0.0, norm = 0.0;
+        for (int k = 1; k * s->f1 < 6000.0f; k++) {
+            sum  += sin(2.0 * M_PI * k * s->f1 * t) / k;
+            norm += 1.0 / k;
+        }
+        x = a * sum / norm;
+        break;
+    }
+    case SIG_CHIRP: {
+        const double span = (double)GOLDEN_COUNT / GOLDEN_RATE;
+        const double tc = fmod(t, span);
+        x = a * sin(2.0 * M_PI * (s->f1 * tc + (s->f2 - s->f1) * tc * tc / (2.0 * span)));
+        break;
+    }
+    case SIG_DC_SINE:
+        x = s->f2 + a * sin(2.0 * M_PI * s->f1 * t);
+        break;
+    case SIG_CLIPPED:
+        x = fmax(-a, fmin(a, 2.0 * a * sin(2.0 * M_PI * s->f1 * t)));
+        break;
+    case SIG_IMPULSE:
+        x = (n % GOLDEN_COUNT == GOLDEN_COUNT / 4) ? a : 0.0;
+        break;
+    }
+
+    if (s->am_hz > 0.0f) {
+        x *= 0.55 + 0.45 * sin(2.0 * M_PI * s->am_hz * t);
+    }
+    return x;
+}
+
+// `count` samples from sample index `first`, 24-bit left-aligned as read from the INMP441
+static void generate(const vector_spec_t *s, uint64_t first, int rate, size_t count,
+                     uint32_t *rng, int32_t *out)
+{
+    for (size_t i = 0; i < count; i++) {
+        double v = nearbyint(sample_at(s, first + i, rate, rng) * 8388608.0);
+        if (v > 8388607.0) v = 8388607.0;
+        if (v < -8388608.0) v = -8388608.0;
+        out[i] = (int32_t)((uint32_t)(int32_t)v << 8);
+    }
+}
+
+static uint32_t fnv1a(const int32_t *samples, size_t count)
+{
+    uint32_t h = 2166136261u;
+    const uint8_t *p = (const uint8_t *)samples;
+    for (size_t i = 0; i < count * sizeof(int32_t); i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+static double rms_of(const int32_t *samples, size_t count)
+{
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        double x = samples[i] / 2147483648.0;
+        sum += x * x;
+    }
+    return sqrt(sum / count);
+}
+
+// ---------------------------------------------------------------------------
+// Golden file
+
+static const entry_t *find_entry(const golden_run_t *r, const char *key)
+{
+    for (size_t i = 0; i < r->entry_count; i++) {
+        if (strcmp(r->entries[i].key, key) == 0) return &r->entries[i];
+    }
+    return NULL;
+}
+
+static int load_golden(golden_run_t *r, const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+
+    r->entries = calloc(MAX_ENTRIES, sizeof(*r->entries));
+    if (!r->entries) {
+        fclose(fp);
+        return -1;
+    }
+
+    char line[KEY_LEN + VALUE_LEN + 8];
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (r->entry_count == MAX_ENTRIES) break;
+        entry_t *e = &r->entries[r->entry_count];
+        if (sscanf(line, "%63s %255s", e->key, e->value) == 2) {
+            r->entry_count++;
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+static void fail(golden_run_t *r, const char *path, const char *key, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static void fail(golden_run_t *r, const char *path, const char *key, const char *fmt, ...)
+{
+    va_list ap;
+    printf("FAIL %-6s %-28s ", path, key);
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    printf("\n");
+    r->failures++;
+}
+
+// Record (reference path) or check one numeric output
+static void measure(golden_run_t *r, const dsp_path_t *path, const char *vector,
+                    const char *name, double value, tol_t tol)
+{
+    char key[KEY_LEN];
+    snprintf(key, sizeof(key), "%s.%s", vector, name);
+
+    if (r->out) {
+        if (path == &PATHS[0]) fprintf(r->out, "%s %.9g\n", key, value);
+        return;
+    }
+
+    r->checks++;
+    const entry_t *e = find_entry(r, key);
+    if (!e) {
+        fail(r, path->name, key, "missing from the golden file");
+        return;
+    }
+    const double want = strtod(e->value, NULL);
+    const double err = fabs(value - want);
+    const double limit = tol.abs + tol.rel * fabs(want);
+    if (!(err <= limit)) {
+        fail(r, path->name, key, "got %.9g want %.9g (error %.3g > %.3g)", value, want, err, limit);
+    } else if (r->verbose) {
+        printf("ok   %-6s %-28s %.9g (error %.3g)\n", path->name, key, value, err);
+    }
+}
+
+// Record or check one exact string output
+static void measure_str(golden_run_t *r, const dsp_path_t *path, const char *key, const char *value)
+{
+    if (r->out) {
+        if (path == &PATHS[0]) fprintf(r->out, "%s %s\n", key, value);
+        return;
+    }
+
+    r->checks++;
+    const entry_t *e = find_entry(r, key);
+    if (!e) {
+        fail(r, path->name, key, "missing from the golden file");
+    } else if (strcmp(e->value, value) != 0) {
+        fail(r, path->name, key, "got %s want %s", value, e->value);
+    } else if (r->verbose) {
+        printf("ok   %-6s %-28s %s\n", path->name, key, value);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Per-vector kernel outputs
+
+// FFT work buffer for the checks; the harness is single-threaded
+static dsp_fft_scratch_t s_scratch;
+
+static void run_vectors(golden_run_t *r)
+{
+    int32_t frame[GOLDEN_COUNT];
+    int32_t wide[GOLDEN_COUNT * GOLDEN_DECIMATION];
+    int32_t decimated[GOLDEN_COUNT];
+    dsp_spectral_state_t state = { .valid = false };
+
+    fir_decimator_t decimator;
+    if (fir_decimator_init(&decimator, GOLDEN_DECIMATION, GOLDEN_COUNT * GOLDEN_DECIMATION) != ESP_OK) {
+        fprintf(stderr, "decimator init failed\n");
+        r->failures++;
+        return;
+    }
+
+    for (size_t v = 0; v < VECTOR_COUNT; v++) {
+        const vector_spec_t *s = &VECTORS[v];
+        uint32_t rng = GOLDEN_SEED;
+        generate(s, 0, GOLDEN_RATE, GOLDEN_COUNT, &rng, frame);
+
+        char hash[16];
+        char key[KEY_LEN];
+        snprintf(hash, sizeof(hash), "%08x", (unsigned)fnv1a(frame, GOLDEN_COUNT));
+        snprintf(key, sizeof(key), "%s.input", s->name);
+        measure_str(r, &PATHS[0], key, hash);
+
+        for (size_t p = 0; p < PATH_COUNT; p++) {
+            const dsp_path_t *path = &PATHS[p];
+            measure(r, path, s->name, "rms", path->rms(frame, GOLDEN_COUNT), path->rms_tol);
+            measure(r, path, s->name, "centroid",
+                    path->centroid(frame, GOLDEN_COUNT, GOLDEN_RATE, &s_scratch, NULL), path->centroid_tol);
+        }
+
+        // Float-only kernels. The flux compares against the previous vector.
+        const dsp_path_t *ref = &PATHS[0];
+        measure(r, ref, s->name, "zcr", dsp_compute_zcr(frame, GOLDEN_COUNT), TOL_RATIO);
+
+        dsp_spectral_features_t f;
+        if (!dsp_compute_spectral_features_fft(frame, GOLDEN_COUNT, GOLDEN_RATE, &s_scratch, NULL, &state, &f)) {
+            fail(r, ref->name, s->name, "dsp_compute_spectral_features_fft failed");
+            continue;
+        }
+        measure(r, ref, s->name, "spectral.centroid", f.centroid_hz, TOL_HZ);
+        measure(r, ref, s->name, "bandwidth", f.bandwidth_hz, TOL_HZ);
+        measure(r, ref, s->name, "rolloff", f.rolloff_hz, TOL_BIN_HZ);
+        measure(r, ref, s->name, "flatness", f.flatness, TOL_RATIO);
+        measure(r, ref, s->name, "flux", f.flux, TOL_RATIO);
+        for (int k = 0; k < DSP_SPECTRAL_BANDS; k++) {
+            char name[16];
+            snprintf(name, sizeof(name), "band%d_db", k);
+            measure(r, ref, s->name, name, f.band_db[k], TOL_DB);
+        }
+
+        // Input filter: 4th-order 80 Hz high-pass and a 50 Hz notch, fresh state
+        biquad_chain_t chain;
+        biquad_chain_init(&chain, GOLDEN_RATE);
+        biquad_chain_add_highpass(&chain, 80.0f, 4);
+        biquad_chain_add(&chain, BIQUAD_NOTCH, 50.0f, 3.0f);
+        int32_t filtered[GOLDEN_COUNT];
+        memcpy(filtered, frame, sizeof(filtered));
+        biquad_chain_process(&chain, filtered, GOLDEN_COUNT);
+        measure(r, ref, s->name, "filtered_rms", rms_of(filtered, GOLDEN_COUNT), TOL_FILTERED);
+
+        // Decimator: the same spec at 3x the rate, two blocks so the history is settled
+        rng = GOLDEN_SEED;
+        for (int b = 0; b < 2; b++) {
+            generate(s, (uint64_t)b * GOLDEN_COUNT * GOLDEN_DECIMATION, GOLDEN_RATE * GOLDEN_DECIMATION,
+                     GOLDEN_COUNT * GOLDEN_DECIMATION, &rng, wide);
+            fir_decimator_process(&decimator, wide, decimated);
+        }
+        measure(r, ref, s->name, "decimated_rms", rms_of(decimated, GOLDEN_COUNT), TOL_FILTERED);
+        measure(r, ref, s->name, "decimated_centroid",
+                dsp_compute_spectral_centroid_fft(decimated, GOLDEN_COUNT, GOLDEN_RATE, &s_scratch, NULL), TOL_HZ);
+    }
+
+    fir_decimator_deinit(&decimator);
+}
+
+// ---------------------------------------------------------------------------
+// Fixed-point error bounds
+
+/*
+ * The BOUND_* limits, checked directly against the float path rather than
+ * through the golden file: white noise, harmonic, tonal and swept input
+ * from 0 to -80 dBFS.
+ */
+
+static const vector_spec_t BOUND_SIGNALS[] = {
+    { "noise",  SIG_NOISE,  0,    0,    0, 0 },
+    { "voiced", SIG_VOICED, 150,  0,    0, 0 },
+    { "sine",   SIG_SINE,   1000, 0,    0, 0 },
+    { "hum",    SIG_SINE,   50,   0,    0, 0 },
+    { "chirp",  SIG_CHIRP,  100,  6000, 0, 0 },
+};
+
+static const float BOUND_LEVELS_DB[] = { 0, -20, -40, -60, -80 };
+
+static void bound(golden_run_t *r, const char *key, double got, double want, tol_t tol)
+{
+    r->checks++;
+    const double err = fabs(got - want);
+    const double limit = tol.abs + tol.rel * fabs(want);
+    if (!(err <= limit)) {
+        fail(r, "bound", key, "fixed %.9g float %.9g (error %.3g > %.3g)", got, want, err, limit);
+    } else if (r->verbose) {
+        printf("ok   %-6s %-28s %.9g (error %.3g)\n", "bound", key, got, err);
+    }
+}
+
+static void run_fixed_bounds(golden_run_t *r)
+{
+    int32_t frame[GOLDEN_COUNT];
+    float mag_float[GOLDEN_COUNT / 2];
+    float mag_fixed[GOLDEN_COUNT / 2];
+
+    for (size_t s = 0; s < sizeof(BOUND_SIGNALS) / sizeof(BOUND_SIGNALS[0]); s++) {
+        for (size_t l = 0; l < sizeof(BOUND_LEVELS_DB) / sizeof(BOUND_LEVELS_DB[0]); l++) {
+            vector_spec_t spec = BOUND_SIGNALS[s];
+            spec.level_db = BOUND_LEVELS_DB[l];
+            uint32_t rng = GOLDEN_SEED;
+            generate(&spec, 0, GOLDEN_RATE, GOLDEN_COUNT, &rng, frame);
+
+            char key[KEY_LEN];
+            snprintf(key, sizeof(key), "%s_m%d.rms", spec.name, (int)-spec.level_db);
+            bound(r, key, dsp_compute_rms_q31(frame, GOLDEN_COUNT),
+                  dsp_compute_rms(frame, GOLDEN_COUNT), BOUND_RMS);
+
+            snprintf(key, sizeof(key), "%s_m%d.centroid", spec.name, (int)-spec.level_db);
+            bound(r, key, dsp_compute_spectral_centroid_sc16(frame, GOLDEN_COUNT, GOLDEN_RATE, &s_scratch, mag_fixed),
+                  dsp_compute_spectral_centroid_fft(frame, GOLDEN_COUNT, GOLDEN_RATE, &s_scratch, mag_float),
+                  BOUND_CENTROID);
+
+            // Worst magnitude error over the bins near the peak, in dB
+            float peak = 0.0f;
+            for (int k = 0; k < GOLDEN_COUNT / 2; k++) {
+                if (mag_float[k] > peak) peak = mag_float[k];
+            }
+            double worst20 = 0.0, worst40 = 0.0;
+            for (int k = 0; k < GOLDEN_COUNT / 2 && peak > 0.0f; k++) {
+                const double below = 20.0 * log10(peak / fmax(mag_float[k], 1e-30));
+                if (below > 40.0) continue;
+                const double err = (mag_fixed[k] > 0.0f)
+                    ? fabs(20.0 * log10(mag_fixed[k] / mag_float[k])) : INFINITY;
+                if (below <= 20.0) worst20 = fmax(worst20, err);
+                worst40 = fmax(worst40, err);
+            }
+            snprintf(key, sizeof(key), "%s_m%d.mag20_db", spec.name, (int)-spec.level_db);
+            bound(r, key, worst20, 0.0, (tol_t){ BOUND_MAG_20DB, 0 });
+            snprintf(key, sizeof(key), "%s_m%d.mag40_db", spec.name, (int)-spec.level_db);
+            bound(r, key, worst40, 0.0, (tol_t){ BOUND_MAG_40DB, 0 });
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Scene sequences
+
+static void scene_config(scene_detector_config_t *cfg)
+{
+    cfg->hysteresis = 0.2f;
+    cfg->min_dwell_frames = 3;
+    cfg->gain_alpha = 1.0f;
+    cfg->gain[SCENE_QUIET]  = 1.0f;
+    cfg->gain[SCENE_SPEECH] = 1.0f;
+    cfg->gain[SCENE_NOISE]  = 1.0f;
+}
+
+/*
+ * Debounced labels of one sequence through the device's cascade (the FFT
+ * only when the detector needs the centroid), run-length encoded: q40,s12
+ */
+static void run_sequence(const dsp_path_t *path, const segment_t *segments, char *out, size_t out_len)
+{
+    static const char LETTERS[] = { 'q', 's', 'n' };
+    int32_t frame[GOLDEN_COUNT];
+    scene_detector_config_t cfg;
+    scene_detector_t det;
+    scene_config(&cfg);
+    scene_detector_init(&det, &cfg, GOLDEN_RATE, GOLDEN_COUNT);
+
+    uint32_t rng = GOLDEN_SEED;
+    uint64_t n = 0;
+    int run_scene = -1, run_len = 0;
+    size_t len = 0;
+    out[0] = '\0';
+
+    for (const segment_t *seg = segments; seg->spec; seg++) {
+        for (int i = 0; i < seg->frames; i++, n++) {
+            generate(seg->spec, n * GOLDEN_COUNT, GOLDEN_RATE, GOLDEN_COUNT, &rng, frame);
+
+            float rms = path->rms(frame, GOLDEN_COUNT);
+            float centroid = NAN;
+            if (scene_detector_needs_centroid(&det, rms)) {
+                centroid = rms > 1e-6f ? path->centroid(frame, GOLDEN_COUNT, GOLDEN_RATE, &s_scratch, NULL) : 0.0f;
+            }
+            scene_event_t event;
+            scene_detector_update(&det, rms, centroid, (int64_t)(n * GOLDEN_COUNT * 1000000ULL / GOLDEN_RATE),
+                                  &event);
+
+            if ((int)det.scene == run_scene) {
+                run_len++;
+                continue;
+            }
+            if (run_len > 0 && len < out_len) {
+                len += snprintf(out + len, out_len - len, "%s%c%d", len ? "," : "", LETTERS[run_scene], run_len);
+            }
+            run_scene = (int)det.scene;
+            run_len = 1;
+        }
+    }
+    if (run_len > 0 && len < out_len) {
+        snprintf(out + len, out_len - len, "%s%c%d", len ? "," : "", LETTERS[run_scene], run_len);
+    }
+}
+
+static void run_sequences(golden_run_t *r)
+{
+    for (size_t q = 0; q < sizeof(SEQUENCES) / sizeof(SEQUENCES[0]); q++) {
+        char key[KEY_LEN];
+        snprintf(key, sizeof(key), "scene.%s", SEQUENCES[q].name);
+        for (size_t p = 0; p < PATH_COUNT; p++) {
+            char labels[VALUE_LEN];
+            run_sequence(&PATHS[p], SEQUENCES[q].segments, labels, sizeof(labels));
+            measure_str(r, &PATHS[p], key, labels);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Kernel timing
+
+// Broadband input so denormals or silence shortcuts cannot flatter a kernel
+static const vector_spec_t BENCH_INPUT = { "bench", SIG_NOISE, 0, 0, -10, 0 };
+
+typedef struct {
+    int32_t frame[GOLDEN_COUNT];
+    int32_t scratch[GOLDEN_COUNT];
+    int32_t wide[GOLDEN_COUNT * GOLDEN_DECIMATION];
+    int32_t decimated[GOLDEN_COUNT];
+    biquad_chain_t chain;
+    fir_decimator_t decimator;
+    sound_level_meter_t meter;
+    dsp_fft_scratch_t fft;
+    dsp_spectral_state_t state;
+    scene_detector_t detector;
+    uint64_t frame_index;
+    volatile float sink;
+} bench_t;
+
+static void k_rms(bench_t *b)           { b->sink = dsp_compute_rms(b->frame, GOLDEN_COUNT); }
+static void k_rms_q31(bench_t *b)       { b->sink = dsp_compute_rms_q31(b->frame, GOLDEN_COUNT); }
+static void k_zcr(bench_t *b)           { b->sink = dsp_compute_zcr(b->frame, GOLDEN_COUNT); }
+
+static void k_centroid_fft(bench_t *b)
+{
+    b->sink = dsp_compute_spectral_centroid_fft(b->frame, GOLDEN_COUNT, GOLDEN_RATE, &b->fft, NULL);
+}
+
+static void k_centroid_sc16(bench_t *b)
+{
+    b->sink = dsp_compute_spectral_centroid_sc16(b->frame, GOLDEN_COUNT, GOLDEN_RATE, &b->fft, NULL);
+}
+
+static void k_spectral_fft(bench_t *b)
+{
+    dsp_spectral_features_t f;
+    dsp_compute_spectral_features_fft(b->frame, GOLDEN_COUNT, GOLDEN_RATE, &b->fft, NULL, &b->state, &f);
+    b->sink = f.flux;
+}
+
+// Includes re-copying the input so every call filters the same broadband frame
+static void k_biquad_chain(bench_t *b)
+{
+    memcpy(b->scratch, b->frame, sizeof(b->scratch));
+    biquad_chain_process(&b->chain, b->scratch, GOLDEN_COUNT);
+    b->sink = (float)b->scratch[0];
+}
+
+static void k_fir_decimator(bench_t *b)
+{
+    fir_decimator_process(&b->decimator, b->wide, b->decimated);
+    b->sink = (float)b->decimated[0];
+}
+
+// A-weighted meter on the wide buffer, i.e. one 32 ms frame at 48 kHz
+static void k_sound_level(bench_t *b)
+{
+    sound_level_process(&b->meter, b->wide, GOLDEN_COUNT * GOLDEN_DECIMATION);
+    b->sink = b->meter.st.leq_db;
+}
+
+static void k_scene_update(bench_t *b)
+{
+    scene_event_t event;
+    float rms = (b->frame_index & 64) ? 0.05f : 0.2f;
+    scene_detector_update(&b->detector, rms, 1500.0f, (int64_t)(b->frame_index++ * 32000), &event);
+    b->sink = b->detector.gain;
+}
+
+static const struct {
+    const char *name;
+    void (*run)(bench_t *b);
+} KERNELS[] = {
+    { "rms",            k_rms },
+    { "rms_q31",        k_rms_q31 },
+    { "zcr",            k_zcr },
+    { "centroid_fft",   k_centroid_fft },
+    { "centroid_sc16",  k_centroid_sc16 },
+    { "spectral_fft",   k_spectral_fft },
+    { "biquad_chain",   k_biquad_chain },
+    { "fir_decimator",  k_fir_decimator },
+    { "sound_level_48k", k_sound_level },
+    { "scene_update",   k_scene_update },
+};
+
+#define KERNEL_COUNT    (sizeof(KERNELS) / sizeof(KERNELS[0]))
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int bench_init(bench_t *b)
+{
+    memset(b, 0, sizeof(*b));
+    uint32_t rng = GOLDEN_SEED;
+    generate(&BENCH_INPUT, 0, GOLDEN_RATE, GOLDEN_COUNT, &rng, b->frame);
+    rng = GOLDEN_SEED;
+    generate(&BENCH_INPUT, 0, GOLDEN_RATE * GOLDEN_DECIMATION, GOLDEN_COUNT * GOLDEN_DECIMATION, &rng, b->wide);
+
+    biquad_chain_init(&b->chain, GOLDEN_RATE);
+    biquad_chain_add_highpass(&b->chain, 80.0f, 4);
+    biquad_chain_add(&b->chain, BIQUAD_NOTCH, 50.0f, 3.0f);
+    if (fir_decimator_init(&b->decimator, GOLDEN_DECIMATION, GOLDEN_COUNT * GOLDEN_DECIMATION) != ESP_OK) {
+        return -1;
+    }
+    sound_level_init(&b->meter, GOLDEN_RATE * GOLDEN_DECIMATION, SOUND_LEVEL_WEIGHTING_A, -26.0f, 1.0f);
+
+    scene_detector_config_t cfg;
+    scene_config(&cfg);
+    scene_detector_init(&b->detector, &cfg, GOLDEN_RATE, GOLDEN_COUNT);
+    return 0;
+}
+
+// Calls per round so that one round of `run` takes about BENCH_ROUND_S
+static uint64_t calibrate(bench_t *b, void (*run)(bench_t *b))
+{
+    uint64_t iters = 1;
+    for (;;) {
+        double t0 = now_s();
+        for (uint64_t i = 0; i < iters; i++) run(b);
+        if (now_s() - t0 >= BENCH_ROUND_S / 4 || iters >= (1u << 24)) break;
+        iters *= 2;
+    }
+    return iters * 4;
+}
+
+/*
+ * Nanoseconds per call of each kernel: the fastest of BENCH_ROUNDS rounds,
+ * so scheduler noise only ever makes a round slower. Rounds visit the
+ * kernels in turn, so a slow phase of the host hits all of them alike
+ * rather than one kernel's whole measurement.
+ */
+static int run_bench(double *ns)
+{
+    bench_t *b = malloc(sizeof(*b));
+    if (!b || bench_init(b) != 0) {
+        fprintf(stderr, "bench setup failed\n");
+        free(b);
+        return -1;
+    }
+
+    uint64_t iters[KERNEL_COUNT];
+    for (size_t k = 0; k < KERNEL_COUNT; k++) {
+        iters[k] = calibrate(b, KERNELS[k].run);
+        ns[k] = INFINITY;
+    }
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (size_t k = 0; k < KERNEL_COUNT; k++) {
+            double t0 = now_s();
+            for (uint64_t i = 0; i < iters[k]; i++) KERNELS[k].run(b);
+            double per_call = (now_s() - t0) * 1e9 / iters[k];
+            if (per_call < ns[k]) ns[k] = per_call;
+        }
+    }
+
+    fir_decimator_deinit(&b->decimator);
+    free(b);
+    return 0;
+}
+
+// Compare against a baseline written by `bench -o`; returns the number of regressions
+static int timing_gate(const char *baseline_path, double margin_pct)
+{
+    golden_run_t base = { 0 };
+    if (load_golden(&base, baseline_path) != 0) {
+        fprintf(stderr, "%s: cannot read baseline\n", baseline_path);
+        return 1;
+    }
+
+    double ns[KERNEL_COUNT];
+    if (run_bench(ns) != 0) {
+        free(base.entries);
+        return 1;
+    }
+
+    int slower = 0;
+    printf("%-16s %10s %10s %8s\n", "kernel", "base ns", "now ns", "change");
+    for (size_t k = 0; k < KERNEL_COUNT; k++) {
+        const entry_t *e = find_entry(&base, KERNELS[k].name);
+        if (!e) {
+            printf("%-16s %10s %10.0f %8s\n", KERNELS[k].name, "-", ns[k], "new");
+            continue;
+        }
+        const double was = strtod(e->value, NULL);
+        const double change = (ns[k] / was - 1.0) * 100.0;
+        const int regressed = ns[k] > was * (1.0 + margin_pct / 100.0);
+        printf("%-16s %10.0f %10.0f %+7.1f%%%s\n", KERNELS[k].name, was, ns[k], change,
+               regressed ? "  SLOWER" : "");
+        slower += regressed;
+    }
+    free(base.entries);
+    return slower;
+}
+
+// ---------------------------------------------------------------------------
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s record|check|bench [options]\n"
+        "  record   compute the golden outputs from the float path and write them\n"
+        "  check    compare every kernel path against the golden outputs\n"
+        "  bench    time each kernel, optionally writing a baseline\n"
+        "  -g PATH  golden file (default %s)\n"
+        "  -b PATH  check: also gate the kernel timings against this baseline\n"
+        "  -m PCT   allowed slowdown against the baseline (default %.0f)\n"
+        "  -o PATH  bench: write the timings as a baseline\n"
+        "  -v       check: list passing outputs too\n",
+        prog, GOLDEN_DEFAULT_PATH, DEFAULT_MARGIN_PCT);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *mode = argv[1];
+    const char *golden_path = GOLDEN_DEFAULT_PATH;
+    const char *baseline_path = NULL;
+    const char *out_path = NULL;
+    double margin_pct = DEFAULT_MARGIN_PCT;
+    golden_run_t run = { 0 };
+
+    optind = 2;
+    int opt;
+    while ((opt = getopt(argc, argv, "g:b:m:o:vh")) != -1) {
+        switch (opt) {
+        case 'g': golden_path = optarg; break;
+        case 'b': baseline_path = optarg; break;
+        case 'm': margin_pct = atof(optarg); break;
+        case 'o': out_path = optarg; break;
+        case 'v': run.verbose = 1; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+
+    if (strcmp(mode, "record") == 0) {
+        run.out = fopen(golden_path, "w");
+        if (!run.out) {
+            fprintf(stderr, "%s: cannot write\n", golden_path);
+            return 1;
+        }
+        fprintf(run.out, "# das_golden outputs, recorded from the float path\n");
+        fprintf(run.out, "# %d Hz, %d-sample frames; <vector>.input is the FNV-1a of the input\n",
+                GOLDEN_RATE, GOLDEN_COUNT);
+        run_vectors(&run);
+        run_sequences(&run);
+        fclose(run.out);
+        printf("wrote %s\n", golden_path);
+        return run.failures ? 1 : 0;
+    }
+
+    if (strcmp(mode, "check") == 0) {
+        if (load_golden(&run, golden_path) != 0) {
+            fprintf(stderr, "%s: cannot read golden file\n", golden_path);
+            return 1;
+        }
+        run_vectors(&run);
+        run_sequences(&run);
+        run_fixed_bounds(&run);
+        free(run.entries);
+        printf("%d outputs checked over %zu paths, %d failed\n", run.checks, PATH_COUNT, run.failures);
+
+        int slower = 0;
+        if (baseline_path) {
+            slower = timing_gate(baseline_path, margin_pct);
+            printf("%d kernels more than %.0f%% slower than the baseline\n", slower, margin_pct);
+        }
+        return (run.failures || slower) ? 1 : 0;
+    }
+
+    if (strcmp(mode, "bench") == 0) {
+        double ns[KERNEL_COUNT];
+        if (run_bench(ns) != 0) return 1;
+
+        FILE *out = out_path ? fopen(out_path, "w") : NULL;
+        if (out_path && !out) {
+            fprintf(stderr, "%s: cannot write\n", out_path);
+            return 1;
+        }
+        if (out) fprintf(out, "# das_golden kernel timings, ns per call (fastest of %d rounds)\n", BENCH_ROUNDS);
+        for (size_t k = 0; k < KERNEL_COUNT; k++) {
+            printf("%-16s %10.0f ns\n", KERNELS[k].name, ns[k]);
+            if (out) fprintf(out, "%s %.1f\n", KERNELS[k].name, ns[k]);
+        }
+        if (out) {
+            fclose(out);
+            printf("wrote %s\n", out_path);
+        }
+        return 0;
+    }
+
+    usage(argv[0]);
+    return 1;
+}
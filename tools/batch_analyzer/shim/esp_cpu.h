@@ -0,0 +1,11 @@
+#pragma once
+#include <stdint.h>
+#include <time.h>
+
+// Host build: nanoseconds stand in for CPU cycles
+static inline uint32_t esp_cpu_get_cycle_count(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec);
+}
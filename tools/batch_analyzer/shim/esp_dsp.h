@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+
+/*
+ * Host build: portable C versions of the esp-dsp kernels the shared DSP
+ * sources call, with the same names, arguments and data layouts (the
+ * algorithms of esp-dsp's ANSI reference implementations). Results match
+ * the ESP32 assembly kernels to float rounding.
+ */
+
+esp_err_t dsps_fft2r_fc32_ae32_(float *data, int N, float *w);
+esp_err_t dsps_fft2r_sc16_ae32_(int16_t *data, int N, int16_t *w);
+esp_err_t dsps_biquad_f32_ae32(const float *input, float *output, int len, float *coef, float *w);
+esp_err_t dsps_dotprod_f32_ae32(const float *src1, const float *src2, float *dest, int len);
@@ -0,0 +1,86 @@
+/**
+ * @file esp_dsp_host.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Portable C versions of the esp-dsp kernels used by the feature
+ *        extraction, for the host batch analyzer.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include "esp_dsp.h"
+
+// Radix-2 DIT on interleaved complex data, twiddles in bit-reversed order; output bit-reversed
+esp_err_t dsps_fft2r_fc32_ae32_(float *data, int N, float *w)
+{
+    int ie = 1;
+    for (int N2 = N / 2; N2 > 0; N2 >>= 1) {
+        int ia = 0;
+        for (int j = 0; j < ie; j++) {
+            float c = w[2 * j];
+            float s = w[2 * j + 1];
+            for (int i = 0; i < N2; i++) {
+                int m = ia + N2;
+                float re = c * data[2 * m] + s * data[2 * m + 1];
+                float im = c * data[2 * m + 1] - s * data[2 * m];
+                data[2 * m]      = data[2 * ia] - re;
+                data[2 * m + 1]  = data[2 * ia + 1] - im;
+                data[2 * ia]     += re;
+                data[2 * ia + 1] += im;
+                ia++;
+            }
+            ia += N2;
+        }
+        ie <<= 1;
+    }
+    return ESP_OK;
+}
+
+// Q15 variant; every stage halves the data so nothing overflows
+esp_err_t dsps_fft2r_sc16_ae32_(int16_t *data, int N, int16_t *w)
+{
+    int ie = 1;
+    for (int N2 = N / 2; N2 > 0; N2 >>= 1) {
+        int ia = 0;
+        for (int j = 0; j < ie; j++) {
+            int32_t c = w[2 * j];
+            int32_t s = w[2 * j + 1];
+            for (int i = 0; i < N2; i++) {
+                int m = ia + N2;
+                int32_t re = (c * data[2 * m] + s * data[2 * m + 1] + (1 << 14)) >> 15;
+                int32_t im = (c * data[2 * m + 1] - s * data[2 * m] + (1 << 14)) >> 15;
+                int32_t are = data[2 * ia];
+                int32_t aim = data[2 * ia + 1];
+                data[2 * m]      = (int16_t)((are - re) >> 1);
+                data[2 * m + 1]  = (int16_t)((aim - im) >> 1);
+                data[2 * ia]     = (int16_t)((are + re) >> 1);
+                data[2 * ia + 1] = (int16_t)((aim + im) >> 1);
+                ia++;
+            }
+            ia += N2;
+        }
+        ie <<= 1;
+    }
+    return ESP_OK;
+}
+
+// Direct form II; coef = b0, b1, b2, a1, a2
+esp_err_t dsps_biquad_f32_ae32(const float *input, float *output, int len, float *coef, float *w)
+{
+    for (int i = 0; i < len; i++) {
+        float d0 = input[i] - coef[3] * w[0] - coef[4] * w[1];
+        output[i] = coef[0] * d0 + coef[1] * w[0] + coef[2] * w[1];
+        w[1] = w[0];
+        w[0] = d0;
+    }
+    return ESP_OK;
+}
+
+esp_err_t dsps_dotprod_f32_ae32(const float *src1, const float *src2, float *dest, int len)
+{
+    float acc = 0.0f;
+    for (int i = 0; i < len; i++) {
+        acc += src1[i] * src2[i];
+    }
+    *dest = acc;
+    return ESP_OK;
+}
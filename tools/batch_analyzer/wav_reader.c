@@ -0,0 +1,155 @@
+/**
+ * @file wav_reader.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Implements a RIFF/WAVE reader that converts the first channel to
+ *        the pipeline's 24-bit left-aligned sample layout.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "wav_reader.h"
+
+#define WAVE_FORMAT_PCM         0x0001
+#define WAVE_FORMAT_IEEE_FLOAT  0x0003
+#define WAVE_FORMAT_EXTENSIBLE  0xFFFE
+
+static uint16_t le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+int wav_reader_open(wav_reader_t *w, const char *path, char *err, size_t err_len)
+{
+    memset(w, 0, sizeof(*w));
+    w->fp = fopen(path, "rb");
+    if (!w->fp) {
+        snprintf(err, err_len, "cannot open");
+        return -1;
+    }
+
+    uint8_t riff[12];
+    if (fread(riff, 1, sizeof(riff), w->fp) != sizeof(riff) ||
+        memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        snprintf(err, err_len, "not a RIFF/WAVE file");
+        goto fail;
+    }
+
+    int have_fmt = 0;
+    uint16_t format = 0;
+    for (;;) {
+        uint8_t hdr[8];
+        if (fread(hdr, 1, sizeof(hdr), w->fp) != sizeof(hdr)) {
+            snprintf(err, err_len, "no data chunk");
+            goto fail;
+        }
+        uint32_t size = le32(hdr + 4);
+
+        if (memcmp(hdr, "fmt ", 4) == 0) {
+            uint8_t fmt[40] = { 0 };
+            size_t n = size < sizeof(fmt) ? size : sizeof(fmt);
+            if (size < 16 || fread(fmt, 1, n, w->fp) != n) {
+                snprintf(err, err_len, "bad fmt chunk");
+                goto fail;
+            }
+            format          = le16(fmt);
+            w->channels     = le16(fmt + 2);
+            w->sample_rate  = le32(fmt + 4);
+            w->block_align  = le16(fmt + 12);
+            w->bits         = le16(fmt + 14);
+            if (format == WAVE_FORMAT_EXTENSIBLE && size >= 26) {
+                format = le16(fmt + 24);    // first two bytes of the subformat GUID
+            }
+            fseek(w->fp, (long)(size - n + (size & 1)), SEEK_CUR);
+            have_fmt = 1;
+        } else if (memcmp(hdr, "data", 4) == 0) {
+            if (!have_fmt) {
+                snprintf(err, err_len, "data before fmt");
+                goto fail;
+            }
+            w->data_offset = ftell(w->fp);
+            // Streamed recordings may leave the size unset
+            if (size == 0 || size == 0xFFFFFFFFu) {
+                fseek(w->fp, 0, SEEK_END);
+                size = (uint32_t)(ftell(w->fp) - w->data_offset);
+                fseek(w->fp, w->data_offset, SEEK_SET);
+            }
+            break;
+        } else {
+            fseek(w->fp, (long)(size + (size & 1)), SEEK_CUR);
+        }
+    }
+
+    w->is_float = (format == WAVE_FORMAT_IEEE_FLOAT);
+    if (!((format == WAVE_FORMAT_PCM && (w->bits == 16 || w->bits == 24 || w->bits == 32)) ||
+          (w->is_float && w->bits == 32)) ||
+        w->channels == 0 || w->block_align != w->channels * (w->bits / 8)) {
+        snprintf(err, err_len, "unsupported format %u, %u bit", (unsigned)format, (unsigned)w->bits);
+        goto fail;
+    }
+
+    long end;
+    fseek(w->fp, 0, SEEK_END);
+    end = ftell(w->fp);
+    fseek(w->fp, w->data_offset, SEEK_SET);
+    w->samples = (uint64_t)(end - w->data_offset) / w->block_align;
+    return 0;
+
+fail:
+    fclose(w->fp);
+    w->fp = NULL;
+    return -1;
+}
+
+void wav_reader_close(wav_reader_t *w)
+{
+    if (w->fp) fclose(w->fp);
+    free(w->scratch);
+    memset(w, 0, sizeof(*w));
+}
+
+int wav_reader_seek(wav_reader_t *w, uint64_t pos)
+{
+    return fseek(w->fp, (long)(w->data_offset + pos * w->block_align), SEEK_SET);
+}
+
+size_t wav_reader_read(wav_reader_t *w, int32_t *out, size_t count)
+{
+    size_t need = count * w->block_align;
+    if (w->scratch_len < need) {
+        uint8_t *p = realloc(w->scratch, need);
+        if (!p) return 0;
+        w->scratch = p;
+        w->scratch_len = need;
+    }
+
+    size_t n = fread(w->scratch, w->block_align, count, w->fp);
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t *s = w->scratch + i * w->block_align;
+        int32_t v;
+        if (w->is_float) {
+            uint32_t bits = le32(s);
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            if (f > 1.0f)  f = 1.0f;
+            if (f < -1.0f) f = -1.0f;
+            v = (int32_t)lrintf(f * 8388607.0f) << 8;
+        } else if (w->bits == 16) {
+            v = (int32_t)((uint32_t)le16(s) << 16);
+        } else if (w->bits == 24) {
+            v = (int32_t)(((uint32_t)s[0] << 8) | ((uint32_t)s[1] << 16) | ((uint32_t)s[2] << 24));
+        } else {
+            v = (int32_t)(le32(s) & 0xFFFFFF00u);
+        }
+        out[i] = v;
+    }
+    return n;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Minimal RIFF/WAVE reader for archived recordings: integer PCM (16, 24,
+ * 32 bit) and 32-bit float, plain or WAVE_FORMAT_EXTENSIBLE. Samples come
+ * back in the layout the pipeline reads from the INMP441: 24-bit,
+ * left-aligned in 32 bits. Only the first channel is used.
+ */
+
+typedef struct {
+    FILE *fp;
+    uint32_t sample_rate;
+    uint16_t channels;
+    uint16_t bits;
+    uint16_t block_align;       // bytes per sample frame, all channels
+    int is_float;
+    long data_offset;
+    uint64_t samples;           // per channel
+    uint8_t *scratch;
+    size_t scratch_len;
+} wav_reader_t;
+
+// Returns 0 on success, -1 with a message in err otherwise
+int wav_reader_open(wav_reader_t *w, const char *path, char *err, size_t err_len);
+void wav_reader_close(wav_reader_t *w);
+
+// Position at sample index `pos` (per channel)
+int wav_reader_seek(wav_reader_t *w, uint64_t pos);
+
+// Read up to `count` samples of the first channel; returns the number read
+size_t wav_reader_read(wav_reader_t *w, int32_t *out, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,60 @@
+# Shared by the host tool builds under tools/: device sources compiled
+# natively against the project's sdkconfig.
+
+# das_host_sdkconfig(<sdkconfig> <out_dir> [NAME=VALUE ...])
+#
+# Writes <out_dir>/sdkconfig.h the way the IDF build does (bools as 1,
+# unset options left undefined) and sets every CONFIG_* as a variable in
+# the caller's scope. NAME=VALUE pairs are Kconfig defaults for options the
+# sdkconfig does not list yet; they are used only when it lacks them.
+function(das_host_sdkconfig SDKCONFIG OUT_DIR)
+    file(MAKE_DIRECTORY "${OUT_DIR}")
+    set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS "${SDKCONFIG}")
+    file(STRINGS "${SDKCONFIG}" lines REGEX "^CONFIG_[A-Za-z0-9_]+=")
+
+    set(header "#pragma once\n// Generated from ${SDKCONFIG}\n")
+    set(names "")
+    foreach(line IN LISTS lines)
+        string(REGEX MATCH "^(CONFIG_[A-Za-z0-9_]+)=(.*)$" _ "${line}")
+        set(name "${CMAKE_MATCH_1}")
+        set(value "${CMAKE_MATCH_2}")
+        if(value STREQUAL "y")
+            set(value 1)
+        endif()
+        string(APPEND header "#define ${name} ${value}\n")
+        set(${name} "${value}" PARENT_SCOPE)
+        list(APPEND names "${name}")
+    endforeach()
+
+    foreach(pair IN LISTS ARGN)
+        string(REGEX MATCH "^([A-Za-z0-9_]+)=(.*)$" _ "${pair}")
+        set(name "${CMAKE_MATCH_1}")
+        if(NOT name IN_LIST names)
+            string(APPEND header "#define ${name} ${CMAKE_MATCH_2} // Kconfig default\n")
+            set(${name} "${CMAKE_MATCH_2}" PARENT_SCOPE)
+        endif()
+    endforeach()
+
+    file(WRITE "${OUT_DIR}/sdkconfig.h.tmp" "${header}")
+    configure_file("${OUT_DIR}/sdkconfig.h.tmp" "${OUT_DIR}/sdkconfig.h" COPYONLY)
+endfunction()
+
+# das_host_dsp_tables(<out_dir> <sample_rate>)
+#
+# Same tables as components/dsp/CMakeLists.txt generates for the device;
+# adds a custom command producing <out_dir>/dsp_tables.c and .h.
+function(das_host_dsp_tables OUT_DIR SAMPLE_RATE)
+    set(dsp_dir "${CMAKE_CURRENT_FUNCTION_LIST_DIR}/../../components/dsp")
+    file(STRINGS "${dsp_dir}/../audio_pipeline/audio_frame.h" feature_frame
+         REGEX "^#define AUDIO_FEATURE_FRAME_SAMPLES[ \t]+[0-9]+")
+    string(REGEX REPLACE ".*[ \t]([0-9]+).*" "\\1" fft_size "${feature_frame}")
+    set(mel_bands 24)
+    add_custom_command(
+        OUTPUT "${OUT_DIR}/dsp_tables.c" "${OUT_DIR}/dsp_tables.h"
+        COMMAND Python3::Interpreter "${dsp_dir}/gen_tables.py"
+                ${fft_size} ${SAMPLE_RATE} ${mel_bands}
+                "${OUT_DIR}/dsp_tables.h" "${OUT_DIR}/dsp_tables.c"
+        DEPENDS "${dsp_dir}/gen_tables.py"
+        COMMENT "Generating DSP tables (${fft_size}-point FFT)"
+        VERBATIM)
+endfunction()
@@ -0,0 +1,346 @@
+#!/usr/bin/env python3
+"""
+rtp_receiver.py - host-side receiver for the ESP32 RTP audio sink.
+
+Listens for the L16 / DVI4 RTP stream sent by components/rtp_stream and
+reports, per interval and at exit:
+  * packet loss, duplicates and reordering from the sequence numbers
+    (RFC 3550 A.3)
+  * interarrival jitter from the timestamps (RFC 3550 A.8)
+  * latency: the device clock is not synchronized with the host, so for a
+    real device the latency is reported relative to the fastest packet seen
+    (queueing and retransmission delay on top of the best case). With
+    --standin a local sender emulates the device on the same clock and the
+    absolute end-to-end latency (end of the packet's samples -> arrival) is
+    reported as well.
+
+Examples:
+  python3 tools/rtp_receiver.py --port 5004 --wav out.wav
+  python3 tools/rtp_receiver.py --standin --loss 2 --jitter 15 --duration 10
+  python3 tools/rtp_receiver.py --sdp > esp32.sdp && ffplay -protocol_whitelist file,udp,rtp esp32.sdp
+  python3 tools/rtp_receiver.py --rate 48000 --wav out.wav
+
+The RTP clock is the device's capture rate (CONFIG_MIC_INPUT_SAMPLE_RATE);
+--rate must match it for L16. DVI4 is 16 kHz only.
+
+Standard library only.
+"""
+
+import argparse
+import math
+import random
+import socket
+import struct
+import threading
+import time
+import wave
+
+DEFAULT_RATE = 16000
+DVI4_RATE = 16000           # static payload type 6 (RFC 3551)
+PT_L16 = 96
+PT_DVI4 = 6
+
+# IMA ADPCM tables (shared with components/dsp/ima_adpcm.c)
+STEP_TABLE = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767,
+]
+INDEX_TABLE = [-1, -1, -1, -1, 2, 4, 6, 8]
+
+
+def dvi4_decode(payload):
+    """RFC 3551 4.5.1: 4-byte state header, first sample in the high nibble."""
+    pred, index = struct.unpack_from(">hB", payload, 0)
+    out = []
+    for byte in payload[4:]:
+        for code in (byte >> 4, byte & 0x0F):
+            step = STEP_TABLE[index]
+            diff = step >> 3
+            if code & 4:
+                diff += step
+            if code & 2:
+                diff += step >> 1
+            if code & 1:
+                diff += step >> 2
+            pred = pred - diff if code & 8 else pred + diff
+            pred = max(-32768, min(32767, pred))
+            index = max(0, min(88, index + INDEX_TABLE[code & 7]))
+            out.append(pred)
+    return struct.pack("<%dh" % len(out), *out)
+
+
+def l16_decode(payload):
+    n = len(payload) // 2
+    return struct.pack("<%dh" % n, *struct.unpack(">%dh" % n, payload[: 2 * n]))
+
+
+def percentile(values, p):
+    if not values:
+        return float("nan")
+    s = sorted(values)
+    return s[min(len(s) - 1, int(p / 100.0 * len(s)))]
+
+
+class Stats:
+    """Receiver state for one SSRC, following RFC 3550 appendix A."""
+
+    def __init__(self, ssrc, seq, rate):
+        self.ssrc = ssrc
+        self.rate = rate           # RTP clock, Hz
+        self.base_seq = seq
+        self.max_seq = seq
+        self.cycles = 0
+        self.received = 0
+        self.duplicates = 0
+        self.reordered = 0
+        self.jitter = 0.0          # timestamp units
+        self.last_transit = None
+        self.min_transit = None
+        self.seen = set()
+        self.latency_rel = []      # ms over the fastest packet
+        self.latency_abs = []      # ms, stand-in only
+        self.bytes = 0
+
+    def extended(self, seq):
+        """Extend a 16-bit sequence number around the current maximum."""
+        delta = (seq - self.max_seq) & 0xFFFF
+        if delta < 0x8000:
+            if seq < self.max_seq:
+                self.cycles += 0x10000
+            self.max_seq = seq
+            return self.cycles + seq, False
+        # Older than max_seq: late or duplicate
+        return self.cycles + seq - (0x10000 if seq > self.max_seq else 0), True
+
+    def packet(self, seq, ts, arrival, payload_len, capture_end=None):
+        ext, late = self.extended(seq)
+        if ext in self.seen:
+            self.duplicates += 1
+            return False
+        self.seen.add(ext)
+        if len(self.seen) > 65536:
+            self.seen = {s for s in self.seen if s > ext - 32768}
+        if late:
+            self.reordered += 1
+        self.received += 1
+        self.bytes += payload_len
+
+        # Transit in timestamp units; only differences are meaningful
+        transit = arrival * self.rate - ts
+        if self.last_transit is not None:
+            d = abs(transit - self.last_transit)
+            self.jitter += (d - self.jitter) / 16.0
+        self.last_transit = transit
+        if self.min_transit is None or transit < self.min_transit:
+            self.min_transit = transit
+        self.latency_rel.append((transit - self.min_transit) * 1000.0 / self.rate)
+        if capture_end is not None:
+            self.latency_abs.append((arrival - capture_end) * 1000.0)
+        return True
+
+    def expected(self):
+        return self.cycles + self.max_seq - self.base_seq + 1
+
+    def report(self, label):
+        expected = self.expected()
+        lost = max(0, expected - self.received)
+        line = ("%s ssrc %08x: %d pkts, lost %d (%.2f%%), dup %d, reordered %d, "
+                "jitter %.2f ms" % (
+                    label, self.ssrc, self.received, lost,
+                    100.0 * lost / expected if expected else 0.0,
+                    self.duplicates, self.reordered,
+                    self.jitter * 1000.0 / self.rate))
+        if self.latency_rel:
+            line += ", latency over best p50 %.1f / p95 %.1f / max %.1f ms" % (
+                percentile(self.latency_rel, 50), percentile(self.latency_rel, 95),
+                max(self.latency_rel))
+        if self.latency_abs:
+            line += ", end-to-end p50 %.1f / p95 %.1f / max %.1f ms" % (
+                percentile(self.latency_abs, 50), percentile(self.latency_abs, 95),
+                max(self.latency_abs))
+        print(line, flush=True)
+
+
+class StandIn(threading.Thread):
+    """Emulates the device: 32 ms frames split into ptime packets, sent when
+    the frame completes, with optional random loss and delay."""
+
+    FRAME_MS = 32
+
+    def __init__(self, port, rate, ptime_ms, loss_pct, jitter_ms):
+        super().__init__(daemon=True)
+        self.dest = ("127.0.0.1", port)
+        self.rate = rate
+        self.frame_samples = rate * self.FRAME_MS // 1000
+        self.packet_samples = rate * ptime_ms // 1000
+        self.loss = loss_pct / 100.0
+        self.jitter = jitter_ms / 1000.0
+        self.ssrc = random.getrandbits(32)
+        self.seq0 = random.getrandbits(16)
+        self.ts0 = random.getrandbits(32)
+        self.start_time = None
+        self.stop = threading.Event()
+
+    def capture_end(self, ts, samples):
+        """Host time at which the packet's last sample was captured."""
+        offset = (ts - self.ts0) & 0xFFFFFFFF
+        return self.start_time + (offset + samples) / self.rate
+
+    def run(self):
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.start_time = time.monotonic()
+        seq, sample = self.seq0, 0
+        pending = bytearray()
+        pending_start = 0
+        frame = 0
+        while not self.stop.is_set():
+            frame += 1
+            frame_end = self.start_time + frame * self.frame_samples / self.rate
+            delay = frame_end - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+            for _ in range(self.frame_samples):
+                v = int(8000 * math.sin(2 * math.pi * 440 * sample / self.rate))
+                pending += struct.pack(">h", v)
+                sample += 1
+                if len(pending) == 2 * self.packet_samples:
+                    hdr = struct.pack(">BBHII", 0x80, PT_L16, seq & 0xFFFF,
+                                      (self.ts0 + pending_start) & 0xFFFFFFFF, self.ssrc)
+                    if random.random() >= self.loss:
+                        if self.jitter:
+                            time.sleep(random.uniform(0, self.jitter))
+                        sock.sendto(hdr + bytes(pending), self.dest)
+                    seq += 1
+                    pending_start = sample
+                    pending = bytearray()
+
+
+def sdp(port, payload, rate):
+    if payload == "l16":
+        rtpmap = "a=rtpmap:%d L16/%d/1" % (PT_L16, rate)
+    else:
+        rtpmap = "a=rtpmap:%d DVI4/%d/1" % (PT_DVI4, DVI4_RATE)
+    pt = PT_L16 if payload == "l16" else PT_DVI4
+    return "\n".join([
+        "v=0",
+        "o=- 0 0 IN IP4 127.0.0.1",
+        "s=ESP32 audio",
+        "c=IN IP4 0.0.0.0",
+        "t=0 0",
+        "m=audio %d RTP/AVP %d" % (port, pt),
+        rtpmap,
+        "",
+    ])
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    ap.add_argument("--port", type=int, default=5004)
+    ap.add_argument("--bind", default="0.0.0.0")
+    ap.add_argument("--group", help="multicast group to join")
+    ap.add_argument("--rate", type=int, default=DEFAULT_RATE,
+                    help="RTP clock = device capture rate in Hz (default %d)" % DEFAULT_RATE)
+    ap.add_argument("--interval", type=float, default=5.0, help="report period (s)")
+    ap.add_argument("--duration", type=float, default=0, help="stop after N s (0 = run until ^C)")
+    ap.add_argument("--wav", help="write received audio here, lost packets as silence")
+    ap.add_argument("--sdp", choices=["l16", "dvi4"], nargs="?", const="l16",
+                    help="print an SDP description for ffplay / VLC and exit")
+    ap.add_argument("--standin", action="store_true", help="emulate the device on localhost")
+    ap.add_argument("--ptime", type=int, default=32, help="stand-in packet time (ms)")
+    ap.add_argument("--loss", type=float, default=0, help="stand-in packet loss (%%)")
+    ap.add_argument("--jitter", type=float, default=0, help="stand-in max extra delay (ms)")
+    args = ap.parse_args()
+    if args.sdp == "dvi4" and args.rate != DVI4_RATE:
+        ap.error("DVI4 is sent at %d Hz only" % DVI4_RATE)
+
+    if args.sdp:
+        print(sdp(args.port, args.sdp, args.rate), end="")
+        return
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind((args.bind, args.port))
+    if args.group:
+        mreq = socket.inet_aton(args.group) + socket.inet_aton("0.0.0.0")
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+    sock.settimeout(0.5)
+
+    standin = None
+    if args.standin:
+        standin = StandIn(args.port, args.rate, args.ptime, args.loss, args.jitter)
+        standin.start()
+
+    wav = None
+    if args.wav:
+        wav = wave.open(args.wav, "wb")
+        wav.setnchannels(1)
+        wav.setsampwidth(2)
+        wav.setframerate(args.rate)
+
+    stats = None
+    next_ts = None
+    start = time.monotonic()
+    next_report = start + args.interval
+    try:
+        while not args.duration or time.monotonic() - start < args.duration:
+            try:
+                data = sock.recv(65536)     # L16 at 48 kHz exceeds one MTU
+            except socket.timeout:
+                data = None
+            now = time.monotonic()
+
+            if data and len(data) >= 12 and (data[0] >> 6) == 2:
+                cc = data[0] & 0x0F
+                pt = data[1] & 0x7F
+                seq, ts, ssrc = struct.unpack_from(">HII", data, 2)
+                payload = data[12 + 4 * cc:]
+                if pt == PT_DVI4:
+                    pcm = dvi4_decode(payload)
+                else:
+                    pcm = l16_decode(payload)
+                samples = len(pcm) // 2
+
+                if stats is None or stats.ssrc != ssrc:
+                    if stats:
+                        stats.report("previous")
+                    stats = Stats(ssrc, seq, DVI4_RATE if pt == PT_DVI4 else args.rate)
+                    next_ts = None
+
+                capture_end = standin.capture_end(ts, samples) if standin else None
+                if stats.packet(seq, ts, now, len(payload), capture_end) and wav:
+                    # In-order audio only; gaps are filled with silence
+                    if next_ts is not None:
+                        gap = (ts - next_ts) & 0xFFFFFFFF
+                        if gap >= 0x80000000:
+                            pcm = b""       # late packet, already skipped
+                        elif gap:
+                            wav.writeframes(b"\x00\x00" * min(gap, args.rate))
+                    if pcm:
+                        wav.writeframes(pcm)
+                        next_ts = (ts + samples) & 0xFFFFFFFF
+
+            if now >= next_report:
+                if stats:
+                    stats.report("%6.1fs" % (now - start))
+                else:
+                    print("%6.1fs no packets on port %d" % (now - start, args.port), flush=True)
+                next_report += args.interval
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if standin:
+            standin.stop.set()
+        if wav:
+            wav.close()
+
+    if stats:
+        stats.report("total")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sdkconfig.h"
+
+/*
+ * Host build: the FreeRTOS subset the transport sources use, on pthreads.
+ * Tasks are threads (priorities and core affinity ignored), queues and
+ * mutexes are a mutex plus condition variables, and a tick lasts
+ * 1000 / CONFIG_FREERTOS_HZ ms as on the device.
+ */
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE                 0
+#define pdTRUE                  1
+#define pdPASS                  pdTRUE
+#define pdFAIL                  pdFALSE
+#define portMAX_DELAY           ((TickType_t)0xFFFFFFFFu)
+#define portTICK_PERIOD_MS      (1000 / CONFIG_FREERTOS_HZ)
+#define pdMS_TO_TICKS(ms)       ((TickType_t)((uint64_t)(ms) * CONFIG_FREERTOS_HZ / 1000))
+#define tskNO_AFFINITY          0x7FFFFFFF
+
+#define configASSERT(x)         do { if (!(x)) abort(); } while (0)
@@ -0,0 +1,243 @@
+/**
+ * @file freertos_host.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Host build: FreeRTOS tasks, queues and mutexes on pthreads, for
+ *        running the WebSocket transport sources natively.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+struct host_task {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    char name[16];
+};
+
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+struct host_mutex {
+    pthread_mutex_t lock;
+};
+
+static struct timespec deadline_after(TickType_t ticks)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ns = (uint64_t)ticks * (1000000000ull / CONFIG_FREERTOS_HZ);
+    ts.tv_sec += (time_t)(ns / 1000000000ull);
+    ts.tv_nsec += (long)(ns % 1000000000ull);
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+// Wait on `cond` until `ready` holds; false on timeout. Called with the lock held.
+#define WAIT_UNTIL(ready, cond, lock, ticks, deadline)                          \
+    while (!(ready)) {                                                          \
+        if ((ticks) == 0) break;                                                \
+        if ((ticks) == portMAX_DELAY) {                                         \
+            pthread_cond_wait(cond, lock);                                      \
+        } else if (pthread_cond_timedwait(cond, lock, deadline) == ETIMEDOUT) { \
+            break;                                                              \
+        }                                                                       \
+    }
+
+static void cond_init(pthread_cond_t *c)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(c, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+// ---------------------------------------------------------------------------
+// Tasks
+
+static void *task_entry(void *arg)
+{
+    struct host_task *t = arg;
+    pthread_setname_np(pthread_self(), t->name);
+    t->fn(t->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                                   void *arg, UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core)
+{
+    (void)stack_depth;
+    (void)priority;
+    (void)core;
+
+    struct host_task *t = calloc(1, sizeof(*t));
+    if (!t) return pdFAIL;
+    t->fn = fn;
+    t->arg = arg;
+    strncpy(t->name, name ? name : "task", sizeof(t->name) - 1);
+
+    if (pthread_create(&t->thread, NULL, task_entry, t) != 0) {
+        free(t);
+        return pdFAIL;
+    }
+    pthread_detach(t->thread);
+    if (handle) *handle = t;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (!task) pthread_exit(NULL);
+    pthread_cancel(task->thread);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts = deadline_after(ticks);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)(((uint64_t)ts.tv_sec * 1000ull + ts.tv_nsec / 1000000) * CONFIG_FREERTOS_HZ / 1000);
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+    (void)task;
+    return 5;
+}
+
+// ---------------------------------------------------------------------------
+// Queues
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    struct host_queue *q = calloc(1, sizeof(*q));
+    if (!q) return NULL;
+    q->items = calloc(length, item_size);
+    if (!q->items) {
+        free(q);
+        return NULL;
+    }
+    q->length = length;
+    q->item_size = item_size;
+    pthread_mutex_init(&q->lock, NULL);
+    cond_init(&q->not_empty);
+    cond_init(&q->not_full);
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+    if (!q) return;
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_cond_destroy(&q->not_full);
+    free(q->items);
+    free(q);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t q, const void *item, TickType_t wait)
+{
+    struct timespec deadline = deadline_after(wait == portMAX_DELAY ? 0 : wait);
+    BaseType_t ok = pdFALSE;
+
+    pthread_mutex_lock(&q->lock);
+    WAIT_UNTIL(q->count < q->length, &q->not_full, &q->lock, wait, &deadline);
+    if (q->count < q->length) {
+        UBaseType_t tail = (q->head + q->count) % q->length;
+        memcpy(q->items + (size_t)tail * q->item_size, item, q->item_size);
+        q->count++;
+        pthread_cond_signal(&q->not_empty);
+        ok = pdTRUE;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ok;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait)
+{
+    struct timespec deadline = deadline_after(wait == portMAX_DELAY ? 0 : wait);
+    BaseType_t ok = pdFALSE;
+
+    pthread_mutex_lock(&q->lock);
+    WAIT_UNTIL(q->count > 0, &q->not_empty, &q->lock, wait, &deadline);
+    if (q->count > 0) {
+        memcpy(item, q->items + (size_t)q->head * q->item_size, q->item_size);
+        q->head = (q->head + 1) % q->length;
+        q->count--;
+        pthread_cond_signal(&q->not_full);
+        ok = pdTRUE;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ok;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t n = q->count;
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t n = q->length - q->count;
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
+
+// ---------------------------------------------------------------------------
+// Mutexes (only ever taken with portMAX_DELAY by the transport)
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    struct host_mutex *m = calloc(1, sizeof(*m));
+    if (m) pthread_mutex_init(&m->lock, NULL);
+    return m;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t m, TickType_t wait)
+{
+    if (wait == portMAX_DELAY) {
+        return pthread_mutex_lock(&m->lock) == 0 ? pdTRUE : pdFALSE;
+    }
+    if (pthread_mutex_trylock(&m->lock) == 0) return pdTRUE;
+    if (wait == 0) return pdFALSE;
+
+    vTaskDelay(wait);
+    return pthread_mutex_trylock(&m->lock) == 0 ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t m)
+{
+    return pthread_mutex_unlock(&m->lock) == 0 ? pdTRUE : pdFALSE;
+}
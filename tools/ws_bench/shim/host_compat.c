@@ -0,0 +1,23 @@
+/**
+ * @file host_compat.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Host build: libc functions newlib provides on the device but
+ *        older glibc lacks.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include "host_compat.h"
+
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+    if (size) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#endif
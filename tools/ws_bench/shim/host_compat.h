@@ -0,0 +1,10 @@
+#pragma once
+// Host build: forced into every translation unit (-include)
+
+#include <stddef.h>
+#include <string.h>
+
+// newlib has strlcpy; glibc only from 2.38
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+size_t strlcpy(char *dst, const char *src, size_t size);
+#endif
@@ -0,0 +1,92 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/*
+ * Host build: the lwIP netconn subset the web sources use, on POSIX TCP
+ * sockets. Each connection has a reader thread that plays the tcpip
+ * thread: it cuts the byte stream into netbufs of at most one MSS, posts
+ * them to the receive mailbox and then raises NETCONN_EVT_RCVPLUS through
+ * conn->callback. netconn_write blocks until the kernel took every byte,
+ * like a netconn without a send timeout; the send buffer is sized to the
+ * sdkconfig's TCP_SND_BUF so a slow reader backs up as soon as on the
+ * device (see lwip_host_set_sndbuf).
+ */
+
+typedef int8_t err_t;
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+
+#define ERR_OK          0
+#define ERR_MEM         -1
+#define ERR_TIMEOUT     -3
+#define ERR_VAL         -6
+#define ERR_USE         -8
+#define ERR_CONN        -11
+#define ERR_ABRT        -13
+#define ERR_RST         -14
+#define ERR_CLSD        -15
+#define ERR_ARG         -16
+
+#define NETCONN_NOFLAG  0x00
+#define NETCONN_NOCOPY  0x00
+#define NETCONN_COPY    0x01
+
+enum netconn_type {
+    NETCONN_TCP = 0x10,
+};
+
+enum netconn_evt {
+    NETCONN_EVT_RCVPLUS,
+    NETCONN_EVT_RCVMINUS,
+    NETCONN_EVT_SENDPLUS,
+    NETCONN_EVT_SENDMINUS,
+    NETCONN_EVT_ERROR,
+};
+
+typedef struct {
+    u32_t addr;
+} ip_addr_t;
+
+struct netconn;
+typedef void (*netconn_callback)(struct netconn *conn, enum netconn_evt evt, u16_t len);
+
+struct netbuf {
+    void *data;
+    u16_t len;
+    struct netbuf *next;            // receive mailbox link
+};
+
+struct netconn {
+    netconn_callback callback;
+
+    // Host implementation
+    int fd;
+    int recv_timeout_ms;            // 0 = block
+    pthread_mutex_t lock;
+    pthread_cond_t readable;
+    struct netbuf *head;            // receive mailbox
+    struct netbuf *tail;
+    int eof;
+    atomic_int refs;                // owner + reader thread
+};
+
+struct netconn *netconn_new(enum netconn_type type);
+err_t netconn_bind(struct netconn *conn, const ip_addr_t *addr, u16_t port);
+err_t netconn_listen(struct netconn *conn);
+err_t netconn_accept(struct netconn *conn, struct netconn **new_conn);
+err_t netconn_recv(struct netconn *conn, struct netbuf **new_buf);
+err_t netconn_write(struct netconn *conn, const void *data, size_t size, u8_t flags);
+err_t netconn_close(struct netconn *conn);
+err_t netconn_delete(struct netconn *conn);
+
+#define netconn_set_recvtimeout(conn, ms)   ((conn)->recv_timeout_ms = (ms))
+
+err_t netbuf_data(struct netbuf *buf, void **data, u16_t *len);
+void netbuf_delete(struct netbuf *buf);
+
+// Send buffer of accepted connections in bytes; 0 keeps the kernel default
+void lwip_host_set_sndbuf(int bytes);
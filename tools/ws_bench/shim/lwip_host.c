@@ -0,0 +1,247 @@
+/**
+ * @file lwip_host.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Host build: lwIP netconn API on POSIX TCP sockets, with one reader
+ *        thread per connection standing in for the tcpip thread.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "sdkconfig.h"
+#include "lwip/api.h"
+
+#ifdef CONFIG_LWIP_TCP_MSS
+#define HOST_MSS    CONFIG_LWIP_TCP_MSS
+#else
+#define HOST_MSS    1440
+#endif
+
+static int s_sndbuf;
+
+void lwip_host_set_sndbuf(int bytes)
+{
+    s_sndbuf = bytes;
+}
+
+static struct netconn *conn_alloc(int fd, int refs)
+{
+    struct netconn *c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    c->fd = fd;
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&c->readable, &attr);
+    pthread_condattr_destroy(&attr);
+    atomic_init(&c->refs, refs);
+    return c;
+}
+
+static void conn_unref(struct netconn *c)
+{
+    if (atomic_fetch_sub(&c->refs, 1) != 1) return;
+
+    if (c->fd >= 0) close(c->fd);
+    struct netbuf *b = c->head;
+    while (b) {
+        struct netbuf *next = b->next;
+        free(b);
+        b = next;
+    }
+    pthread_mutex_destroy(&c->lock);
+    pthread_cond_destroy(&c->readable);
+    free(c);
+}
+
+static void raise_event(struct netconn *c, u16_t len)
+{
+    netconn_callback cb = __atomic_load_n(&c->callback, __ATOMIC_ACQUIRE);
+    if (cb) cb(c, NETCONN_EVT_RCVPLUS, len);
+}
+
+// One MSS per netbuf, mailbox post, then the event, as the tcpip thread does
+static void *reader_thread(void *arg)
+{
+    struct netconn *c = arg;
+
+    for (;;) {
+        struct netbuf *b = malloc(sizeof(*b) + HOST_MSS + 1);
+        if (!b) break;
+        ssize_t n = recv(c->fd, (char *)(b + 1), HOST_MSS, 0);
+        if (n <= 0) {
+            free(b);
+            break;
+        }
+        b->data = b + 1;
+        b->len = (u16_t)n;
+        b->next = NULL;
+        ((char *)b->data)[n] = '\0';     // requests are parsed with strstr
+
+        pthread_mutex_lock(&c->lock);
+        if (c->tail) c->tail->next = b;
+        else c->head = b;
+        c->tail = b;
+        pthread_cond_signal(&c->readable);
+        // Raised before anyone can take the netbuf: on the device the tcpip
+        // thread outranks the tasks, so a callback installed after the
+        // handshake was read never sees that handshake's event
+        raise_event(c, (u16_t)n);
+        pthread_mutex_unlock(&c->lock);
+    }
+
+    pthread_mutex_lock(&c->lock);
+    c->eof = 1;
+    pthread_cond_broadcast(&c->readable);
+    raise_event(c, 0);
+    pthread_mutex_unlock(&c->lock);
+
+    conn_unref(c);
+    return NULL;
+}
+
+struct netconn *netconn_new(enum netconn_type type)
+{
+    (void)type;
+    return conn_alloc(-1, 1);
+}
+
+err_t netconn_bind(struct netconn *conn, const ip_addr_t *addr, u16_t port)
+{
+    conn->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (conn->fd < 0) return ERR_MEM;
+
+    int one = 1;
+    setsockopt(conn->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in sa = { 0 };
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    sa.sin_addr.s_addr = addr ? addr->addr : htonl(INADDR_ANY);
+    return bind(conn->fd, (struct sockaddr *)&sa, sizeof(sa)) == 0 ? ERR_OK : ERR_USE;
+}
+
+err_t netconn_listen(struct netconn *conn)
+{
+    return listen(conn->fd, 16) == 0 ? ERR_OK : ERR_VAL;
+}
+
+err_t netconn_accept(struct netconn *conn, struct netconn **new_conn)
+{
+    int fd;
+    do {
+        fd = accept(conn->fd, NULL, NULL);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) return ERR_ABRT;
+
+    if (s_sndbuf > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &s_sndbuf, sizeof(s_sndbuf));
+    }
+
+    struct netconn *c = conn_alloc(fd, 2);
+    if (!c) {
+        close(fd);
+        return ERR_MEM;
+    }
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, reader_thread, c) != 0) {
+        atomic_store(&c->refs, 1);
+        conn_unref(c);
+        return ERR_MEM;
+    }
+    pthread_detach(thread);
+
+    *new_conn = c;
+    return ERR_OK;
+}
+
+err_t netconn_recv(struct netconn *conn, struct netbuf **new_buf)
+{
+    *new_buf = NULL;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += conn->recv_timeout_ms / 1000;
+    deadline.tv_nsec += (long)(conn->recv_timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    err_t err = ERR_OK;
+    pthread_mutex_lock(&conn->lock);
+    while (!conn->head && !conn->eof) {
+        if (conn->recv_timeout_ms <= 0) {
+            pthread_cond_wait(&conn->readable, &conn->lock);
+        } else if (pthread_cond_timedwait(&conn->readable, &conn->lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    if (conn->head) {
+        *new_buf = conn->head;
+        conn->head = conn->head->next;
+        if (!conn->head) conn->tail = NULL;
+        (*new_buf)->next = NULL;
+    } else {
+        err = conn->eof ? ERR_CLSD : ERR_TIMEOUT;
+    }
+    pthread_mutex_unlock(&conn->lock);
+    return err;
+}
+
+err_t netconn_write(struct netconn *conn, const void *data, size_t size, u8_t flags)
+{
+    (void)flags;
+    const char *p = data;
+    while (size > 0) {
+        ssize_t n = send(conn->fd, p, size, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == ECONNRESET ? ERR_RST : ERR_CONN;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return ERR_OK;
+}
+
+err_t netconn_close(struct netconn *conn)
+{
+    if (conn->fd >= 0) shutdown(conn->fd, SHUT_RDWR);
+    return ERR_OK;
+}
+
+err_t netconn_delete(struct netconn *conn)
+{
+    if (!conn) return ERR_ARG;
+    __atomic_store_n(&conn->callback, NULL, __ATOMIC_RELEASE);
+    if (conn->fd >= 0) shutdown(conn->fd, SHUT_RDWR);
+    conn_unref(conn);
+    return ERR_OK;
+}
+
+err_t netbuf_data(struct netbuf *buf, void **data, u16_t *len)
+{
+    if (!buf) {
+        *data = NULL;
+        *len = 0;
+        return ERR_ARG;
+    }
+    *data = buf->data;
+    *len = buf->len;
+    return ERR_OK;
+}
+
+void netbuf_delete(struct netbuf *buf)
+{
+    free(buf);
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <stddef.h>
+
+#define MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL     -0x002A
+
+/*
+ * Host build: as mbedtls, *olen gets the size needed (including the
+ * terminating NUL) when dst is too small, the encoded length otherwise.
+ * olen is unsigned int: websocket.c passes one, which is size_t on the
+ * 32-bit target but would be overrun by a 64-bit size_t store here.
+ */
+int mbedtls_base64_encode(unsigned char *dst, size_t dlen, unsigned int *olen,
+                          const unsigned char *src, size_t slen);
@@ -0,0 +1,5 @@
+#pragma once
+#include <stddef.h>
+
+// Host build: one-shot SHA-1 for the WebSocket handshake
+int mbedtls_sha1(const unsigned char *input, size_t ilen, unsigned char output[20]);
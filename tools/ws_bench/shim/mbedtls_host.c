@@ -0,0 +1,109 @@
+/**
+ * @file mbedtls_host.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Host build: the SHA-1 and base64 the WebSocket handshake needs,
+ *        in place of mbedtls.
+ * @version 0.1
+ * @date 2025-12-15
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "mbedtls/sha1.h"
+#include "mbedtls/base64.h"
+
+static uint32_t rol(uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+static void sha1_block(uint32_t h[5], const unsigned char *p)
+{
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 |
+               (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+        else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+        else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+        else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+        uint32_t t = rol(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rol(b, 30);
+        b = a;
+        a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+int mbedtls_sha1(const unsigned char *input, size_t ilen, unsigned char output[20])
+{
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    size_t done = 0;
+    for (; ilen - done >= 64; done += 64) {
+        sha1_block(h, input + done);
+    }
+
+    // Tail, the 0x80 marker and the bit length, in one or two blocks
+    unsigned char tail[128] = { 0 };
+    size_t rest = ilen - done;
+    memcpy(tail, input + done, rest);
+    tail[rest] = 0x80;
+    size_t blocks = rest < 56 ? 1 : 2;
+    uint64_t bits = (uint64_t)ilen * 8;
+    for (int i = 0; i < 8; i++) {
+        tail[blocks * 64 - 1 - i] = (unsigned char)(bits >> (8 * i));
+    }
+    for (size_t b = 0; b < blocks; b++) {
+        sha1_block(h, tail + 64 * b);
+    }
+
+    for (int i = 0; i < 5; i++) {
+        output[4 * i]     = (unsigned char)(h[i] >> 24);
+        output[4 * i + 1] = (unsigned char)(h[i] >> 16);
+        output[4 * i + 2] = (unsigned char)(h[i] >> 8);
+        output[4 * i + 3] = (unsigned char)h[i];
+    }
+    return 0;
+}
+
+int mbedtls_base64_encode(unsigned char *dst, size_t dlen, unsigned int *olen,
+                          const unsigned char *src, size_t slen)
+{
+    static const char ALPHABET[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t need = (slen + 2) / 3 * 4;
+
+    if (!dst || dlen < need + 1) {
+        *olen = (unsigned int)(need + 1);
+        return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+    }
+
+    unsigned char *p = dst;
+    for (size_t i = 0; i < slen; i += 3) {
+        uint32_t v = (uint32_t)src[i] << 16;
+        if (i + 1 < slen) v |= (uint32_t)src[i + 1] << 8;
+        if (i + 2 < slen) v |= src[i + 2];
+        *p++ = ALPHABET[(v >> 18) & 63];
+        *p++ = ALPHABET[(v >> 12) & 63];
+        *p++ = i + 1 < slen ? ALPHABET[(v >> 6) & 63] : '=';
+        *p++ = i + 2 < slen ? ALPHABET[v & 63] : '=';
+    }
+    *p = '\0';
+    *olen = (unsigned int)need;
+    return 0;
+}
@@ -0,0 +1,410 @@
+/**
+ * @file ws_host_server.c
+ * @author Dmitri Lyalikov (dvl2013@nyu.edu)
+ * @brief Host build of the WebSocket transport for load tests: the device's
+ *        websocket server, web client task, stream subscriptions and frame
+ *        pool, fed by a synthetic pipeline at the device's frame rate.
+ * @version 0.1
+ * @date 2025-12-15
+ *
+ * Everything from audio_frame_queue to the socket is the device source:
+ * web_client.c serializes and fans out each frame, websocket_server.c and
+ * websocket.c frame and write it, stream_subscription.c handles the text
+ * control channel. Only the layers below (FreeRTOS, lwIP netconn, mbedtls)
+ * are host shims, and the frames come from a synthetic source instead of
+ * the microphone pipeline.
+ *
+ * Frame timestamps are CLOCK_MONOTONIC microseconds at the first sample,
+ * so a client on the same host measures capture-to-delivery latency
+ * directly (tools/ws_bench/ws_load.py).
+ *
+ *   das_ws_server [-p port] [-s sndbuf] [-d seconds]
+ *
+ * On SIGINT / SIGTERM or after -d seconds it prints the transport counters
+ * and its own CPU time and peak RSS as "stat" lines, then exits.
+ */
+
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/resource.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#include "audio_frame.h"
+#include "scene_detector.h"
+#include "sample_process.h"
+#include "power_manager.h"
+#include "stream_subscription.h"
+#include "websocket_server.h"
+#include "web_client.h"
+#include "metrics.h"
+
+static const char *TAG = "ws_host";
+
+#define SAMPLE_RATE         AUDIO_FRAME_SAMPLE_RATE
+#define SAMPLE_COUNT        AUDIO_FRAME_MAX_SAMPLES
+#define SPECTRUM_BINS       CONFIG_AUDIO_SPECTRUM_BINS
+#define ENVELOPE_POINTS     AUDIO_FRAME_MAX_ENVELOPE_POINTS
+#define SCENE_PERIOD_FRAMES 100     // synthetic scene change every ~3 s
+
+#define DEFAULT_PORT        8080
+
+// Shared queues: synthetic pipeline -> transport, as in main.c
+QueueHandle_t audio_frame_queue;
+QueueHandle_t scene_event_queue;
+
+static uint32_t s_streams;          // AUDIO_STREAM_* wanted by any client
+static uint32_t s_frames_generated;
+static const char *MODE_NAMES[] = { "streaming", "events-only", "idle" };
+
+// ---------------------------------------------------------------------------
+// Stand-ins for the pipeline and power manager the subscriptions talk to
+
+void sample_process_set_streams(uint32_t stream_mask)
+{
+    __atomic_store_n(&s_streams, stream_mask, __ATOMIC_RELAXED);
+}
+
+void power_manager_set_mode(power_mode_t mode)
+{
+    static power_mode_t current = POWER_MODE_COUNT;
+    if (mode != current && mode < POWER_MODE_COUNT) {
+        ESP_LOGI(TAG, "power mode %s", MODE_NAMES[mode]);
+        current = mode;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// WebSocket events, as web_server.c handles them minus metrics / summary
+
+static void websocket_callback(uint8_t num, WEBSOCKET_TYPE_t type, char *msg, uint64_t len)
+{
+    switch (type) {
+    case WEBSOCKET_CONNECT:
+        ESP_LOGI(TAG, "client %i connected", num);
+        metrics_ws_client_reset(num);
+        stream_sub_client_connected(num);
+        break;
+    case WEBSOCKET_DISCONNECT_EXTERNAL:
+    case WEBSOCKET_DISCONNECT_INTERNAL:
+    case WEBSOCKET_DISCONNECT_ERROR:
+        ESP_LOGI(TAG, "client %i disconnected (%d)", num, (int)type);
+        stream_sub_client_disconnected(num);
+        break;
+    case WEBSOCKET_TEXT: {
+        char reply[64];
+        stream_sub_handle_command(num, msg, reply, sizeof(reply));
+        ws_server_send_text_client_from_callback(num, reply, strlen(reply));
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static void http_accept_task(void *arg)
+{
+    const int port = *(const int *)arg;
+    static const char NOT_FOUND[] = "HTTP/1.1 404 Not Found\r\nConnection: close\r\n\r\n";
+
+    struct netconn *listener = netconn_new(NETCONN_TCP);
+    if (netconn_bind(listener, NULL, (u16_t)port) != ERR_OK || netconn_listen(listener) != ERR_OK) {
+        ESP_LOGE(TAG, "cannot listen on port %d", port);
+        exit(1);
+    }
+    ESP_LOGI(TAG, "listening on port %d", port);
+
+    struct netconn *conn;
+    while (netconn_accept(listener, &conn) == ERR_OK) {
+        struct netbuf *inbuf;
+        char *buf;
+        u16_t buflen;
+
+        netconn_set_recvtimeout(conn, 1000);
+        if (netconn_recv(conn, &inbuf) != ERR_OK) {
+            netconn_close(conn);
+            netconn_delete(conn);
+            continue;
+        }
+        netbuf_data(inbuf, (void **)&buf, &buflen);
+        if (strstr(buf, "GET / ") && strstr(buf, "Upgrade: websocket")) {
+            netconn_set_recvtimeout(conn, 0);
+            ws_server_add_client(conn, buf, buflen, "/", websocket_callback);
+        } else {
+            netconn_write(conn, NOT_FOUND, sizeof(NOT_FOUND) - 1, NETCONN_COPY);
+            netconn_close(conn);
+            netconn_delete(conn);
+        }
+        netbuf_delete(inbuf);
+    }
+    vTaskDelete(NULL);
+}
+
+// ---------------------------------------------------------------------------
+// Synthetic pipeline
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void fill_frame(audio_frame_t *frame, uint32_t streams, uint32_t sequence, float *phase)
+{
+    static const float TONES[] = { 220.0f, 880.0f, 3000.0f };   // per scene
+    const audio_scene_t scene = (audio_scene_t)((sequence / SCENE_PERIOD_FRAMES) % 3);
+    const float tone = TONES[scene];
+    const float step = 2.0f * (float)M_PI * tone / SAMPLE_RATE;
+
+    int16_t *in = audio_frame_payload(frame, AUDIO_STREAM_RAW);
+    double sum = 0.0;
+    for (int i = 0; i < SAMPLE_COUNT; i++) {
+        float x = 0.3f * sinf(*phase) + 0.01f * ((float)(rand() % 2001) / 1000.0f - 1.0f);
+        *phase += step;
+        in[i] = (int16_t)(x * 32767.0f);
+        sum += (double)x * x;
+    }
+    *phase = fmodf(*phase, 2.0f * (float)M_PI);
+
+    frame->rms      = (float)sqrt(sum / SAMPLE_COUNT);
+    frame->centroid = tone;
+    frame->scene    = scene;
+    frame->gain     = 1.0f + 0.5f * (float)scene;
+
+    if (streams & AUDIO_STREAM_RAW) {
+        frame->samples_in = in;
+    }
+    if (streams & (AUDIO_STREAM_PROC | AUDIO_STREAM_ENVELOPE)) {
+        int16_t *out = audio_frame_payload(frame, AUDIO_STREAM_PROC);
+        for (int i = 0; i < SAMPLE_COUNT; i++) {
+            float y = in[i] * frame->gain;
+            out[i] = (int16_t)(y > 32767.0f ? 32767.0f : (y < -32768.0f ? -32768.0f : y));
+        }
+        if (streams & AUDIO_STREAM_PROC) frame->samples_out = out;
+
+        if (streams & AUDIO_STREAM_ENVELOPE) {
+            int16_t *env = audio_frame_payload(frame, AUDIO_STREAM_ENVELOPE);
+            const int span = SAMPLE_COUNT / ENVELOPE_POINTS;
+            for (int p = 0; p < ENVELOPE_POINTS; p++) {
+                int16_t lo = INT16_MAX, hi = INT16_MIN;
+                for (int i = p * span; i < (p + 1) * span; i++) {
+                    if (out[i] < lo) lo = out[i];
+                    if (out[i] > hi) hi = out[i];
+                }
+                env[2 * p] = lo;
+                env[2 * p + 1] = hi;
+            }
+            frame->envelope = env;
+            frame->envelope_points = ENVELOPE_POINTS;
+        }
+    }
+    if (streams & AUDIO_STREAM_SPECTRUM) {
+        uint8_t *spec = audio_frame_payload(frame, AUDIO_STREAM_SPECTRUM);
+        const float bin_hz = (float)AUDIO_FEATURE_SAMPLE_RATE / 2.0f / SPECTRUM_BINS;
+        for (int b = 0; b < SPECTRUM_BINS; b++) {
+            float d = fabsf(b * bin_hz - tone) / bin_hz;
+            spec[b] = (uint8_t)(d < 4.0f ? 220 - 40 * d : 40);
+        }
+        frame->spectrum = spec;
+        frame->spectrum_bins = SPECTRUM_BINS;
+        frame->spectrum_bin_hz = bin_hz;
+    }
+}
+
+static bool post_frame(audio_frame_t *frame)
+{
+    if (xQueueSend(audio_frame_queue, &frame, 0) == pdTRUE) return true;
+#if CONFIG_AUDIO_FRAME_QUEUE_DROP_OLDEST
+    audio_frame_t *oldest;
+    if (xQueueReceive(audio_frame_queue, &oldest, 0) == pdTRUE) {
+        audio_frame_release(oldest);
+        if (xQueueSend(audio_frame_queue, &frame, 0) == pdTRUE) {
+            metrics_inc(METRIC_FRAMES_QUEUE_DROPPED);
+            return true;
+        }
+    }
+#endif
+    metrics_inc(METRIC_FRAMES_QUEUE_DROPPED);
+    audio_frame_release(frame);
+    return false;
+}
+
+/*
+ * One frame every SAMPLE_COUNT / SAMPLE_RATE seconds on an absolute
+ * schedule, stamped with the time of its first sample, so transport
+ * backlog shows up as latency rather than as a slower frame rate.
+ */
+static void synthetic_pipeline_task(void *arg)
+{
+    const int64_t period_ns = (int64_t)SAMPLE_COUNT * 1000000000 / SAMPLE_RATE;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    uint32_t sequence = 0;
+    audio_scene_t last_scene = SCENE_QUIET;
+    float phase = 0.0f;
+
+    for (;;) {
+        next.tv_nsec += period_ns;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        const int64_t capture_us = now_us();
+        const uint32_t streams = __atomic_load_n(&s_streams, __ATOMIC_RELAXED);
+        const uint32_t seq = sequence++;
+        __atomic_store_n(&s_frames_generated, sequence, __ATOMIC_RELAXED);
+        if (!streams) continue;
+
+        audio_frame_t *frame = audio_frame_alloc();
+        if (!frame) {
+            metrics_inc(METRIC_FRAMES_ALLOC_FAILED);
+            continue;
+        }
+        frame->magic        = AUDIO_FRAME_MAGIC;
+        frame->sample_count = SAMPLE_COUNT;
+        frame->sequence     = seq;
+        frame->sample_index = (uint64_t)seq * SAMPLE_COUNT;
+        frame->timestamp_us = capture_us - (int64_t)SAMPLE_COUNT * 1000000 / SAMPLE_RATE;
+        fill_frame(frame, streams, seq, &phase);
+        metrics_inc(METRIC_FRAMES_PROCESSED);
+
+        if (frame->scene != last_scene) {
+            scene_event_t ev = {
+                .timestamp_us     = frame->timestamp_us,
+                .frame_index      = seq,
+                .from             = (uint8_t)last_scene,
+                .to               = (uint8_t)frame->scene,
+                .confidence       = 1.0f,
+                .mean_rms         = frame->rms,
+                .mean_centroid    = frame->centroid,
+                .prev_duration_ms = SCENE_PERIOD_FRAMES * SAMPLE_COUNT * 1000 / SAMPLE_RATE,
+            };
+            frame->flags |= AUDIO_FRAME_FLAG_SCENE_CHANGE;
+            if (xQueueSend(scene_event_queue, &ev, 0) != pdTRUE) {
+                metrics_inc(METRIC_SCENE_EVENTS_DROPPED);
+            }
+            last_scene = frame->scene;
+        }
+
+        post_frame(frame);
+    }
+}
+
+// ---------------------------------------------------------------------------
+
+// Peak RSS from /proc: ru_maxrss survives exec and would report the parent
+static long peak_rss_kb(void)
+{
+    char line[128];
+    long kb = -1;
+    FILE *f = fopen("/proc/self/status", "r");
+    if (!f) return -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "VmHWM: %ld", &kb) == 1) break;
+    }
+    fclose(f);
+    return kb;
+}
+
+static void print_stats(double wall_s)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    const double cpu_s = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6 +
+                         ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+
+    printf("stat wall_s %.3f\n", wall_s);
+    printf("stat cpu_s %.3f\n", cpu_s);
+    printf("stat cpu_pct %.1f\n", wall_s > 0 ? 100.0 * cpu_s / wall_s : 0.0);
+    printf("stat max_rss_kb %ld\n", peak_rss_kb());
+    printf("stat frames_generated %u\n", (unsigned)__atomic_load_n(&s_frames_generated, __ATOMIC_RELAXED));
+    printf("stat frames_processed %u\n", (unsigned)metrics_get(METRIC_FRAMES_PROCESSED));
+    printf("stat frames_alloc_failed %u\n", (unsigned)metrics_get(METRIC_FRAMES_ALLOC_FAILED));
+    printf("stat frames_queue_dropped %u\n", (unsigned)metrics_get(METRIC_FRAMES_QUEUE_DROPPED));
+    printf("stat frames_sent %u\n", (unsigned)metrics_get(METRIC_FRAMES_SENT));
+    printf("stat frames_unwanted %u\n", (unsigned)metrics_get(METRIC_FRAMES_UNWANTED));
+    printf("stat ws_send_errors %u\n", (unsigned)metrics_get(METRIC_WS_SEND_ERRORS));
+    for (int i = 0; i < METRICS_MAX_CLIENTS; i++) {
+        metrics_client_t c;
+        metrics_ws_client_get((uint8_t)i, &c);
+        if (c.messages) {
+            printf("stat client%d_tx %u %u\n", i, (unsigned)c.messages, (unsigned)c.bytes);
+        }
+    }
+    fflush(stdout);
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [-p port] [-s sndbuf] [-d seconds]\n"
+        "  -p PORT   listen port (default %d)\n"
+        "  -s BYTES  socket send buffer per client (default %d, TCP_SND_BUF; 0 = kernel default)\n"
+        "  -d SEC    exit after SEC seconds (default: on SIGINT / SIGTERM)\n",
+        prog, DEFAULT_PORT, CONFIG_LWIP_TCP_SND_BUF_DEFAULT);
+}
+
+int main(int argc, char **argv)
+{
+    static int port = DEFAULT_PORT;
+    int sndbuf = CONFIG_LWIP_TCP_SND_BUF_DEFAULT;
+    double duration_s = 0.0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:s:d:h")) != -1) {
+        switch (opt) {
+        case 'p': port = atoi(optarg); break;
+        case 's': sndbuf = atoi(optarg); break;
+        case 'd': duration_s = atof(optarg); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+
+    // Signals are taken synchronously below; every task thread inherits the mask
+    sigset_t stop;
+    sigemptyset(&stop);
+    sigaddset(&stop, SIGINT);
+    sigaddset(&stop, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop, NULL);
+
+    lwip_host_set_sndbuf(sndbuf);
+    audio_frame_queue = xQueueCreate(CONFIG_AUDIO_FRAME_QUEUE_LEN, sizeof(audio_frame_t *));
+    scene_event_queue = xQueueCreate(CONFIG_SCENE_EVENT_QUEUE_LEN, sizeof(scene_event_t));
+    if (!audio_frame_queue || !scene_event_queue || audio_frame_pool_init() != ESP_OK) {
+        ESP_LOGE(TAG, "out of memory");
+        return 1;
+    }
+
+    ws_server_start();
+    vTaskDelay(pdMS_TO_TICKS(50));  // the server task creates its mutex
+    xTaskCreate(web_client_task, "web_client", 4096, NULL, 5, NULL);
+    xTaskCreate(synthetic_pipeline_task, "pipeline", 4096, NULL, 6, NULL);
+    xTaskCreate(http_accept_task, "http", 4096, &port, 4, NULL);
+
+    const int64_t start = now_us();
+    if (duration_s > 0) {
+        struct timespec wait = { (time_t)duration_s, (long)((duration_s - (time_t)duration_s) * 1e9) };
+        sigtimedwait(&stop, NULL, &wait);
+    } else {
+        int sig;
+        sigwait(&stop, &sig);
+    }
+
+    print_stats((now_us() - start) * 1e-6);
+    _exit(0);
+}
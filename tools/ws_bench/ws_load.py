@@ -0,0 +1,502 @@
+#!/usr/bin/env python3
+"""
+ws_load.py - WebSocket load generator for the audio streaming transport.
+
+Opens a mix of WebSocket clients against the server, subscribes them to the
+v2 (DAS2) frame streams and reports, per interval and at exit:
+  * per client: delivered frame rate, sequence gaps (frames the transport
+    dropped for that client) and message latency p50 / p95 / p99 / max
+  * pong and command-reply round trips for the clients that send them
+  * server CPU and resident memory, sampled from /proc
+
+Client roles:
+  normal  reads as fast as it can
+  slow    small receive buffer, reads at --slow-rate kB/s: fills the server's
+          send buffer the way a stalled browser tab or weak Wi-Fi link does
+  ping    also sends a ping every --ping-interval s and times the pong
+  text    also re-sends its subscribe command every --text-interval s and
+          times the reply
+
+With --server the host build (tools/ws_bench, das_ws_server) is started on
+the same clock, so latency is absolute: end of the frame's samples ->
+arrival of the message. Against a real device (--host) the clocks are not
+synchronized and latency is reported relative to the fastest message seen,
+as tools/rtp_receiver.py does.
+
+Examples:
+  python3 tools/ws_bench/ws_load.py --server build-ws/das_ws_server --clients 4 --slow 1 --duration 20
+  python3 tools/ws_bench/ws_load.py --server build-ws/das_ws_server --streams all --ping 2 --text 2
+  python3 tools/ws_bench/ws_load.py --host 192.168.4.1 --port 80 --clients 2
+
+Standard library only.
+"""
+
+import argparse
+import base64
+import hashlib
+import os
+import signal
+import socket
+import struct
+import subprocess
+import threading
+import time
+
+WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+OP_TEXT = 0x1
+OP_BINARY = 0x2
+OP_CLOSE = 0x8
+OP_PING = 0x9
+OP_PONG = 0xA
+
+# DAS2 header (components/web/web_client.c)
+V2_HEADER = struct.Struct("<IBBBBIIqQIf")
+V2_MAGIC = 0x32534144
+EVENT_MAGIC = 0x45565430
+KIND_FEATURES, KIND_PCM_RAW, KIND_PCM_PROC = 0, 1, 2
+
+# Until two frames give the capture rate from their headers
+DEFAULT_FRAME_SAMPLES = 512
+DEFAULT_SAMPLE_RATE = 16000
+
+
+def percentile(values, p):
+    if not values:
+        return float("nan")
+    s = sorted(values)
+    return s[min(len(s) - 1, int(p / 100.0 * len(s)))]
+
+
+def ws_frame(opcode, payload):
+    """Client frame: FIN set, masked as RFC 6455 5.3 requires."""
+    mask = os.urandom(4)
+    n = len(payload)
+    if n < 126:
+        hdr = struct.pack("!BB", 0x80 | opcode, 0x80 | n)
+    elif n < 65536:
+        hdr = struct.pack("!BBH", 0x80 | opcode, 0x80 | 126, n)
+    else:
+        hdr = struct.pack("!BBQ", 0x80 | opcode, 0x80 | 127, n)
+    body = bytes(b ^ mask[i & 3] for i, b in enumerate(payload))
+    return hdr + mask + body
+
+
+class Client(threading.Thread):
+    """One WebSocket connection with its own receive loop and counters."""
+
+    def __init__(self, index, role, args, absolute):
+        super().__init__(daemon=True)
+        self.index = index
+        self.role = role
+        self.args = args
+        self.absolute = absolute
+        self.stop = threading.Event()
+        self.lock = threading.Lock()
+        self.sock = None
+        self.error = None
+        self.closed = False
+
+        self.frames = 0            # distinct sequences received
+        self.bytes = 0
+        self.events = 0
+        self.gaps = 0              # sequences missing between received ones
+        self.last_seq = None
+        self.last_frame = None     # (sample_index, timestamp_us) of the last frame
+        self.frame_samples = DEFAULT_FRAME_SAMPLES
+        self.sample_rate = DEFAULT_SAMPLE_RATE
+        self.latency = []          # ms, per message
+        self.min_transit = None
+        self.interval_frames = 0
+        self.interval_latency = []
+        self.pong_rtt = []         # ms
+        self.reply_rtt = []        # ms
+        self.pending_reply = []    # send times of unanswered commands
+
+    # -- connection ---------------------------------------------------------
+
+    def connect(self):
+        sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        if self.role == "slow":
+            # Set before connect so the advertised window stays small
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, self.args.slow_rcvbuf)
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        sock.settimeout(5.0)
+        sock.connect((self.args.host, self.args.port))
+
+        key = base64.b64encode(os.urandom(16)).decode()
+        sock.sendall((
+            "GET / HTTP/1.1\r\n"
+            "Host: %s:%d\r\n"
+            "Upgrade: websocket\r\n"
+            "Connection: Upgrade\r\n"
+            "Sec-WebSocket-Key: %s\r\n"
+            "Sec-WebSocket-Version: 13\r\n"
+            "\r\n" % (self.args.host, self.args.port, key)).encode())
+
+        buf = b""
+        while b"\r\n\r\n" not in buf:
+            chunk = sock.recv(4096)
+            if not chunk:
+                raise ConnectionError("closed during handshake")
+            buf += chunk
+        head, rest = buf.split(b"\r\n\r\n", 1)
+        accept = base64.b64encode(hashlib.sha1((key + WS_GUID).encode()).digest())
+        if not head.startswith(b"HTTP/1.1 101") or accept not in head:
+            raise ConnectionError("handshake rejected: %r" % head.split(b"\r\n")[0])
+        sock.settimeout(0.2)
+        self.sock = sock
+        return rest
+
+    def send(self, opcode, payload):
+        with self.lock:
+            self.sock.sendall(ws_frame(opcode, payload))
+
+    def subscribe(self):
+        cmd = "subscribe %s %d v2" % (self.args.streams, self.args.divisor)
+        self.pending_reply.append(time.monotonic())
+        self.send(OP_TEXT, cmd.encode())
+
+    # -- receive ------------------------------------------------------------
+
+    def on_message(self, opcode, payload, now):
+        if opcode == OP_BINARY:
+            self.on_binary(payload, now)
+        elif opcode == OP_TEXT:
+            if self.pending_reply:
+                self.reply_rtt.append((now - self.pending_reply.pop(0)) * 1000.0)
+        elif opcode == OP_PONG and len(payload) == 8:
+            sent, = struct.unpack("<d", payload)
+            self.pong_rtt.append((now - sent) * 1000.0)
+        elif opcode == OP_PING:
+            self.send(OP_PONG, payload)
+        elif opcode == OP_CLOSE:
+            self.closed = True
+            self.stop.set()
+
+    def on_binary(self, payload, now):
+        self.bytes += len(payload)
+        if len(payload) >= 4 and struct.unpack_from("<I", payload)[0] == EVENT_MAGIC:
+            self.events += 1
+            return
+        if len(payload) < V2_HEADER.size:
+            return
+        (magic, _version, kind, _enc, _flags, seq, count,
+         ts_us, sample_index, _plen, _param) = V2_HEADER.unpack_from(payload)
+        if magic != V2_MAGIC:
+            return
+
+        # Every message of a frame carries the frame's sequence
+        if self.last_seq is None or seq != self.last_seq:
+            if self.last_seq is not None:
+                step = (seq - self.last_seq) & 0xFFFFFFFF
+                if step < 0x80000000:
+                    self.gaps += step // self.args.divisor - 1 if step > self.args.divisor else 0
+            self.last_seq = seq
+            self.frames += 1
+            self.interval_frames += 1
+
+            # Capture rate and decimation vary by build; both follow from the headers
+            if self.last_frame is not None:
+                d_index = sample_index - self.last_frame[0]
+                d_us = ts_us - self.last_frame[1]
+                if d_index > 0 and d_us > 0:
+                    self.sample_rate = d_index * 1e6 / d_us
+            self.last_frame = (sample_index, ts_us)
+
+        if kind in (KIND_FEATURES, KIND_PCM_RAW, KIND_PCM_PROC):
+            self.frame_samples = count
+        transit = now * 1000.0 - (ts_us / 1000.0 + self.frame_samples * 1000.0 / self.sample_rate)
+        if not self.absolute:
+            if self.min_transit is None or transit < self.min_transit:
+                self.min_transit = transit
+            transit -= self.min_transit
+        self.latency.append(transit)
+        self.interval_latency.append(transit)
+
+    def run(self):
+        try:
+            buf = bytearray(self.connect())
+            self.subscribe()
+        except OSError as e:
+            self.error = str(e)
+            return
+
+        chunk = 1024 if self.role == "slow" else 65536
+        budget = self.args.slow_rate * 1024.0
+        started = time.monotonic()
+        next_ping = started
+        next_text = started + self.args.text_interval
+        received = 0
+        try:
+            while not self.stop.is_set():
+                now = time.monotonic()
+                if self.role == "ping" and now >= next_ping:
+                    self.send(OP_PING, struct.pack("<d", now))
+                    next_ping += self.args.ping_interval
+                if self.role == "text" and now >= next_text:
+                    self.subscribe()
+                    next_text += self.args.text_interval
+                if self.role == "slow":
+                    # Token bucket: never read ahead of the configured rate
+                    ahead = received / budget - (now - started)
+                    if ahead > 0:
+                        time.sleep(min(ahead, 0.2))
+                        continue
+
+                try:
+                    data = self.sock.recv(chunk)
+                except socket.timeout:
+                    continue
+                if not data:
+                    self.closed = not self.stop.is_set()
+                    break
+                received += len(data)
+                buf += data
+                now = time.monotonic()
+                self.parse(buf, now)
+        except OSError as e:
+            self.error = str(e)
+        finally:
+            try:
+                if not self.closed and not self.error:
+                    self.send(OP_CLOSE, struct.pack("!H", 1000))
+            except OSError:
+                pass
+            self.sock.close()
+
+    def parse(self, buf, now):
+        """Consume every complete server frame (unmasked) in buf."""
+        while len(buf) >= 2:
+            b0, b1 = buf[0], buf[1]
+            n = b1 & 0x7F
+            pos = 2
+            if n == 126:
+                if len(buf) < 4:
+                    return
+                n, = struct.unpack_from("!H", buf, 2)
+                pos = 4
+            elif n == 127:
+                if len(buf) < 10:
+                    return
+                n, = struct.unpack_from("!Q", buf, 2)
+                pos = 10
+            if b1 & 0x80:
+                pos += 4        # servers must not mask; skip it if one does
+            if len(buf) < pos + n:
+                return
+            payload = bytes(buf[pos:pos + n])
+            del buf[:pos + n]
+            self.on_message(b0 & 0x0F, payload, now)
+
+    # -- reporting ----------------------------------------------------------
+
+    def interval_report(self, label, interval):
+        lat = self.interval_latency
+        line = "%s  c%-2d %-6s %5.1f fps" % (label, self.index, self.role,
+                                            self.interval_frames / interval)
+        if lat:
+            line += "  latency p50 %6.1f  p95 %6.1f  max %6.1f ms" % (
+                percentile(lat, 50), percentile(lat, 95), max(lat))
+        if self.error:
+            line += "  error: %s" % self.error
+        elif self.closed:
+            line += "  closed by server"
+        self.interval_frames = 0
+        self.interval_latency = []
+        return line
+
+    def report(self, elapsed):
+        kind = "abs" if self.absolute else "over best"
+        line = ("c%-2d %-6s %6.1f fps  %6d frames  gaps %5d  events %3d  %7.1f kB/s  "
+                "latency (%s) p50 %6.1f  p95 %6.1f  p99 %6.1f  max %7.1f ms" % (
+                    self.index, self.role, self.frames / elapsed, self.frames,
+                    self.gaps, self.events, self.bytes / 1024.0 / elapsed, kind,
+                    percentile(self.latency, 50), percentile(self.latency, 95),
+                    percentile(self.latency, 99),
+                    max(self.latency) if self.latency else float("nan")))
+        if self.pong_rtt:
+            line += "\n     pong rtt p50 %.1f / p95 %.1f / max %.1f ms (%d)" % (
+                percentile(self.pong_rtt, 50), percentile(self.pong_rtt, 95),
+                max(self.pong_rtt), len(self.pong_rtt))
+        if self.role == "text":
+            line += "\n     reply rtt p50 %.1f / p95 %.1f / max %.1f ms (%d, %d unanswered)" % (
+                percentile(self.reply_rtt, 50), percentile(self.reply_rtt, 95),
+                max(self.reply_rtt) if self.reply_rtt else float("nan"),
+                len(self.reply_rtt), len(self.pending_reply))
+        if self.error:
+            line += "\n     error: %s" % self.error
+        elif self.closed:
+            line += "\n     closed by server"
+        return line
+
+
+class ServerProbe:
+    """CPU and memory of the server process from /proc/<pid>."""
+
+    def __init__(self, pid):
+        self.pid = pid
+        self.tick = os.sysconf("SC_CLK_TCK")
+        self.cpu_samples = []      # % of one core per interval
+        self.rss_samples = []      # kB
+        self.last = self.read_cpu()
+
+    def read_cpu(self):
+        try:
+            with open("/proc/%d/stat" % self.pid) as f:
+                fields = f.read().rsplit(")", 1)[1].split()
+            # utime and stime are fields 14 and 15, i.e. 11 and 12 after the comm
+            return (int(fields[11]) + int(fields[12])) / self.tick, time.monotonic()
+        except (OSError, IndexError):
+            return None
+
+    def read_rss(self):
+        try:
+            with open("/proc/%d/status" % self.pid) as f:
+                for line in f:
+                    if line.startswith("VmRSS:"):
+                        return int(line.split()[1])
+        except OSError:
+            pass
+        return None
+
+    def sample(self):
+        now = self.read_cpu()
+        rss = self.read_rss()
+        cpu = None
+        if now and self.last and now[1] > self.last[1]:
+            cpu = 100.0 * (now[0] - self.last[0]) / (now[1] - self.last[1])
+            self.cpu_samples.append(cpu)
+        self.last = now
+        if rss is not None:
+            self.rss_samples.append(rss)
+        return cpu, rss
+
+    def report(self):
+        if not self.cpu_samples:
+            return "server pid %d: no samples" % self.pid
+        return ("server pid %d: cpu mean %.1f%% / max %.1f%% of one core, "
+                "rss mean %d / max %d kB" % (
+                    self.pid, sum(self.cpu_samples) / len(self.cpu_samples),
+                    max(self.cpu_samples),
+                    sum(self.rss_samples) // max(1, len(self.rss_samples)),
+                    max(self.rss_samples) if self.rss_samples else 0))
+
+
+def start_server(args):
+    cmd = [args.server, "-p", str(args.port)]
+    if args.sndbuf is not None:
+        cmd += ["-s", str(args.sndbuf)]
+    log = subprocess.DEVNULL if not args.server_log else open(args.server_log, "w")
+    proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=log, text=True)
+    deadline = time.monotonic() + 5.0
+    while time.monotonic() < deadline:
+        if proc.poll() is not None:
+            raise SystemExit("server exited with %d" % proc.returncode)
+        try:
+            socket.create_connection((args.host, args.port), timeout=0.2).close()
+            return proc
+        except OSError:
+            time.sleep(0.05)
+    proc.kill()
+    raise SystemExit("server did not start listening on port %d" % args.port)
+
+
+def stop_server(proc):
+    """SIGTERM makes das_ws_server print its "stat" counters and exit."""
+    proc.send_signal(signal.SIGTERM)
+    try:
+        out, _ = proc.communicate(timeout=5.0)
+    except subprocess.TimeoutExpired:
+        proc.kill()
+        out, _ = proc.communicate()
+    return [line[5:] for line in out.splitlines() if line.startswith("stat ")]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    ap.add_argument("--host", default="127.0.0.1")
+    ap.add_argument("--port", type=int, default=8080)
+    ap.add_argument("--server", help="start this das_ws_server binary and probe it")
+    ap.add_argument("--server-log", help="write the server's log here")
+    ap.add_argument("--sndbuf", type=int, help="server send buffer per client (bytes, -s)")
+    ap.add_argument("--pid", type=int, help="probe an already running server process")
+    ap.add_argument("--clients", type=int, default=4, help="normal clients")
+    ap.add_argument("--slow", type=int, default=0, help="slow-reader clients")
+    ap.add_argument("--ping", type=int, default=0, help="clients that also send pings")
+    ap.add_argument("--text", type=int, default=0, help="clients that also send commands")
+    ap.add_argument("--streams", default="features,raw", help="subscribe stream list")
+    ap.add_argument("--divisor", type=int, default=1, help="subscribe frame divisor")
+    ap.add_argument("--slow-rate", type=float, default=8.0, help="slow reader rate (kB/s)")
+    ap.add_argument("--slow-rcvbuf", type=int, default=4096, help="slow reader SO_RCVBUF")
+    ap.add_argument("--ping-interval", type=float, default=0.5, help="ping period (s)")
+    ap.add_argument("--text-interval", type=float, default=1.0, help="command period (s)")
+    ap.add_argument("--stagger", type=float, default=0.05, help="delay between connects (s)")
+    ap.add_argument("--interval", type=float, default=5.0, help="report period (s)")
+    ap.add_argument("--duration", type=float, default=10.0, help="test length after connecting (s)")
+    args = ap.parse_args()
+
+    proc = start_server(args) if args.server else None
+    pid = proc.pid if proc else args.pid
+    probe = ServerProbe(pid) if pid else None
+    absolute = bool(proc) or bool(args.pid)
+
+    roles = (["normal"] * args.clients + ["slow"] * args.slow +
+             ["ping"] * args.ping + ["text"] * args.text)
+    clients = []
+    for i, role in enumerate(roles):
+        c = Client(i, role, args, absolute)
+        c.start()
+        clients.append(c)
+        time.sleep(args.stagger)
+
+    # Counting starts once everyone is subscribed
+    time.sleep(0.5)
+    for c in clients:
+        c.frames = c.bytes = c.events = c.gaps = 0
+        c.interval_frames = 0
+        c.latency, c.interval_latency = [], []
+    if probe:
+        probe.sample()
+        probe.cpu_samples, probe.rss_samples = [], []
+
+    start = time.monotonic()
+    next_report = start + args.interval
+    try:
+        while time.monotonic() - start < args.duration:
+            time.sleep(max(0.0, min(next_report, start + args.duration) - time.monotonic()))
+            now = time.monotonic()
+            if now >= next_report:
+                label = "%6.1fs" % (now - start)
+                for c in clients:
+                    print(c.interval_report(label, args.interval), flush=True)
+                if probe:
+                    cpu, rss = probe.sample()
+                    if cpu is not None:
+                        print("%s  server cpu %.1f%%  rss %s kB" % (label, cpu, rss), flush=True)
+                next_report += args.interval
+    except KeyboardInterrupt:
+        pass
+    elapsed = time.monotonic() - start
+    if probe:
+        probe.sample()
+
+    # Server counters cover the same window as the clients'
+    for c in clients:
+        c.stop.set()
+    stats = stop_server(proc) if proc else []
+    for c in clients:
+        c.join(1.0)
+
+    print("total %.1f s, %d clients, streams %s / %d" % (
+        elapsed, len(clients), args.streams, args.divisor))
+    for c in clients:
+        print(c.report(elapsed))
+    if probe:
+        print(probe.report())
+    for line in stats:
+        print("server " + line)
+
+
+if __name__ == "__main__":
+    main()